@@ -0,0 +1,750 @@
+// bench/Benchmarks.cpp
+#include "Benchmarks.hpp"
+#include "config/ConfigLoader.hpp"
+#include "db/Database.hpp"
+#include "db/managers/CommandOutboxManager.hpp"
+#include "db/managers/MetricManager.hpp"
+#include "db/managers/RuleManager.hpp"
+#include "entities/Metric.hpp"
+#include "entities/Rule.hpp"
+#include "mqtt_client/MQTTClient.hpp"
+#include "processor/CommandOutbox.hpp"
+#include "processor/CronSpec.hpp"
+#include "processor/MetricDecoder.hpp"
+#include "processor/RuleIndex.hpp"
+#include "processor/RuleReplay.hpp"
+#include "processor/SeriesKey.hpp"
+#include "processor/ThresholdKernel.hpp"
+#include "utils/Logger.hpp"
+#include <trantor/utils/Logger.h>
+#include <mqtt/async_client.h>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Бенчмарк проверки правил: 100k правил за один такт
+void benchRules()
+{
+    std::cout << "\n===== Benchmark: Rule Evaluation =====" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d)
+    { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    constexpr int kRules = 100000;
+    constexpr int kGreenhouses = 100;
+    constexpr int kSensors = 100; // рядов: kGreenhouses * kSensors
+    const char *ops[] = {">", ">=", "<", "<=", "=", "!="};
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, 100.0);
+
+    std::vector<Rule> rules;
+    rules.reserve(kRules);
+    for (int i = 0; i < kRules; ++i)
+    {
+        Rule r;
+        r.rule_id = i + 1;
+        r.gh_id = i % kGreenhouses + 1;
+        r.from_comp_id = (i / kGreenhouses) % kSensors + 1;
+        r.to_comp_id = 1;
+        if (i % 10 == 0)
+        {
+            r.kind = "time";
+            std::ostringstream spec;
+            spec << std::setfill('0') << std::setw(2) << (i / 10) % 24 << ':'
+                 << std::setw(2) << (i / 240) % 60;
+            r.time_spec = spec.str();
+        }
+        else
+        {
+            r.kind = "threshold";
+            r.operator_ = ops[i % 6];
+            r.threshold = dist(rng);
+            // Часть правил с гистерезисом и задержками
+            if (i % 3 == 0 && (i % 6 == 0 || i % 6 == 1))
+                r.off_threshold = *r.threshold - 5.0;
+            r.debounce_sec = i % 5 == 0 ? 3 : 0;
+            r.min_dwell_sec = i % 7 == 0 ? 10 : 0;
+            // И часть — с выражением по оконным агрегатам двух рядов
+            if (i % 20 == 11)
+            {
+                std::ostringstream expr;
+                expr << "avg('" << r.from_comp_id << "', 5m) > " << *r.threshold << " AND '"
+                     << r.from_comp_id % kSensors + 1 << "' < 60";
+                r.expression = expr.str();
+            }
+        }
+        rules.push_back(std::move(r));
+    }
+
+    std::unordered_map<processor::SeriesKey, double, processor::SeriesKeyHash> latest;
+    for (int gh = 1; gh <= kGreenhouses; ++gh)
+        for (int c = 1; c <= kSensors; ++c)
+            latest[{gh, std::to_string(c)}] = dist(rng);
+
+    const auto now = std::time(nullptr);
+    std::tm now_tm{};
+    localtime_r(&now, &now_tm);
+
+    // Прежний путь: сравнение строк и разбор time_spec на каждом такте
+    size_t legacy_fired = 0;
+    auto t0 = Clock::now();
+    for (const auto &r : rules)
+    {
+        if (r.kind == "time")
+        {
+            std::istringstream ss(*r.time_spec);
+            std::tm tm{};
+            ss >> std::get_time(&tm, "%H:%M");
+            legacy_fired += tm.tm_hour == now_tm.tm_hour && tm.tm_min == now_tm.tm_min;
+        }
+        else if (r.kind == "threshold")
+        {
+            double v = latest[{r.gh_id, std::to_string(r.from_comp_id)}];
+            const auto &op = *r.operator_;
+            double th = *r.threshold;
+            bool cond = false;
+            if (op == ">") cond = v > th;
+            else if (op == "<") cond = v < th;
+            else if (op == ">=") cond = v >= th;
+            else if (op == "<=") cond = v <= th;
+            else if (op == "==" || op == "=") cond = v == th;
+            else if (op == "!=") cond = v != th;
+            legacy_fired += cond;
+        }
+    }
+    const double legacy_ms = ms(Clock::now() - t0);
+
+    auto &index = processor::RuleIndex::instance();
+    t0 = Clock::now();
+    index.rebuild(rules);
+    const double compile_ms = ms(Clock::now() - t0);
+
+    // Правила по времени на такте не проверяются: RuleScheduler один раз
+    // вычисляет ближайший срок каждого и далее держит таймер на самом раннем
+    std::vector<processor::CronSpec> specs;
+    t0 = Clock::now();
+    for (const auto &r : rules)
+        if (r.kind == "time")
+            if (auto spec = processor::CronSpec::parse(*r.time_spec))
+                specs.push_back(*spec);
+    size_t scheduled = 0;
+    for (const auto &spec : specs)
+        scheduled += spec.next_after(now).has_value();
+    const double schedule_ms = ms(Clock::now() - t0);
+
+    // Событийный путь: пакет метрик по всем рядам; каждую секунду новые значения
+    constexpr int kTicks = 50;
+    std::vector<std::vector<Metric>> batches(kTicks);
+    for (auto &batch : batches)
+    {
+        batch.reserve(latest.size());
+        for (const auto &[k, v] : latest)
+            batch.emplace_back(k.gh_id, "2024-01-01 12:00:00", k.subtype, dist(rng));
+    }
+    std::vector<processor::RuleIndex::Trigger> fired;
+    size_t transitions = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < kTicks; ++i)
+    {
+        fired.clear();
+        index.on_metrics(batches[i], now + i, fired);
+        transitions += fired.size();
+    }
+    const double batch_ms = ms(Clock::now() - t0) / kTicks;
+
+    // Периодический такт: только досчёт debounce/min_dwell
+    t0 = Clock::now();
+    for (int i = 0; i < kTicks; ++i)
+    {
+        fired.clear();
+        index.advance(now + kTicks + i, fired);
+        transitions += fired.size();
+    }
+    const double tick_ms = ms(Clock::now() - t0) / kTicks;
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rules: " << kRules << ", series: " << latest.size() << "\n"
+              << "Legacy string evaluation:   " << legacy_ms << " ms/tick (" << legacy_fired << " fired)\n"
+              << "Compile (rebuild index):    " << compile_ms << " ms\n"
+              << "Schedule " << scheduled << " time rules:  " << schedule_ms << " ms (once, not per tick)\n"
+              << "On-arrival batch of " << latest.size() << ": " << batch_ms << " ms\n"
+              << "Periodic advance():         " << tick_ms << " ms/tick\n"
+              << "State transitions:          " << transitions << " over " << kTicks << " batches\n";
+}
+
+// Бенчмарк пакетной проверки порогов: 1M правил, все ряды в одном пакете, одно ядро
+void benchThresholdBatch()
+{
+    std::cout << "\n===== Benchmark: Vectorized Threshold Evaluation =====" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d)
+    { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    constexpr int kRules = 1000000;
+    constexpr int kGreenhouses = 100;
+    constexpr int kSensors = 1000; // рядов: kGreenhouses * kSensors
+    constexpr int kBatches = 10;
+    const char *ops[] = {">", ">=", "<", "<=", "=", "!="};
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> dist(0.0, 100.0);
+
+    std::vector<Rule> rules;
+    rules.reserve(kRules);
+    for (int i = 0; i < kRules; ++i)
+    {
+        Rule r;
+        r.rule_id = i + 1;
+        r.gh_id = i % kGreenhouses + 1;
+        r.from_comp_id = (i / kGreenhouses) % kSensors + 1;
+        r.to_comp_id = 1;
+        r.kind = "threshold";
+        r.operator_ = ops[i % 6];
+        r.threshold = dist(rng);
+        if (i % 4 == 0 && i % 6 < 4)
+            r.off_threshold = *r.threshold + (i % 6 < 2 ? -5.0 : 5.0);
+        rules.push_back(std::move(r));
+    }
+
+    // Показания меняются плавно: за секунду состояние меняет малая доля правил
+    std::normal_distribution<double> drift(0.0, 0.5);
+    std::vector<double> level(kGreenhouses * kSensors);
+    for (auto &v : level)
+        v = dist(rng);
+    std::vector<std::vector<Metric>> batches(kBatches);
+    for (auto &batch : batches)
+    {
+        batch.reserve(level.size());
+        for (int gh = 1; gh <= kGreenhouses; ++gh)
+            for (int c = 1; c <= kSensors; ++c)
+            {
+                auto &v = level[(gh - 1) * kSensors + c - 1];
+                v += drift(rng);
+                batch.emplace_back(gh, "2024-01-01 12:00:00", std::to_string(c), v);
+            }
+    }
+
+    // Каждый режим — на своём индексе с одинаковыми правилами и пакетами;
+    // совпадение числа смен состояния подтверждает равенство результатов
+    const auto now = std::time(nullptr);
+    auto run = [&](std::optional<processor::SimdLevel> level, size_t &transitions)
+    {
+        processor::RuleIndex index;
+        index.rebuild(rules);
+        index.set_batch_kernel(level);
+        // Первый пакет включает половину правил — в замер не входит
+        std::vector<processor::RuleIndex::Trigger> fired;
+        index.on_metrics(batches[0], now, fired);
+        transitions = 0;
+        auto t0 = Clock::now();
+        for (int i = 1; i < kBatches; ++i)
+        {
+            fired.clear();
+            index.on_metrics(batches[i], now + i, fired);
+            transitions += fired.size();
+        }
+        return ms(Clock::now() - t0) / (kBatches - 1);
+    };
+
+    size_t baseline = 0;
+    const double one_by_one_ms = run(std::nullopt, baseline);
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rules: " << kRules << ", series per batch: " << kGreenhouses * kSensors << "\n"
+              << "One rule at a time:         " << one_by_one_ms << " ms/batch (" << baseline << " transitions)\n";
+
+    // Только ядро: маска по плотному массиву значений
+    processor::ThresholdBatch kernel_batch;
+    for (int i = 0; i < kRules; ++i)
+        kernel_batch.push(static_cast<std::uint32_t>(i % (kGreenhouses * kSensors)),
+                          dist(rng), 100.0, i % 6 == 5);
+    std::vector<double> values(kGreenhouses * kSensors);
+    for (auto &v : values)
+        v = dist(rng);
+    std::vector<std::uint64_t> mask((kRules + 63) / 64);
+
+    const auto best = processor::detect_simd();
+    for (auto level : {processor::SimdLevel::Scalar, processor::SimdLevel::SSE2, processor::SimdLevel::AVX2})
+    {
+        if (level > best)
+            break;
+        size_t transitions = 0;
+        const double batch_ms = run(level, transitions);
+
+        auto t0 = Clock::now();
+        for (int i = 0; i < kBatches; ++i)
+            processor::evaluate_thresholds(kernel_batch, values.data(), mask.data(), level);
+        const double kernel_ms = ms(Clock::now() - t0) / kBatches;
+
+        std::cout << "Batched, " << std::left << std::setw(7) << processor::simd_name(level) << std::right
+                  << "             " << batch_ms << " ms/batch ("
+                  << (transitions == baseline ? "same result" : "MISMATCH") << "), kernel "
+                  << kernel_ms << " ms (" << std::setprecision(0) << kRules / kernel_ms / 1e3
+                  << std::setprecision(3) << " M rules/s)\n";
+    }
+}
+
+// Бенчмарк воспроизведения истории: год поминутных данных по 20 рядам
+void benchReplay()
+{
+    std::cout << "\n===== Benchmark: Rule Replay =====" << std::endl;
+
+    constexpr int kSensors = 20;
+    constexpr std::int64_t kMinutes = 365 * 24 * 60;
+    const char *ops[] = {">", "<"};
+
+    std::vector<Rule> rules;
+    for (int i = 0; i < 100; ++i)
+    {
+        Rule r;
+        r.rule_id = i + 1;
+        r.gh_id = 1;
+        r.from_comp_id = i % kSensors + 1;
+        r.to_comp_id = 1;
+        r.kind = "threshold";
+        r.operator_ = ops[i % 2];
+        r.threshold = 40.0 + i % 20;
+        if (i % 4 == 0)
+            r.off_threshold = *r.threshold + (i % 2 ? 3.0 : -3.0);
+        r.debounce_sec = i % 3 == 0 ? 120 : 0;
+        r.min_dwell_sec = i % 5 == 0 ? 600 : 0;
+        if (i % 10 == 9)
+        {
+            std::ostringstream expr;
+            expr << "avg('" << r.from_comp_id << "', 15m) > 55 AND '" << r.from_comp_id % kSensors + 1 << "' < 45";
+            r.expression = expr.str();
+        }
+        rules.push_back(std::move(r));
+    }
+
+    // Значения генерируются заранее: замеряется только проверка правил
+    std::mt19937 rng(7);
+    std::normal_distribution<double> step(0.0, 1.5);
+    std::vector<double> level(kSensors, 50.0);
+    std::vector<double> values;
+    values.reserve(static_cast<size_t>(kMinutes) * kSensors);
+    for (std::int64_t m = 0; m < kMinutes; ++m)
+        for (int c = 0; c < kSensors; ++c)
+        {
+            level[c] = std::clamp(level[c] + step(rng), 0.0, 100.0);
+            values.push_back(level[c]);
+        }
+
+    const std::int64_t start = *processor::RuleReplay::parse_time("2024-01-01 00:00:00");
+    std::vector<processor::SeriesKey> keys(kSensors);
+    for (int c = 0; c < kSensors; ++c)
+    {
+        keys[c].gh_id = 1;
+        keys[c].subtype = std::to_string(c + 1);
+    }
+
+    processor::RuleReplay replay(rules, 0);
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t i = 0;
+    for (std::int64_t m = 0; m < kMinutes; ++m)
+        for (int c = 0; c < kSensors; ++c)
+            replay.push(start + m * 60 + c, keys[c], values[i++]);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    auto report = replay.finish();
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rules: " << rules.size() << ", points: " << report.points << "\n"
+              << "Replay:                     " << ms << " ms ("
+              << std::setprecision(1) << static_cast<double>(report.points) / ms / 1e3 << " M points/s)\n"
+              << "Commands:                   " << report.commands << "\n";
+}
+
+// Бенчмарк исходящей очереди: команды одного прохода правил при RTT брокера 2 мс
+void benchCommandOutbox()
+{
+    std::cout << "\n===== Benchmark: Command Outbox =====" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    constexpr int kCommands = 200;
+    constexpr auto kRtt = std::chrono::milliseconds(2);
+    auto ms_since = [](Clock::time_point t)
+    { return std::chrono::duration<double, std::milli>(Clock::now() - t).count(); };
+
+    if (!db::Database::getInstance()->initialize())
+    {
+        std::cerr << "Database initialization failed\n";
+        return;
+    }
+
+    // Брокер: подтверждение приходит через RTT из своего потока
+    boost::asio::io_context broker;
+    auto broker_guard = boost::asio::make_work_guard(broker);
+    std::thread broker_thread([&broker]
+                              { broker.run(); });
+    auto ack_later = [&broker, kRtt](std::function<void(bool)> done)
+    {
+        auto timer = std::make_shared<boost::asio::steady_timer>(broker, kRtt);
+        timer->async_wait([timer, done = std::move(done)](const boost::system::error_code &)
+                          { done(true); });
+    };
+
+    std::vector<processor::CommandOutbox::Command> commands;
+    for (int i = 0; i < kCommands; ++i)
+        commands.emplace_back(i % 20 + 1, R"({"rule_id":)" + std::to_string(i + 1) +
+                                              R"(,"to_component":1,"type":"threshold","state":"on"})");
+
+    // Прежняя схема: публикация и ожидание ответа брокера на каждую команду
+    auto started = Clock::now();
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+        std::promise<bool> acked;
+        ack_later([&acked](bool ok)
+                  { acked.set_value(ok); });
+        acked.get_future().wait();
+    }
+    const double sequential_ms = ms_since(started);
+
+    // Outbox: запись в БД в потоке вызывающего, публикация окном max_in_flight
+    boost::asio::io_context ioc;
+    auto guard = boost::asio::make_work_guard(ioc);
+    OutboxConfig cfg;
+    db::CommandOutboxManager store;
+    processor::CommandOutbox outbox(ioc, cfg, store, [&ack_later](std::vector<processor::CommandOutbox::Publish> batch)
+                                    {
+        for (auto &p : batch)
+            ack_later([done = std::move(p.done)](bool ok)
+                      { done(ok ? processor::CommandOutbox::Result::Delivered
+                                : processor::CommandOutbox::Result::Failed); }); });
+    outbox.start();
+    std::thread io_thread([&ioc]
+                          { ioc.run(); });
+
+    const auto before = processor::CommandOutbox::stats().delivered;
+    started = Clock::now();
+    outbox.enqueue(commands);
+    const double enqueue_ms = ms_since(started);
+    while (processor::CommandOutbox::stats().delivered < before + kCommands)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    const double delivered_ms = ms_since(started);
+
+    outbox.stop();
+    guard.reset();
+    io_thread.join();
+    broker_guard.reset();
+    broker_thread.join();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "Commands: " << kCommands << ", RTT: " << kRtt.count() << " ms, window: " << cfg.max_in_flight << "\n"
+              << "Publish and wait each:      " << sequential_ms << " ms\n"
+              << "Outbox enqueue (caller):    " << enqueue_ms << " ms\n"
+              << "Outbox all delivered:       " << delivered_ms << " ms\n";
+}
+
+// Бенчмарк форматов метрик: байт на показание (с топиком) и время разбора
+void benchMetricPayloads()
+{
+    std::cout << "\n===== Benchmark: Metric Payload Formats =====" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    using processor::MetricDecoder;
+    constexpr int kRounds = 2000;
+    const std::string topic = "greenhouse/12/metrics";
+    const std::uint32_t base_ts = 1700000000;
+
+    auto put = [](std::string &out, auto v)
+    {
+        char buf[sizeof(v)];
+        std::memcpy(buf, &v, sizeof(v));
+        out.append(buf, sizeof(v));
+    };
+
+    auto json_payload = [&](int n)
+    {
+        std::string s = n > 1 ? "[" : "";
+        for (int i = 0; i < n; ++i)
+            s += (i ? "," : "") + std::string(R"({"subtype":"temperature","value":)") +
+                 std::to_string(21.5 + i * 0.01).substr(0, 5) + R"(,"ts":")" +
+                 MetricDecoder::format_timestamp(base_ts + i) + "\"}";
+        return s + (n > 1 ? "]" : "");
+    };
+    auto binary_payload = [&](int n)
+    {
+        std::string s(MetricDecoder::kBinaryMagic, MetricDecoder::kBinaryHeaderSize);
+        for (int i = 0; i < n; ++i)
+        {
+            put(s, std::uint16_t{12});
+            put(s, static_cast<std::uint16_t>(1 + i % 4));
+            put(s, static_cast<std::uint32_t>(base_ts + i));
+            put(s, 21.5 + i * 0.01);
+        }
+        return s;
+    };
+    auto compact_payload = [&](int n)
+    {
+        std::string s(MetricDecoder::kCompactMagic, sizeof(MetricDecoder::kCompactMagic));
+        put(s, std::uint16_t{0}); // теплица — из топика
+        put(s, base_ts);
+        for (int i = 0; i < n; ++i)
+        {
+            put(s, static_cast<std::uint16_t>(1 + i % 4));
+            put(s, static_cast<std::uint16_t>(i));
+            put(s, static_cast<float>(21.5 + i * 0.01));
+        }
+        return s;
+    };
+
+    struct Format
+    {
+        const char *name;
+        std::function<std::string(int)> make;
+        std::string_view content_type;
+    };
+    const Format formats[] = {
+        {"JSON", json_payload, "application/json"},
+        {"Binary (16 B records)", binary_payload, MetricDecoder::kBinaryContentType},
+        {"Binary compact (8 B)", compact_payload, MetricDecoder::kBinaryContentType},
+    };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Bytes per reading include the topic name (" << topic.size()
+              << " B) or a 3 B MQTT 5 topic alias\n";
+    for (int per_message : {1, 50})
+    {
+        for (const auto &f : formats)
+        {
+            const auto payload = f.make(per_message);
+            const auto format = MetricDecoder::detect(f.content_type, payload);
+            size_t decoded = 0;
+            const auto t0 = Clock::now();
+            for (int r = 0; r < kRounds; ++r)
+                decoded += MetricDecoder::decode(payload, format, 12).metrics.size();
+            const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / decoded;
+
+            std::cout << std::setw(2) << per_message << " per message, " << std::left << std::setw(22) << f.name
+                      << std::right << std::setw(6) << double(payload.size() + topic.size()) / per_message
+                      << " B/reading, alias " << std::setw(6) << double(payload.size() + 3) / per_message
+                      << " B/reading, decode " << std::setw(6) << ns << " ns/reading"
+                      << (decoded == size_t(kRounds) * per_message ? "" : "  (REJECTED)") << "\n";
+        }
+    }
+}
+
+// Бенчмарк журнала: цена вызова LOG_*_SG в вызывающем потоке — на отключённом
+// уровне, на включённом (с форматированием сразу и отложенным), под
+// ограничением частоты места вызова и LOG_INFO drogon через ту же очередь. Очередь
+// заполняется пачками по половине ёмкости, запись в файл — между пачками
+void benchLogging()
+{
+    std::cout << "\n===== Benchmark: Logging Hot Path =====" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    constexpr int kRounds = 20;
+    auto &logger = Logger::instance();
+    const size_t burst = logger.stats().capacity / 2;
+
+    // Консоль на время замера отключена: сообщения идут только в файл журнала
+    logger.flush();
+    logger.set_console_output(false);
+
+    const auto before = logger.stats();
+    auto run = [&](int threads, bool deferred)
+    {
+        logger.set_deferred(deferred);
+        const size_t per_thread = burst / threads;
+        double ns = 0.0;
+        for (int r = 0; r < kRounds; ++r)
+        {
+            std::vector<std::thread> workers;
+            std::atomic<std::int64_t> elapsed{0};
+            for (int t = 0; t < threads; ++t)
+                workers.emplace_back([&, t]
+                                     {
+                    const auto t0 = Clock::now();
+                    for (size_t i = 0; i < per_thread; ++i)
+                        LOG_INFO_SG("bench: gh={} sensor={} value={}", t, i, 21.5 + i * 0.01);
+                    elapsed.fetch_add((Clock::now() - t0).count()); });
+            for (auto &w : workers)
+                w.join();
+            logger.flush();
+            ns += std::chrono::duration<double, std::nano>(Clock::duration(elapsed.load())).count() /
+                  double(per_thread * threads);
+        }
+        logger.set_deferred(false);
+        return ns / kRounds;
+    };
+
+    // Аргумент на отключённом уровне не вычисляется: std::to_string не вызывается
+    const auto t0 = Clock::now();
+    constexpr int kFiltered = 1'000'000;
+    for (int i = 0; i < kFiltered; ++i)
+        LOG_DEBUG_SG("bench: filtered {}", std::to_string(i));
+    const double filtered_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / kFiltered;
+
+    // Поток одинаковых предупреждений с одного места: пишутся первые 10
+    const auto flood_before = logger.stats().written;
+    const auto t1 = Clock::now();
+    constexpr int kFlood = 1'000'000;
+    for (int i = 0; i < kFlood; ++i)
+        LOG_WARN_LIMIT_SG(10, 60, "bench: unmatched topic greenhouse/{}/junk", i);
+    const double flood_ns = std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / kFlood;
+    logger.flush();
+    const auto flood_written = logger.stats().written - flood_before;
+
+    // Строку drogon форматирует trantor, мост только переносит её в очередь
+    const auto t2 = Clock::now();
+    for (size_t i = 0; i < burst; ++i)
+        LOG_INFO << "bench: drogon gh=" << i % 8 << " sensor=" << i;
+    const double drogon_ns = std::chrono::duration<double, std::nano>(Clock::now() - t2).count() / burst;
+    logger.flush();
+
+    const double eager_one = run(1, false);
+    const double deferred_one = run(1, true);
+    const double eager_four = run(4, false);
+    const double deferred_four = run(4, true);
+    const auto after = logger.stats();
+    logger.set_console_output(true);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Queue capacity: " << after.capacity << " records, burst " << burst
+              << ", compiled minimum level " << SG_LOG_MIN_LEVEL << "\n"
+              << "Disabled level (DEBUG):          " << filtered_ns << " ns/call\n"
+              << "INFO, 1 thread, format now:      " << eager_one << " ns/call\n"
+              << "INFO, 1 thread, deferred:        " << deferred_one << " ns/call\n"
+              << "INFO, 4 threads, format now:     " << eager_four << " ns/call per thread\n"
+              << "INFO, 4 threads, deferred:       " << deferred_four << " ns/call per thread\n"
+              << "drogon LOG_INFO, 1 thread:       " << drogon_ns << " ns/call\n"
+              << "WARN flood, limited to 10/min:   " << flood_ns << " ns/call, " << flood_written
+              << " of " << kFlood << " written\n"
+              << "Written: " << after.written - before.written
+              << ", dropped: " << after.dropped - before.dropped
+              << ", blocked: " << after.blocked - before.blocked << "\n";
+}
+
+// Нагрузочный тест приёма метрик: smart_greenhouse_bench --mqtt [MESSAGES]
+// Брокер и учётные данные — из ./config (mosquitto из mosquitto/). Для
+// 1, 2, 4, ... подключений (не больше числа ядер) публикуется MESSAGES
+// пакетов по 50 точек, приёмник декодирует их, как ServerProcessor
+int benchMqttConsumers(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+    const int kMessages = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20000;
+    constexpr int kPoints = 50;
+    constexpr int kGreenhouses = 64;
+
+    ConfigLoader cfgLoader;
+    const auto cfg = cfgLoader.load("./config");
+    std::cout << "\n===== Load test: MQTT metrics consumers =====\n"
+              << "Broker: " << cfg.mqtt.broker << ", messages: " << kMessages
+              << ", points per message: " << kPoints << std::endl;
+
+    std::string payload = "[";
+    for (int i = 0; i < kPoints; ++i)
+        payload += (i ? "," : "") + std::string(R"({"subtype":"temperature","value":)") +
+                   std::to_string(20.0 + i * 0.1) + "}";
+    payload += "]";
+
+    // Издатель: окно неподтверждённых публикаций, чтобы не упереться в лимит Paho
+    mqtt::async_client publisher(cfg.mqtt.broker, cfg.mqtt.client_id + "-bench-pub");
+    mqtt::connect_options pub_opts;
+    pub_opts.set_clean_session(true);
+    if (!cfg.mqtt.username.empty())
+    {
+        pub_opts.set_user_name(cfg.mqtt.username);
+        pub_opts.set_password(cfg.mqtt.password);
+    }
+    try
+    {
+        publisher.connect(pub_opts)->wait();
+    }
+    catch (const mqtt::exception &e)
+    {
+        std::cerr << "Broker unavailable: " << e.what() << "\n";
+        return 1;
+    }
+
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    double base_rate = 0.0;
+    for (int consumers = 1; consumers <= std::min(cores, 16); consumers *= 2)
+    {
+        MQTTConfig mcfg = cfg.mqtt;
+        mcfg.client_id += "-bench";
+        mcfg.consumers = consumers;
+        mcfg.share_group = "bench";
+
+        std::atomic<int> received{0};
+        std::atomic<std::uint64_t> points{0};
+        boost::asio::io_context ioc;
+        auto guard = boost::asio::make_work_guard(ioc);
+        std::thread io_thread([&ioc]
+                              { ioc.run(); });
+        {
+            MQTTClient client(ioc, mcfg, [&](const std::string &gh, const std::string &body, const std::string &content_type)
+                              {
+                auto res = processor::MetricDecoder::decode(
+                    body, processor::MetricDecoder::detect(content_type, body), std::stoi(gh));
+                points.fetch_add(res.metrics.size(), std::memory_order_relaxed);
+                received.fetch_add(1, std::memory_order_release); });
+            client.start();
+
+            // Общая подписка получает только сообщения, опубликованные после SUBSCRIBE
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+
+            const auto started = Clock::now();
+            std::deque<mqtt::delivery_token_ptr> window;
+            for (int i = 0; i < kMessages; ++i)
+            {
+                if (window.size() >= 256)
+                {
+                    window.front()->wait();
+                    window.pop_front();
+                }
+                window.push_back(publisher.publish("greenhouse/" + std::to_string(i % kGreenhouses + 1) + "/metrics",
+                                                   payload.data(), payload.size(), cfg.mqtt.qos, false));
+            }
+            for (auto &tok : window)
+                tok->wait();
+
+            const auto deadline = Clock::now() + std::chrono::seconds(60);
+            while (received.load(std::memory_order_acquire) < kMessages && Clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            const double sec = std::chrono::duration<double>(Clock::now() - started).count();
+            const double rate = received.load() / sec;
+            if (consumers == 1)
+                base_rate = rate;
+
+            std::cout << std::fixed << std::setprecision(0)
+                      << "Consumers: " << std::setw(2) << consumers
+                      << "  received: " << received.load() << "/" << kMessages
+                      << "  " << std::setw(8) << rate << " msg/s  "
+                      << std::setw(10) << points.load() / sec << " points/s  x"
+                      << std::setprecision(2) << (base_rate > 0 ? rate / base_rate : 0.0)
+                      << "  per connection:";
+            for (auto n : client.consumer_messages())
+                std::cout << " " << n;
+            std::cout << std::endl;
+
+            client.stop();
+        }
+        guard.reset();
+        io_thread.join();
+    }
+
+    publisher.disconnect()->wait();
+    return 0;
+}
@@ -0,0 +1,14 @@
+// bench/Benchmarks.hpp
+#pragma once
+
+// Бенчмарки горячих путей сервера (smart_greenhouse_bench); каждый печатает
+// свою таблицу в stdout
+void benchRules();
+void benchThresholdBatch();
+void benchReplay();
+void benchCommandOutbox();
+void benchMetricPayloads();
+void benchLogging();
+
+// Нагрузочный тест приёма метрик: --mqtt [MESSAGES]
+int benchMqttConsumers(int argc, char *argv[]);
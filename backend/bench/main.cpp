@@ -0,0 +1,37 @@
+// bench/main.cpp
+#include "Benchmarks.hpp"
+#include "utils/Logger.hpp"
+#include "utils/TrantorLog.hpp"
+#include <iostream>
+#include <string>
+
+// Бенчмарки и инструменты без REST-сервера: запускаются из каталога
+// backend, как и сервер (config/, data/)
+int main(int argc, char *argv[])
+{
+    INIT_LOGGER_DEFAULT_SG();
+    utils_sg::attachTrantorLogging();
+
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (command.empty())
+    {
+        std::cout << "Running benchmarks…\n"
+                  << std::endl;
+        benchRules();
+        benchThresholdBatch();
+        benchReplay();
+        benchCommandOutbox();
+        benchMetricPayloads();
+        benchLogging();
+        return 0;
+    }
+    if (command == "--mqtt")
+        return benchMqttConsumers(argc, argv);
+
+    std::cerr << "Usage: " << argv[0] << " [option]\n"
+              << "Options:\n"
+              << "  (none)   Run performance benchmarks\n"
+              << "  --mqtt [MESSAGES]\n"
+              << "           Load test of metrics consumers against the configured broker\n";
+    return 1;
+}
@@ -4,12 +4,14 @@
 #include "utils/Logger.hpp"
 #include "utils/PasswordHasher.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <map>
 #include <optional>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 
 // Специальный тип исключения для конфига
@@ -19,6 +21,20 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+// Буфер команд MQTT-клиента на время без связи с брокером
+struct OfflineBufferConfig
+{
+    int capacity = 1000; // Команд в буфере; при переполнении вытесняются старые; 0 — без буфера
+    int drain_rate = 50; // Команд в секунду при разборе буфера после подключения
+    std::map<std::string, int> max_age{{"default", 60}}; // Сек от постановки команды по её type; старше — не отправляется
+
+    int max_age_for(const std::string &type) const
+    {
+        auto it = max_age.find(type);
+        return it != max_age.end() ? it->second : max_age.at("default");
+    }
+};
+
 // Улучшенная структура конфигурации MQTT
 struct MQTTConfig
 {
@@ -34,6 +50,12 @@ struct MQTTConfig
     std::string will_message = "disconnected";   // Текст LWT-сообщения
     int will_qos = 1;           // QoS для LWT (по умолчанию 1)
     bool will_retained = true; // Флаг retained для LWT
+    int max_inflight = 64;     // Публикаций без ответа брокера одновременно; остальные ждут в очереди клиента
+    int version = 4;           // Уровень протокола: 4 — MQTT 3.1.1, 5 — MQTT 5
+    int topic_alias_max = 32;  // MQTT 5: алиасов топиков команд на подключение (не больше, чем разрешит брокер)
+    int consumers = 1;         // Подключений, принимающих метрики; больше 1 — MQTT 5 и общая подписка $share
+    std::string share_group = "greenhouse-backend"; // Группа общей подписки на метрики
+    OfflineBufferConfig offline;
 };
 
 struct DatabaseConfig
@@ -41,6 +63,93 @@ struct DatabaseConfig
     std::string path = "data/greenhouse.db";
 };
 
+// UDP-приём метрик в line protocol (`gh=1,subtype=temperature value=21.3 1700000000000`)
+struct UdpIngestConfig
+{
+    bool enabled = false;
+    std::string bind = "0.0.0.0";
+    int port = 8089;
+    size_t batch = 64;             // Датаграмм за один recvmmsg
+    size_t datagram_size = 1500;   // Максимальный размер датаграммы
+    int recv_buffer = 4 * 1024 * 1024; // SO_RCVBUF
+    std::string precision = "ms";  // Единицы метки времени: s, ms, us, ns
+};
+
+// Фильтр записи метрик (deadband / минимальный интервал / heartbeat).
+// Пустой subtype или gh_id <= 0 — любое значение.
+struct IngestFilterConfig
+{
+    int gh_id = -1;
+    std::string subtype;
+    double abs_deadband = 0.0; // Не сохранять, если |Δ| <= abs_deadband
+    double rel_deadband = 0.0; // Не сохранять, если |Δ| <= rel_deadband * |последнее|
+    int min_interval = 0;      // Не сохранять чаще, чем раз в N секунд
+    int max_silence = 0;       // Сохранять не реже, чем раз в N секунд (0 — выкл.)
+};
+
+// Квота приёма для теплицы: token bucket + политика переполнения
+struct IngestQuotaConfig
+{
+    int gh_id = -1;
+    double rate = 0.0;             // Точек в секунду (0 — без ограничения)
+    double burst = 0.0;            // Размер корзины (0 — равен rate; при квоте не меньше 1)
+    std::string overflow = "shed"; // shed — отбрасывать, sample — оставлять каждую N-ю
+    int sample_every = 10;
+};
+
+// Справедливое планирование записи между теплицами (deficit round robin)
+struct IngestFairnessConfig
+{
+    size_t quantum = 500;             // Точек одной теплицы за раунд DRR
+    size_t gh_queue_capacity = 50000; // Очередь одной теплицы (сверх — отбрасывается)
+    IngestQuotaConfig defaults;       // Квота для теплиц без явной настройки
+    std::vector<IngestQuotaConfig> greenhouses;
+};
+
+// Отбрасывание повторов по порядковому номеру (seq) от датчика
+struct IngestDedupConfig
+{
+    bool enabled = true;
+    std::int64_t restart_gap = 1024; // Откат seq на столько и больше считается перезапуском датчика
+};
+
+// Настройки очереди приёма метрик (MQTT / HTTP / UDP)
+struct IngestConfig
+{
+    size_t queue_capacity = 200000;     // Максимум точек, ожидающих записи в БД
+    size_t max_commit_points = 10000;   // Максимум точек в одной транзакции
+    size_t max_request_points = 100000; // Максимум точек в одном HTTP-запросе
+    int retry_after = 1;                // Значение Retry-After (сек) при переполнении
+    UdpIngestConfig udp;
+    std::vector<IngestFilterConfig> filters;
+    IngestFairnessConfig fairness;
+    IngestDedupConfig dedup;
+};
+
+// Настройки исполнения правил автоматизации
+struct RulesConfig
+{
+    int misfire_grace = 300;    // Пропущенное (пока сервер был выключен) срабатывание выполняется, если опоздание не больше N сек
+    int duplicate_window = 300; // Команда, совпадающая с состоянием устройства, не повторяется N сек (0 — повторять всегда)
+    int ack_timeout = 30;       // Команда без подтверждения устройства (topics.ack) дольше N сек считается просроченной
+};
+
+// Очередь исходящих команд (хранится в БД до подтверждения брокером)
+struct OutboxConfig
+{
+    int max_in_flight = 32;   // Публикаций без подтверждения одновременно (на все теплицы)
+    int retry_initial = 1;    // Первая пауза перед повтором, сек; далее удваивается
+    int retry_max = 60;       // Предел паузы перед повтором, сек
+    int ack_timeout = 30;     // Публикация без ответа дольше N сек считается неудачной
+    int retention_hours = 24; // Доставленные команды хранятся N часов
+};
+
+// Журнал: очередь записей перед фоновым потоком записи
+struct LoggingConfig
+{
+    std::string overflow = "block"; // Очередь заполнена: block — ждать, drop — отбросить, count — отбросить и записать число потерь
+    bool deferred = false;          // Вызовы с числовыми аргументами форматирует фоновый поток
+};
 
 struct AdminUser
 {
@@ -52,6 +161,10 @@ struct Config
 {
     MQTTConfig mqtt;
     DatabaseConfig db;
+    IngestConfig ingest;
+    RulesConfig rules;
+    OutboxConfig outbox;
+    LoggingConfig logging;
     AdminUser admin;
 };
 
@@ -81,6 +194,10 @@ public:
         Config cfg;
         parseMQTT(root, cfg.mqtt);
         parseDatabase(root, cfg.db);
+        parseIngest(root, cfg.ingest);
+        parseRules(root, cfg.rules);
+        parseOutbox(root, cfg.outbox);
+        parseLogging(root, cfg.logging);
         parseAdmin(root, cfg.admin);
 
         logLoaded(cfg);
@@ -198,6 +315,22 @@ private:
         m.password = getOr<std::string>(n, "password", "");
         m.keep_alive = validateKeep(getOr<int>(n, "keep_alive", 60));
         m.clean_session = getOr<bool>(n, "clean_session", true);
+        m.max_inflight = std::max(1, getOr<int>(n, "max_inflight", m.max_inflight));
+        const auto version = getOr<std::string>(n, "version", "3.1.1");
+        if (version == "5")
+            m.version = 5;
+        else if (version != "3.1.1")
+            throw ConfigError("Unsupported MQTT version: " + version);
+        m.topic_alias_max = std::clamp(getOr<int>(n, "topic_alias_max", m.topic_alias_max), 0, 65535);
+        m.consumers = std::clamp(getOr<int>(n, "consumers", m.consumers), 1, 64);
+        if (m.consumers > 1 && m.version < 5)
+        {
+            LOG_WARN_SG("MQTT consumers > 1 require shared subscriptions, switching to MQTT 5");
+            m.version = 5;
+        }
+        m.share_group = getOr<std::string>(n, "share_group", m.share_group);
+        if (m.share_group.empty() || m.share_group.find_first_of("/+#") != std::string::npos)
+            throw ConfigError("Invalid MQTT share_group");
 
         if (auto topicsNode = n["topics"]; topicsNode && topicsNode.IsMap())
         {
@@ -217,6 +350,17 @@ private:
         }
         if (!m.topics.count("command") || !m.topics.count("metrics"))
             throw ConfigError("Required MQTT topics missing");
+
+        if (auto o = n["offline"]; o && o.IsMap())
+        {
+            m.offline.capacity = std::max(0, getOr<int>(o, "capacity", m.offline.capacity));
+            m.offline.drain_rate = std::max(1, getOr<int>(o, "drain_rate", m.offline.drain_rate));
+            if (auto ages = o["max_age"]; ages && ages.IsMap())
+            {
+                for (auto it = ages.begin(); it != ages.end(); ++it)
+                    m.offline.max_age[it->first.as<std::string>()] = std::max(1, it->second.as<int>());
+            }
+        }
     }
 
     static void parseDatabase(const YAML::Node &root, DatabaseConfig &db)
@@ -227,6 +371,153 @@ private:
         }
     }
 
+    static IngestQuotaConfig parseQuota(const YAML::Node &n, const IngestQuotaConfig &def)
+    {
+        IngestQuotaConfig q = def;
+        q.gh_id = getOr<int>(n, "gh_id", -1);
+        q.rate = std::max(0.0, getOr<double>(n, "rate", def.rate));
+        q.burst = std::max(0.0, getOr<double>(n, "burst", def.burst));
+        q.overflow = getOr<std::string>(n, "overflow", def.overflow);
+        q.sample_every = std::max(1, getOr<int>(n, "sample_every", def.sample_every));
+        if (q.overflow != "shed" && q.overflow != "sample")
+        {
+            LOG_WARN_SG("Invalid ingest overflow policy {} -> shed", q.overflow);
+            q.overflow = "shed";
+        }
+        if (q.burst == 0.0)
+            q.burst = q.rate;
+        // Точка стоит одного токена: корзина меньше 1 (rate < 1/с) не пропустила бы ничего
+        if (q.rate > 0.0 && q.burst < 1.0)
+            q.burst = 1.0;
+        return q;
+    }
+
+    static void parseIngest(const YAML::Node &root, IngestConfig &in)
+    {
+        auto n = root["ingest"];
+        if (!n || !n.IsMap())
+            return;
+
+        in.queue_capacity = getOr<size_t>(n, "queue_capacity", in.queue_capacity);
+        in.max_commit_points = getOr<size_t>(n, "max_commit_points", in.max_commit_points);
+        in.max_request_points = getOr<size_t>(n, "max_request_points", in.max_request_points);
+        in.retry_after = getOr<int>(n, "retry_after", in.retry_after);
+
+        if (in.queue_capacity == 0 || in.max_commit_points == 0)
+        {
+            LOG_WARN_SG("Invalid ingest queue sizes -> defaults");
+            in.queue_capacity = IngestConfig{}.queue_capacity;
+            in.max_commit_points = IngestConfig{}.max_commit_points;
+        }
+        if (in.retry_after < 1)
+            in.retry_after = 1;
+
+        if (auto u = n["udp"]; u && u.IsMap())
+        {
+            auto &udp = in.udp;
+            udp.enabled = getOr<bool>(u, "enabled", udp.enabled);
+            udp.bind = getOr<std::string>(u, "bind", udp.bind);
+            udp.port = validatePort(getOr<int>(u, "port", udp.port));
+            udp.batch = std::clamp<size_t>(getOr<size_t>(u, "batch", udp.batch), 1, 1024);
+            udp.datagram_size = std::clamp<size_t>(getOr<size_t>(u, "datagram_size", udp.datagram_size), 64, 65507);
+            udp.recv_buffer = getOr<int>(u, "recv_buffer", udp.recv_buffer);
+            udp.precision = getOr<std::string>(u, "precision", udp.precision);
+            if (udp.precision != "s" && udp.precision != "ms" &&
+                udp.precision != "us" && udp.precision != "ns")
+            {
+                LOG_WARN_SG("Invalid udp precision {} -> default ms", udp.precision);
+                udp.precision = "ms";
+            }
+        }
+
+        if (auto f = n["filters"]; f && f.IsSequence())
+        {
+            for (const auto &item : f)
+            {
+                IngestFilterConfig fc;
+                fc.gh_id = getOr<int>(item, "gh_id", fc.gh_id);
+                fc.subtype = getOr<std::string>(item, "subtype", fc.subtype);
+                fc.abs_deadband = std::max(0.0, getOr<double>(item, "abs_deadband", fc.abs_deadband));
+                fc.rel_deadband = std::max(0.0, getOr<double>(item, "rel_deadband", fc.rel_deadband));
+                fc.min_interval = std::max(0, getOr<int>(item, "min_interval", fc.min_interval));
+                fc.max_silence = std::max(0, getOr<int>(item, "max_silence", fc.max_silence));
+                in.filters.push_back(std::move(fc));
+            }
+        }
+
+        if (auto fr = n["fairness"]; fr && fr.IsMap())
+        {
+            auto &f = in.fairness;
+            f.quantum = std::max<size_t>(1, getOr<size_t>(fr, "quantum", f.quantum));
+            f.gh_queue_capacity = std::max<size_t>(1, getOr<size_t>(fr, "gh_queue_capacity", f.gh_queue_capacity));
+            if (auto d = fr["default"]; d && d.IsMap())
+                f.defaults = parseQuota(d, f.defaults);
+            if (auto g = fr["greenhouses"]; g && g.IsSequence())
+            {
+                for (const auto &item : g)
+                {
+                    auto q = parseQuota(item, f.defaults);
+                    if (q.gh_id <= 0)
+                    {
+                        LOG_WARN_SG("Ingest quota without gh_id ignored");
+                        continue;
+                    }
+                    f.greenhouses.push_back(std::move(q));
+                }
+            }
+        }
+
+        if (auto d = n["dedup"]; d && d.IsMap())
+        {
+            in.dedup.enabled = getOr<bool>(d, "enabled", in.dedup.enabled);
+            in.dedup.restart_gap = getOr<std::int64_t>(d, "restart_gap", in.dedup.restart_gap);
+            if (in.dedup.restart_gap <= 64)
+            {
+                LOG_WARN_SG("Invalid dedup restart_gap {} -> 1024", in.dedup.restart_gap);
+                in.dedup.restart_gap = 1024;
+            }
+        }
+    }
+
+    static void parseRules(const YAML::Node &root, RulesConfig &r)
+    {
+        auto n = root["rules"];
+        if (!n || !n.IsMap())
+            return;
+
+        r.misfire_grace = std::max(0, getOr<int>(n, "misfire_grace", r.misfire_grace));
+        r.duplicate_window = std::max(0, getOr<int>(n, "duplicate_window", r.duplicate_window));
+        r.ack_timeout = std::max(1, getOr<int>(n, "ack_timeout", r.ack_timeout));
+    }
+
+    static void parseOutbox(const YAML::Node &root, OutboxConfig &o)
+    {
+        auto n = root["outbox"];
+        if (!n || !n.IsMap())
+            return;
+
+        o.max_in_flight = std::max(1, getOr<int>(n, "max_in_flight", o.max_in_flight));
+        o.retry_initial = std::max(1, getOr<int>(n, "retry_initial", o.retry_initial));
+        o.retry_max = std::max(o.retry_initial, getOr<int>(n, "retry_max", o.retry_max));
+        o.ack_timeout = std::max(1, getOr<int>(n, "ack_timeout", o.ack_timeout));
+        o.retention_hours = std::max(0, getOr<int>(n, "retention_hours", o.retention_hours));
+    }
+
+    static void parseLogging(const YAML::Node &root, LoggingConfig &l)
+    {
+        auto n = root["logging"];
+        if (!n || !n.IsMap())
+            return;
+
+        l.overflow = getOr<std::string>(n, "overflow", l.overflow);
+        if (l.overflow != "block" && l.overflow != "drop" && l.overflow != "count")
+        {
+            LOG_WARN_SG("Invalid logging overflow policy {} -> block", l.overflow);
+            l.overflow = "block";
+        }
+        l.deferred = getOr<bool>(n, "deferred", l.deferred);
+    }
+
     static void parseAdmin(const YAML::Node &root, AdminUser &a)
     {
         auto n = root["admin"];
@@ -249,10 +540,15 @@ private:
     {
         LOG_INFO_SG("=== Loaded Config ===");
         LOG_INFO_SG(
-            "[MQTT] Broker={}, ClientId={}, QoS={}, User={}, Keep={}, Clean={}",
-            c.mqtt.broker, c.mqtt.client_id, static_cast<int>(c.mqtt.qos),
+            "[MQTT] Broker={}, ClientId={}, Version={}, QoS={}, User={}, Keep={}, Clean={}, MaxInflight={}, "
+            "TopicAliasMax={}, Consumers={}, ShareGroup={}",
+            c.mqtt.broker, c.mqtt.client_id, c.mqtt.version == 5 ? "5" : "3.1.1", static_cast<int>(c.mqtt.qos),
             c.mqtt.username.empty() ? "-" : "*", c.mqtt.keep_alive,
-            c.mqtt.clean_session);
+            c.mqtt.clean_session, c.mqtt.max_inflight, c.mqtt.topic_alias_max,
+            c.mqtt.consumers, c.mqtt.share_group);
+        LOG_INFO_SG("[MQTT] Offline buffer: Capacity={}, DrainRate={}/s, MaxAge(default)={} s, types with own MaxAge={}",
+                    c.mqtt.offline.capacity, c.mqtt.offline.drain_rate,
+                    c.mqtt.offline.max_age.at("default"), c.mqtt.offline.max_age.size() - 1);
         for (const auto &topic : c.mqtt.topics)
         {
             LOG_INFO_SG("Topic {}: {}", topic.first, topic.second);
@@ -260,6 +556,41 @@ private:
 
         LOG_INFO_SG("[DB] Path={}", c.db.path);
 
+        LOG_INFO_SG("[Ingest] Capacity={}, CommitPoints={}, RequestPoints={}, RetryAfter={}",
+                    c.ingest.queue_capacity, c.ingest.max_commit_points,
+                    c.ingest.max_request_points, c.ingest.retry_after);
+        if (c.ingest.udp.enabled)
+        {
+            LOG_INFO_SG("[Ingest] UDP {}:{}, Batch={}, Precision={}",
+                        c.ingest.udp.bind, c.ingest.udp.port,
+                        c.ingest.udp.batch, c.ingest.udp.precision);
+        }
+        LOG_INFO_SG("[Ingest] Fairness quantum={}, gh_capacity={}, default rate={}/s burst={} {}",
+                    c.ingest.fairness.quantum, c.ingest.fairness.gh_queue_capacity,
+                    c.ingest.fairness.defaults.rate, c.ingest.fairness.defaults.burst,
+                    c.ingest.fairness.defaults.overflow);
+        for (const auto &q : c.ingest.fairness.greenhouses)
+        {
+            LOG_INFO_SG("[Ingest] Quota gh={}, rate={}/s, burst={}, overflow={}",
+                        q.gh_id, q.rate, q.burst, q.overflow);
+        }
+        LOG_INFO_SG("[Ingest] Dedup={}, RestartGap={}",
+                    c.ingest.dedup.enabled, c.ingest.dedup.restart_gap);
+        for (const auto &f : c.ingest.filters)
+        {
+            LOG_INFO_SG("[Ingest] Filter gh={}, subtype={}, abs={}, rel={}, min={}s, silence={}s",
+                        f.gh_id, f.subtype.empty() ? "*" : f.subtype, f.abs_deadband,
+                        f.rel_deadband, f.min_interval, f.max_silence);
+        }
+
+        LOG_INFO_SG("[Rules] MisfireGrace={}s, DuplicateWindow={}s, AckTimeout={}s",
+                    c.rules.misfire_grace, c.rules.duplicate_window, c.rules.ack_timeout);
+        LOG_INFO_SG("[Outbox] MaxInFlight={}, Retry={}..{}s, AckTimeout={}s, Retention={}h",
+                    c.outbox.max_in_flight, c.outbox.retry_initial, c.outbox.retry_max,
+                    c.outbox.ack_timeout, c.outbox.retention_hours);
+
+        LOG_INFO_SG("[Logging] Overflow={}, Deferred={}", c.logging.overflow, c.logging.deferred);
+
         LOG_INFO_SG("[Admin] User={}, Hash={}", c.admin.username,
                  c.admin.password_hash.empty() ? "-" : "*");
 
@@ -13,6 +13,8 @@ class ComponentController : public HttpController<ComponentController> {
     ADD_METHOD_TO(ComponentController::create, "/api/Components", Post);
     ADD_METHOD_TO(ComponentController::update, "/api/Components/{gh_id}", Put);
     ADD_METHOD_TO(ComponentController::remove, "/api/Component/{gh_id}", Delete);
+    ADD_METHOD_TO(ComponentController::get_state, "/api/Components/{comp_id}/state", Get);
+    ADD_METHOD_TO(ComponentController::get_states, "/api/greenhouses/{gh_id}/actuators/state", Get);
    
     METHOD_LIST_END
 
@@ -22,6 +24,8 @@ class ComponentController : public HttpController<ComponentController> {
     void create(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
     void update(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int gh_id);
     void remove(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int gh_id);
+    void get_state(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int comp_id);
+    void get_states(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int gh_id);
 };
 
 }  // namespace api
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+namespace api {
+
+class IngestController : public HttpController<IngestController> {
+  public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(IngestController::ingest,    "/api/ingest",       Post);
+    ADD_METHOD_TO(IngestController::get_stats, "/api/ingest/stats", Get);
+    METHOD_LIST_END
+
+    // Обработчики
+    void ingest(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
+    void get_stats(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
+
+};
+
+}  // namespace api
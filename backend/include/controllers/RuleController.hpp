@@ -14,6 +14,9 @@ public:
   ADD_METHOD_TO(RuleController::delete_rule,            "/api/rules/{rule_id}",        Delete);
   ADD_METHOD_TO(RuleController::get_rules_by_greenhouse,"/api/greenhouses/{gh_id}/rules", Get);
   ADD_METHOD_TO(RuleController::toggle_rule,            "/api/rules/{rule_id}/toggle", Post);
+  ADD_METHOD_TO(RuleController::get_stats,              "/api/rules/engine/stats",     Get);
+  ADD_METHOD_TO(RuleController::get_ack_stats,          "/api/rules/engine/acks",      Get);
+  ADD_METHOD_TO(RuleController::replay_rules,           "/api/rules/replay",           Post);
   METHOD_LIST_END
 
   // Обработчики
@@ -23,6 +26,9 @@ public:
   void delete_rule(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int rule_id);
   void get_rules_by_greenhouse(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int gh_id);
   void toggle_rule(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback, int rule_id);
+  void get_stats(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
+  void get_ack_stats(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
+  void replay_rules(const HttpRequestPtr &req, std::function<void(const HttpResponsePtr &)> &&callback);
 
 };
 
@@ -80,6 +80,12 @@ namespace db
          *
          * Автоматически выполняет ROLLBACK при разрушении, если транзакция
          * не была явно зафиксирована методом commit().
+         *
+         * Соединение одно на процесс, поэтому транзакция держит его мьютекс
+         * от BEGIN до COMMIT/ROLLBACK: запросы других потоков через
+         * prepare_statement/execute_sql/execute_statement ждут её конца и не
+         * попадают внутрь чужой транзакции, а BEGIN другого потока — не
+         * внутрь уже начатой.
          */
         class Transaction
         {
@@ -96,8 +102,8 @@ namespace db
 
             Transaction(const Transaction &) = delete;
             Transaction &operator=(const Transaction &) = delete;
-            Transaction(Transaction &&) = default;
-            Transaction &operator=(Transaction &&) = default;
+            Transaction(Transaction &&) = delete;
+            Transaction &operator=(Transaction &&) = delete;
 
             /**
              * @brief Фиксирует транзакцию
@@ -119,6 +125,7 @@ namespace db
 
         private:
             std::shared_ptr<Database> db_;   ///< Владеющий указатель на БД через Singleton
+            std::unique_lock<std::recursive_mutex> lock_; ///< Соединение занято до конца транзакции
             bool success_;   ///< Флаг успешного начала транзакции
             bool committed_; ///< Флаг фиксации транзакции
         };
@@ -241,10 +248,24 @@ namespace db
          */
         sqlite3_int64 get_last_insert_rowid() const;
 
+        /**
+         * @brief Занимает соединение на время чтения курсором
+         *
+         * Запросы, строки которых читаются через sqlite3_step напрямую,
+         * держат блокировку от prepare до последней строки: иначе шаги
+         * выполняются внутри чужой Transaction на этом же соединении и
+         * видят её незафиксированные строки.
+         */
+        std::unique_lock<std::recursive_mutex> lock() const
+        {
+            return std::unique_lock<std::recursive_mutex>(db_mutex_);
+        }
+
     private:
         sqlite3 *db_;                 ///< Указатель на соединение с базой данных SQLite
         std::string db_path_;         ///< Путь к файлу базы данных
-        mutable std::mutex db_mutex_; ///< Мьютекс для обеспечения потокобезопасности операций с БД
+        /// Мьютекс соединения; рекурсивный — Transaction держит его, пока её поток выполняет запросы
+        mutable std::recursive_mutex db_mutex_;
 
         /**
          * @brief Открывает соединение с базой данных
@@ -264,6 +285,16 @@ namespace db
          */
         bool create_indexes();
 
+        /**
+         * @brief Создает служебные таблицы, появившиеся после версии схемы 1.0.0
+         *
+         * Выполняется при каждом запуске (CREATE TABLE IF NOT EXISTS),
+         * поэтому подходит и для новых, и для существующих баз. Там же
+         * добавляются недостающие столбцы таблицы rules.
+         * @return true при успешном создании, false при ошибке
+         */
+        bool create_service_tables();
+
         /**
          * @brief Настраивает параметры базы данных
          *
@@ -340,6 +371,8 @@ namespace db
         friend class MetricManager;
         friend class RuleManager;
         friend class UserManager;
+        friend class IngestStateManager;
+        friend class CommandOutboxManager;
     };
 
 }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "db/Database.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace db
+{
+
+    /**
+     * @brief Команда в исходящей очереди
+     */
+    struct OutboxRecord
+    {
+        std::int64_t id = -1;
+        int gh_id = -1;
+        std::string payload;
+        std::int64_t created_at = 0;
+    };
+
+    /**
+     * @brief Отметка о доставке команды
+     */
+    struct OutboxDelivery
+    {
+        std::int64_t id = -1;
+        int attempts = 0; ///< Публикаций с момента загрузки в очередь
+        std::int64_t delivered_at = 0;
+    };
+
+    /**
+     * @class CommandOutboxManager
+     * @brief Хранение исходящих команд до подтверждения доставки брокером
+     */
+    class CommandOutboxManager
+    {
+    public:
+        CommandOutboxManager() : db_(Database::getInstance()) {}
+
+        /**
+         * @brief Добавляет команды в очередь одной транзакцией
+         * @param commands Пары (gh_id, payload) в порядке отправки
+         * @param created_at Время постановки (Unix, сек)
+         * @return Идентификаторы команд в том же порядке (пустой вектор при ошибке)
+         */
+        std::vector<std::int64_t> enqueue(const std::vector<std::pair<int, std::string>> &commands,
+                                          std::int64_t created_at);
+
+        /**
+         * @brief Загружает недоставленные команды
+         * @return Команды в порядке постановки (пустой вектор при ошибке)
+         */
+        std::vector<OutboxRecord> load_pending();
+
+        /**
+         * @brief Отмечает команды доставленными одной транзакцией
+         * @return true, если все отметки сохранены
+         */
+        bool mark_delivered(const std::vector<OutboxDelivery> &deliveries);
+
+        /**
+         * @brief Удаляет доставленные команды старше заданного времени
+         * @return Число удалённых записей или -1 при ошибке
+         */
+        int prune_delivered(std::int64_t before);
+
+    private:
+        std::shared_ptr<Database> db_;
+    };
+
+} // namespace db
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "db/Database.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace db
+{
+
+    /**
+     * @brief Отметка приёма ряда: старший порядковый номер и окно последних 64 номеров
+     */
+    struct SeqWatermark
+    {
+        int gh_id = -1;
+        std::string subtype;
+        std::int64_t high_seq = -1;  ///< Наибольший принятый seq
+        std::uint64_t seen_mask = 0; ///< Бит i — принят seq (high_seq - i)
+    };
+
+    /**
+     * @class IngestStateManager
+     * @brief Хранение служебного состояния приёма метрик между перезапусками
+     */
+    class IngestStateManager
+    {
+    public:
+        IngestStateManager() : db_(Database::getInstance()) {}
+
+        /**
+         * @brief Загружает все сохранённые отметки приёма
+         * @return Вектор отметок (пустой при ошибке)
+         */
+        std::vector<SeqWatermark> load_watermarks();
+
+        /**
+         * @brief Сохраняет (вставляет или обновляет) отметки одной транзакцией
+         * @param marks Отметки изменившихся рядов
+         * @return true, если все отметки сохранены
+         */
+        bool save_watermarks(const std::vector<SeqWatermark> &marks);
+
+    private:
+        std::shared_ptr<Database> db_;
+    };
+
+} // namespace db
@@ -6,6 +6,8 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <functional>
 #include <chrono>
 #include <memory>
 
@@ -21,6 +23,9 @@ namespace db
     class MetricManager
     {
     public:
+        /// Обработчик записи при обходе: время, тип, значение (строки действительны только в вызове)
+        using MetricVisitor = std::function<void(std::string_view ts, std::string_view subtype, double value)>;
+
         /**
          * @brief Конструктор менеджера метрик.
          * @param db Ссылка на объект Database для выполнения операций с базой.
@@ -102,6 +107,22 @@ namespace db
                                                                    const std::string &from_time = "",
                                                                    const std::string &to_time = "");
 
+        /**
+         * @brief Обойти метрики теплицы по возрастанию времени без загрузки в память.
+         *
+         * Записи передаются по одной прямо из курсора SQLite — для
+         * воспроизведения истории за длительные периоды. Соединение с БД
+         * занято (Database::lock) на всё время обхода.
+         * @param gh_id Идентификатор теплицы.
+         * @param from_time (необязательно) Строка времени начала диапазона.
+         * @param to_time (необязательно) Строка времени конца диапазона.
+         * @param visit Обработчик записи.
+         * @return Число обработанных записей или -1 при ошибке запроса.
+         */
+        std::int64_t scan_by_greenhouse(int gh_id,
+                                        const std::string &from_time,
+                                        const std::string &to_time,
+                                        const MetricVisitor &visit);
         ///@}
 
         /** @name Агрегатные функции */
@@ -5,9 +5,22 @@
 #include <vector>
 #include <optional>
 #include <memory>
+#include <functional>
+#include <cstdint>
+#include <unordered_map>
 
 namespace db
 {
+    /**
+     * @brief Сохранённое состояние порогового правила
+     */
+    struct RuleStateRecord
+    {
+        int rule_id = -1;
+        bool active = false;     ///< Правило во включённом состоянии
+        std::int64_t since = -1; ///< Время последней смены состояния (unix)
+    };
+
     /**
      * @class RuleManager
      * @brief Класс для управления правилами в базе данных
@@ -18,6 +31,22 @@ namespace db
     class RuleManager
     {
     public:
+        /**
+         * @brief Обработчик изменения правила
+         *
+         * Вызывается после успешного create/update/remove/toggle_rule в потоке,
+         * выполнившем изменение. rule — актуальное состояние правила,
+         * std::nullopt — правило удалено.
+         */
+        using ChangeListener = std::function<void(int rule_id, const std::optional<Rule> &rule)>;
+
+        /**
+         * @brief Регистрирует обработчик изменений правил (общий для всех экземпляров)
+         *
+         * @param listener Обработчик; должен быть быстрым и не обращаться к RuleManager
+         */
+        static void add_change_listener(ChangeListener listener);
+
         /**
          * @brief Конструктор с параметром
          * @param db Ссылка на объект базы данных
@@ -104,9 +133,61 @@ namespace db
          */
         bool is_rule_active(int rule_id);
 
+        // Срабатывания правил по расписанию
+
+        /**
+         * @brief Запоминает время последнего срабатывания правила
+         *
+         * @param rule_id Идентификатор правила
+         * @param fired_at Плановое время срабатывания (unix)
+         * @return true, если запись выполнена
+         */
+        bool record_fired(int rule_id, std::int64_t fired_at);
+
+        /**
+         * @brief Возвращает время последнего срабатывания всех правил
+         *
+         * @return Отображение rule_id -> unix-время (пустое при ошибке)
+         */
+        std::unordered_map<int, std::int64_t> get_last_fired();
+
+        // Состояние пороговых правил
+
+        /**
+         * @brief Сохраняет состояния правил одной транзакцией
+         *
+         * @param states Новые состояния (вставка или обновление)
+         * @return true, если запись выполнена
+         */
+        bool save_rule_states(const std::vector<RuleStateRecord> &states);
+
+        /**
+         * @brief Возвращает сохранённые состояния всех правил
+         *
+         * @return Вектор состояний (пустой при ошибке)
+         */
+        std::vector<RuleStateRecord> get_rule_states();
+
     private:
         std::shared_ptr<Database> db_;
 
+        /**
+         * @brief Оповещает обработчики об изменении правила
+         *
+         * @param rule_id Идентификатор правила
+         * @param removed true, если правило удалено (иначе оно перечитывается из БД)
+         */
+        void notify_changed(int rule_id, bool removed);
+
+        /**
+         * @brief Привязывает off_threshold, debounce_sec, min_dwell_sec, expression
+         *
+         * @param stmt Подготовленный запрос
+         * @param first Номер параметра для off_threshold (далее подряд)
+         * @param rule Источник значений
+         */
+        void bind_dynamics(sqlite3_stmt *stmt, int first, const Rule &rule) const;
+
         /**
          * @brief Парсит результат SQL-запроса в объект Rule
          *
@@ -3,6 +3,7 @@
 
 #include <nlohmann/json.hpp>
 #include <json/json.h>
+#include <cstdint>
 #include <string>
 
 /**
@@ -18,6 +19,7 @@ struct Metric
     std::string ts;      ///< Временная метка измерения.
     std::string subtype; ///< Тип метрики ('temperature', 'humidity' и т.д.).
     double value = 0.0;  ///< Значение измерения.
+    std::int64_t seq = -1; ///< Порядковый номер от датчика (только при приёме, в БД не хранится).
 
     Metric() = default;
 
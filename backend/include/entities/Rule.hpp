@@ -26,6 +26,10 @@ std::optional<std::string> time_spec; ///< Временная специфика
 bool enabled = true;           ///< Флаг активности правила.
 std::string created_at;        ///< Дата создания (формат ISO 8601).
 std::string updated_at;        ///< Дата последнего обновления (формат ISO 8601).
+std::optional<double> off_threshold; ///< Порог выключения (гистерезис); без него — обратное условие.
+int debounce_sec = 0;          ///< Сколько секунд условие должно держаться до смены состояния.
+int min_dwell_sec = 0;         ///< Минимальное время между сменами состояния (сек).
+std::optional<std::string> expression; ///< Условие-выражение вместо operator/threshold (например, "avg(temperature, 5m) > 28").
 
 Rule() = default;
 
@@ -60,6 +64,10 @@ Json::Value toJson() const
     if (operator_)   obj["operator"] = *operator_;
     if (threshold)   obj["threshold"] = *threshold;
     if (time_spec)   obj["time_spec"] = *time_spec;
+    if (off_threshold) obj["off_threshold"] = *off_threshold;
+    obj["debounce_sec"] = debounce_sec;
+    obj["min_dwell_sec"] = min_dwell_sec;
+    if (expression)  obj["expression"] = *expression;
 
     return obj;
 }
@@ -81,6 +89,10 @@ static Rule fromJson(const Json::Value &json)
     if (!json["operator"].isNull())   r.operator_ = json["operator"].asString();
     if (!json["threshold"].isNull())  r.threshold = json["threshold"].asDouble();
     if (!json["time_spec"].isNull())  r.time_spec = json["time_spec"].asString();
+    if (!json["off_threshold"].isNull()) r.off_threshold = json["off_threshold"].asDouble();
+    r.debounce_sec = json.get("debounce_sec", 0).asInt();
+    r.min_dwell_sec = json.get("min_dwell_sec", 0).asInt();
+    if (!json["expression"].isNull()) r.expression = json["expression"].asString();
 
     return r;
 }
@@ -103,13 +115,17 @@ j = {
     {"kind",         r.kind},
     {"enabled",      r.enabled},
     {"created_at",   r.created_at},
-    {"updated_at",   r.updated_at}  
+    {"updated_at",   r.updated_at},
+    {"debounce_sec", r.debounce_sec},
+    {"min_dwell_sec", r.min_dwell_sec}
 };
 
 // Опциональные поля
 if (r.operator_)   j["operator"]   = *r.operator_;
 if (r.threshold)   j["threshold"]  = *r.threshold;
 if (r.time_spec)   j["time_spec"]  = *r.time_spec;
+if (r.off_threshold) j["off_threshold"] = *r.off_threshold;
+if (r.expression)  j["expression"] = *r.expression;
 }
 
 /**
@@ -134,6 +150,10 @@ j.at("updated_at")  .get_to(r.updated_at);
 if (j.contains("operator"))   r.operator_   = j["operator"].get<std::string>();
 if (j.contains("threshold"))  r.threshold   = j["threshold"].get<double>();
 if (j.contains("time_spec"))  r.time_spec   = j["time_spec"].get<std::string>();
+if (j.contains("off_threshold")) r.off_threshold = j["off_threshold"].get<double>();
+r.debounce_sec  = j.value("debounce_sec", 0);
+r.min_dwell_sec = j.value("min_dwell_sec", 0);
+if (j.contains("expression")) r.expression = j["expression"].get<std::string>();
 }
 
 #endif // RULE_HPP
\ No newline at end of file
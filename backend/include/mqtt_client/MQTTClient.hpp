@@ -8,10 +8,17 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
+#include <mutex>
 #include <string>
 #include <regex>
+#include <unordered_map>
 #include <atomic>
+#include <vector>
 
 #include "config/ConfigLoader.hpp"
 #include "utils/Logger.hpp"
@@ -20,15 +27,92 @@
  * @brief MQTTClient — асинхронный клиент для работы с MQTT
  *
  * Использует Paho MQTT C++ и Boost.Asio для таймеров reconnect.
+ *
+ * Метрики принимают consumers подключений: при consumers > 1 все они
+ * (MQTT 5) подписаны на $share/<share_group>/<metrics> и брокер делит
+ * сообщения между ними. У каждого подключения свой поток Paho, поэтому
+ * MetricsHandler может вызываться из нескольких потоков одновременно.
+ * Команды, состояния и подтверждения идут через основное подключение.
+ *
+ * Подключение ведёт конечный автомат State: Disconnected → Connecting →
+ * Subscribing → Ready (и обратно в Disconnected при обрыве). Подписки
+ * отправляются одним пакетом SUBSCRIBE асинхронно — поток Paho не ждёт
+ * SUBACK и сразу доставляет сообщения, пришедшие после переподключения.
+ *
+ * В MQTT 5 топики команд публикуются с алиасами: полное имя топика
+ * уходит, пока брокер не подтвердит первую публикацию с алиасом, дальше —
+ * только номер алиаса. Алиасы сбрасываются при каждом подключении.
  */
 class MQTTClient : public virtual mqtt::callback,
                    public virtual mqtt::iaction_listener
 {
 public:
+    /// content_type — из свойств MQTT 5 (Content Type или user property
+    /// "content-type"); в MQTT 3.1.1 всегда пустой
     using MetricsHandler = std::function<void(const std::string &gh_id,
-                                              const std::string &payload)>;
+                                              const std::string &payload,
+                                              const std::string &content_type)>;
     using CommandHandler = std::function<void(const std::string &gh_id,
                                               const std::string &command)>;
+    /// Сообщение от устройств по дополнительному топику (topics.state, topics.ack, ...)
+    using TopicHandler = std::function<void(const std::string &gh_id,
+                                            const std::string &payload)>;
+    /// Итог публикации
+    enum class Delivery
+    {
+        Delivered, ///< Брокер подтвердил приём (для QoS 0 — сообщение отправлено)
+        Failed,    ///< Отклонено или не подтверждено — можно повторить
+        Expired    ///< Не отправлено: устарело в буфере или заменено более новой командой
+    };
+    using DeliveryHandler = std::function<void(Delivery result)>;
+
+    /// Команда для пакетной публикации
+    struct OutgoingCommand
+    {
+        std::string gh_id;
+        std::string command;
+        DeliveryHandler done;     ///< Может быть пустым
+        std::string type;         ///< Тип команды для offline.max_age; пустой — default
+        std::string replaces;     ///< Ключ в буфере без связи: заменяет команду теплицы с тем же ключом; пустой — не буферизуется
+        std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now(); ///< От него считается возраст
+    };
+
+    /// Состояние основного подключения
+    enum class State
+    {
+        Disconnected, ///< Нет связи, ждём reconnect
+        Connecting,   ///< CONNECT отправлен
+        Subscribing,  ///< Подключены, SUBSCRIBE отправлен, ждём SUBACK
+        Ready,        ///< Подписки действуют
+        Stopped       ///< stop(): переподключения не будет
+    };
+
+    /// Подключение к брокеру (на процесс; время — последнего переподключения)
+    struct ConnectionStats
+    {
+        State state = State::Disconnected; ///< Основного подключения
+        std::uint64_t connects = 0;        ///< Успешных подключений, включая дополнительные
+        double subscribe_ms = 0.0;         ///< От connected() до SUBACK
+        double first_message_ms = 0.0;     ///< От connected() до первого обработанного сообщения
+    };
+
+    static const char *state_name(State state);
+
+    /// Счётчики публикаций команд (на процесс)
+    struct PublishStats
+    {
+        std::uint64_t published = 0; ///< Подтверждено брокером
+        std::uint64_t failed = 0;    ///< Отклонено, не подтверждено или нет связи
+        std::uint64_t in_flight = 0; ///< Ждут ответа брокера сейчас
+        std::uint64_t queued = 0;    ///< Ждут места в окне max_inflight сейчас
+        std::uint64_t buffered = 0;  ///< Ждут в буфере без связи сейчас
+        std::uint64_t expired = 0;   ///< Устарели в буфере (offline.max_age)
+        std::uint64_t replaced = 0;  ///< Заменены в буфере более новой командой
+        std::uint64_t overflow = 0;  ///< Вытеснены из переполненного буфера
+        double last_ms = 0.0;        ///< От publish() до ответа брокера: последняя публикация
+        double avg_ms = 0.0;         ///< ... средняя
+        double max_ms = 0.0;         ///< ... наибольшая
+    };
 
     /**
      * @brief Конструктор
@@ -56,13 +140,60 @@ public:
     void stop();
 
     /**
-     * @brief Опубликовать команду
+     * @brief Опубликовать команду и дождаться ответа брокера (не дольше 3 с)
      * @param gh_id    Идентификатор теплицы
      * @param command  Текст команды
      */
     void publish_command(const std::string &gh_id,
                          const std::string &command);
 
+    /**
+     * @brief Опубликовать команды без ожидания подтверждения
+     *
+     * Команды встают в очередь клиента и публикуются в порядке очереди,
+     * пока без ответа брокера не больше max_inflight публикаций; следующая
+     * уходит по ответу на предыдущую. Итог каждой команды приходит в её
+     * done из потока Paho (или сразу, если публикация отклонена) — ровно
+     * один раз.
+     *
+     * Без связи с брокером команды ждут в буфере (mqtt.offline): после
+     * подключения он разбирается не быстрее drain_rate команд в секунду,
+     * новые команды встают за ним. Команда старше max_age своего типа
+     * или заменённая новой с тем же replaces завершается с Expired.
+     *
+     * В буфер попадают только команды с replaces: владелец, повторяющий
+     * команду (CommandOutbox), передаёт тот же ключ, и повтор заменяет
+     * копию в буфере, а не встаёт второй. Команда без replaces без связи
+     * сразу завершается с Failed, при связи — минует буфер.
+     */
+    void publish_commands(std::vector<OutgoingCommand> commands);
+
+    /// Опубликовать одну команду без ожидания подтверждения (см. publish_commands)
+    void publish_command_async(const std::string &gh_id,
+                               const std::string &command,
+                               DeliveryHandler done);
+
+    /// То же, итог — через std::future
+    std::future<bool> publish_command_async(const std::string &gh_id,
+                                            const std::string &command);
+
+    static PublishStats publish_stats();
+    static ConnectionStats connection_stats();
+
+    /// Принято сообщений с метриками по подключениям; [0] — основное
+    std::vector<std::uint64_t> consumer_messages() const;
+
+    /// Обработчик (пере)подключения к брокеру; вызывается из потока Paho
+    void set_connected_handler(std::function<void()> handler);
+
+    /**
+     * @brief Подписка на дополнительный топик из MQTTConfig::topics (до start())
+     * @param key     Ключ шаблона топика, например "state" или "ack"
+     * @param handler Обработчик сообщений; вызывается из потока Paho
+     * @return false, если шаблон с таким ключом не задан — подписки не будет
+     */
+    bool add_topic_handler(const std::string &key, TopicHandler handler);
+
     // === mqtt::callback ===
     void connected(const std::string &cause) override;
     void connection_lost(const std::string &cause) override;
@@ -74,8 +205,43 @@ public:
     void on_success(const mqtt::token &tok) override;
 
 private:
+    class DeliveryListener;
+    class ActionListener;
+    class Consumer;
+
+    /// Команда в очереди клиента: топик уже подставлен
+    struct QueuedPublish
+    {
+        std::string topic;
+        std::string payload;
+        DeliveryHandler done;
+        std::string replaces;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+
+    /// Итоги, собранные под pub_mutex_; сообщаются после его освобождения
+    using Results = std::vector<std::pair<DeliveryHandler, Delivery>>;
+
+    void drain();
+    void buffer_locked(QueuedPublish p, Results &results);
+    void expire_locked(Results &results);
+    void start_offline_drain();
+    void drain_offline();
+    void send(QueuedPublish p);
+    void on_published(bool delivered, std::chrono::steady_clock::time_point sent_at,
+                      DeliveryHandler done);
+
     void do_connect();
     void do_subscribe();
+    void on_subscribed(const mqtt::token &tok, bool ok);
+    std::vector<std::string> subscription_filters() const;
+    void set_state(State state);
+    bool dispatch_metrics(const std::string &topic, const std::string &payload,
+                          const std::string &content_type);
+    void dispatch_other(const std::string &topic, const std::string &payload);
+    void confirm_alias(const std::string &topic, std::uint64_t epoch);
+    mqtt::connect_options make_connect_options() const;
+    std::string metrics_filter() const;
     void schedule_reconnect();
     std::string resolve_topic(const std::string &tmpl,
                               const std::string &gh_id) const;
@@ -84,15 +250,48 @@ private:
     const MQTTConfig &cfg_;
     MetricsHandler metrics_cb_;
     CommandHandler command_cb_;
+    std::function<void()> connected_cb_;
     std::unique_ptr<mqtt::async_client> client_;
     mqtt::connect_options conn_opts_;
+    std::unique_ptr<ActionListener> subscribe_listener_;
+    std::atomic<State> state_{State::Disconnected};
+    std::chrono::steady_clock::time_point connected_at_; ///< Последний connected(), в потоке Paho
+    std::atomic<bool> awaiting_first_{false};          ///< Первое сообщение после connected() ещё не обработано
+    std::vector<std::unique_ptr<Consumer>> consumers_; ///< Дополнительные подключения для метрик
+    std::atomic<std::uint64_t> metrics_messages_{0};
     boost::asio::steady_timer reconnect_timer_;
     int reconnect_attempts_ = 0;
     const int max_backoff_ = 60;  
     std::atomic<bool> stopping_{false};
 
+    std::mutex pub_mutex_; ///< Защищает очередь и окно публикаций
+    std::deque<QueuedPublish> pub_queue_;
+    size_t pub_in_flight_ = 0;
+    bool draining_ = false;
+    std::deque<QueuedPublish> offline_; ///< Буфер на время без связи (защищён pub_mutex_)
+    bool offline_draining_ = false;     ///< Разбор буфера запланирован в io_context
+    boost::asio::steady_timer offline_timer_;
+
+    /// Алиас топика команд (MQTT 5); защищён pub_mutex_
+    struct TopicAlias
+    {
+        int id;
+        bool confirmed = false; ///< Брокер принял публикацию с полным именем и этим алиасом
+    };
+    std::unordered_map<std::string, TopicAlias> aliases_;
+    int alias_max_ = 0;          ///< Доступно алиасов в текущем подключении; 0 — без алиасов
+    std::uint64_t alias_epoch_ = 0; ///< Номер подключения, к которому относятся алиасы
+
     std::regex cmd_rx_;
     std::regex met_rx_;
+    /// Дополнительный топик: шаблон подписки и разбор gh_id
+    struct ExtraTopic
+    {
+        std::string filter;
+        std::regex rx;
+        TopicHandler handler;
+    };
+    std::vector<ExtraTopic> extra_topics_;
 
     static const char *rc_to_string(int rc)
     {
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace processor
+{
+
+    /**
+     * @brief Последнее известное состояние исполнительного устройства
+     */
+    struct ActuatorState
+    {
+        int comp_id = -1;
+        int gh_id = -1;
+        std::string commanded;         ///< Последняя отправленная команда ("on"/"off"; пусто — без состояния)
+        std::int64_t commanded_at = 0; ///< Когда отправлена (Unix, сек)
+        int rule_id = -1;              ///< Правило, отправившее команду
+        std::string reported;          ///< Последнее состояние, сообщённое устройством
+        std::int64_t reported_at = 0;  ///< Когда получено (Unix, сек)
+        std::uint64_t suppressed = 0;  ///< Подавлено повторных команд
+
+        /// Более свежее из отправленного и сообщённого состояний
+        const std::string &current() const noexcept
+        {
+            return !reported.empty() && reported_at >= commanded_at ? reported : commanded;
+        }
+
+        std::int64_t current_at() const noexcept
+        {
+            return !reported.empty() && reported_at >= commanded_at ? reported_at : commanded_at;
+        }
+    };
+
+    /**
+     * @class ActuatorStateCache
+     * @brief Состояния исполнительных устройств в памяти (по to_comp_id)
+     *
+     * Правило, условие которого выполняется, может снова и снова требовать
+     * то же состояние — несколько правил на одно устройство, перезапуск.
+     * Команда, совпадающая с текущим состоянием устройства, не публикуется,
+     * если это состояние установлено (отправлено или сообщено устройством)
+     * меньше window секунд назад; по истечении окна команда повторяется —
+     * на случай, если устройство её потеряло. Сообщённое устройством
+     * состояние, отличное от отправленного, снимает подавление сразу.
+     *
+     * Состояния не сохраняются: после перезапуска первая команда каждому
+     * устройству уходит всегда.
+     */
+    class ActuatorStateCache
+    {
+    public:
+        /// Получение единственного экземпляра (Singleton)
+        static ActuatorStateCache &instance();
+
+        /// Окно подавления повторов, сек (0 — не подавлять)
+        void set_window(std::int64_t seconds);
+
+        /**
+         * @brief Учесть команду устройству
+         *
+         * Пустое state — команда без известного результата (правило по
+         * расписанию): отправляется всегда, а состояние становится неизвестным.
+         * @return true — команду нужно отправить (она стала последней);
+         *         false — повтор текущего состояния в пределах окна
+         */
+        bool command(int gh_id, int comp_id, const std::string &state, int rule_id, std::int64_t now);
+
+        /// Учесть состояние, сообщённое устройством
+        void report(int gh_id, int comp_id, const std::string &state, std::int64_t now);
+
+        /// Состояние устройства или std::nullopt, если о нём ничего не известно
+        std::optional<ActuatorState> get(int comp_id) const;
+
+        /// Известные состояния устройств теплицы в порядке comp_id
+        std::vector<ActuatorState> by_greenhouse(int gh_id) const;
+
+        /// Подавлено команд всего
+        std::uint64_t suppressed() const;
+
+        ActuatorStateCache(const ActuatorStateCache &) = delete;
+        ActuatorStateCache &operator=(const ActuatorStateCache &) = delete;
+
+    private:
+        ActuatorStateCache() = default;
+
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<int, ActuatorState> states_;
+        std::int64_t window_ = 0;
+        std::uint64_t suppressed_ = 0;
+    };
+
+} // namespace processor
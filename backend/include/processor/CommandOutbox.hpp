@@ -0,0 +1,176 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "db/managers/CommandOutboxManager.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class CommandOutbox
+     * @brief Надёжная исходящая очередь команд правил
+     *
+     * Команда сначала записывается в таблицу command_outbox (в потоке
+     * вызывающего, как и остальные записи правил), затем публикуется
+     * асинхронно: срабатывание правила не ждёт сети, а обрыв связи
+     * с брокером не теряет команд. Доставленной команда считается после
+     * подтверждения брокером; отметки о доставке сохраняются пакетами.
+     *
+     * Очередь ведётся по теплицам, весь её учёт — в потоке io_context.
+     * Публикаций без ответа одновременно не больше max_in_flight на все
+     * теплицы, теплицы обслуживаются по кругу. Порядок команд одной теплицы
+     * сохраняется по схеме go-back-N: при неудаче или таймауте публикации
+     * все ещё не снятые с очереди команды теплицы отправляются заново после
+     * паузы (retry_initial, удваивается до retry_max). Повтор возможен —
+     * доставка «не менее одного раза», но последняя полученная устройством
+     * команда всегда последняя по порядку. После переподключения к брокеру
+     * пауза сбрасывается. Команду, которую публикатор признал устаревшей
+     * (Expired), очередь снимает без повторов.
+     */
+    class CommandOutbox
+    {
+    public:
+        /// Команда для постановки в очередь: (gh_id, payload)
+        using Command = std::pair<int, std::string>;
+
+        /// Итог публикации
+        enum class Result
+        {
+            Delivered, ///< Подтверждена брокером
+            Failed,    ///< Не доставлена — повторить
+            Expired    ///< Устарела или заменена — снять с очереди без повтора
+        };
+
+        /// Публикация команды; done вызывается ровно один раз из любого потока
+        struct Publish
+        {
+            int gh_id;
+            std::uint64_t key;   ///< Номер команды в очереди: один и тот же при повторах
+            std::string payload;
+            std::chrono::steady_clock::time_point enqueued_at; ///< Постановка в очередь (для возраста команды)
+            std::function<void(Result result)> done;
+        };
+
+        /// Публикация пакета команд, готовых к отправке за один проход очереди
+        using Publisher = std::function<void(std::vector<Publish> batch)>;
+
+        /// Счётчики очереди (на процесс)
+        struct Stats
+        {
+            std::uint64_t enqueued = 0;  ///< Поставлено команд
+            std::uint64_t delivered = 0; ///< Подтверждено брокером
+            std::uint64_t published = 0; ///< Публикаций, включая повторы
+            std::uint64_t failed = 0;    ///< Неудачных публикаций
+            std::uint64_t timeouts = 0;  ///< Публикаций без ответа за ack_timeout
+            std::uint64_t resends = 0;   ///< Возвратов очереди теплицы к началу (go-back-N)
+            std::uint64_t expired = 0;   ///< Сняты с очереди устаревшими, без доставки
+            std::uint64_t unsaved = 0;   ///< Команд, не записанных в БД (отправляются только из памяти)
+            std::uint64_t pending = 0;   ///< Ожидают доставки сейчас
+            std::uint64_t in_flight = 0; ///< Опубликованы и ждут ответа сейчас
+            double last_delivery_ms = 0.0; ///< От постановки до подтверждения, последняя команда
+        };
+
+        CommandOutbox(boost::asio::io_context &ioc, const OutboxConfig &cfg,
+                      db::CommandOutboxManager &store, Publisher publish);
+
+        CommandOutbox(const CommandOutbox &) = delete;
+        CommandOutbox &operator=(const CommandOutbox &) = delete;
+
+        /// Загрузка недоставленных команд из БД и запуск отправки (в потоке io_context)
+        void start();
+
+        /// Остановка таймеров; недоставленные команды остаются в БД
+        void stop();
+
+        /**
+         * @brief Постановка команд в очередь (любой поток)
+         *
+         * Команды записываются в БД одной транзакцией до возврата из метода.
+         * Если запись не удалась, команды всё равно отправляются, но
+         * перезапуск их не переживёт.
+         * @return true, если команды сохранены в БД
+         */
+        bool enqueue(std::vector<Command> commands);
+
+        /// Связь с брокером восстановлена: сбросить паузы и продолжить отправку (любой поток)
+        void resume();
+
+        static Stats stats();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::uint64_t key;   ///< Номер в памяти (id есть не у всех)
+            std::int64_t id;     ///< Строка в command_outbox; <= 0 — не сохранена
+            std::string payload;
+            Clock::time_point enqueued_at;
+            int attempts = 0;
+            bool acked = false;  ///< Подтверждена (или устарела) в текущем проходе, ждёт предыдущих
+            bool expired = false;
+        };
+
+        struct Queue
+        {
+            std::deque<Entry> entries;
+            size_t next = 0;             ///< Первая ещё не отправленная в текущем проходе
+            std::uint64_t generation = 0;///< Номер прохода; растёт при возврате к началу
+            unsigned failures = 0;       ///< Неудач подряд — для паузы
+            Clock::time_point retry_at{};///< До этого времени теплица не отправляет
+        };
+
+        /// Опубликованная команда, ждущая ответа
+        struct Inflight
+        {
+            int gh_id;
+            std::uint64_t generation;
+            std::uint64_t key;
+            Clock::time_point sent_at;
+        };
+
+        void append(int gh_id, std::int64_t id, std::string payload, Clock::time_point at);
+        void pump();
+        void send(int gh_id, Queue &q, std::vector<Publish> &batch);
+        void on_result(std::uint64_t seq, Result result);
+        void go_back(int gh_id, Queue &q);
+        void pop_acked(int gh_id, Queue &q);
+        void flush_delivered();
+        void arm_timer();
+        void on_timer();
+        void schedule_prune();
+        void sync_gauges();
+
+        boost::asio::io_context &ioc_;
+        OutboxConfig cfg_;
+        db::CommandOutboxManager &store_;
+        Publisher publish_;
+
+        // Состояние ниже — только в потоке io_context
+        std::map<int, Queue> queues_;
+        int cursor_ = 0;                 ///< Теплица, с которой начинается следующий круг
+        std::unordered_map<std::uint64_t, Inflight> inflight_;
+        std::uint64_t seq_ = 0;
+        std::uint64_t next_key_ = 0;
+        size_t pending_ = 0;
+        std::int64_t loaded_up_to_ = -1; ///< Команды с id не больше уже загружены из БД; -1 — загрузки ещё не было
+        std::vector<db::OutboxDelivery> delivered_;
+        bool flush_posted_ = false;
+        bool stopped_ = false;
+        boost::asio::steady_timer timer_;
+        Clock::time_point timer_at_ = Clock::time_point::max();
+        boost::asio::steady_timer prune_timer_;
+    };
+
+} // namespace processor
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace processor
+{
+
+    /**
+     * @struct LatencyHistogram
+     * @brief Гистограмма задержек с фиксированными границами корзин (мс)
+     */
+    struct LatencyHistogram
+    {
+        /// Верхние границы корзин; последняя корзина — всё, что больше
+        static constexpr std::array<double, 11> kBounds = {
+            10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+
+        std::array<std::uint64_t, kBounds.size() + 1> buckets{};
+        std::uint64_t count = 0;
+        double sum_ms = 0.0;
+        double max_ms = 0.0;
+
+        void add(double ms) noexcept;
+
+        /// Оценка квантиля сверху — граница корзины, в которую он попал (для последней — max_ms)
+        double quantile(double q) const noexcept;
+    };
+
+    /**
+     * @class CommandTracker
+     * @brief Сквозная задержка команд: от срабатывания правила до подтверждения устройства
+     *
+     * Каждая команда получает correlation id (поле "cid" в JSON команды).
+     * Устройство отвечает в топик topics.ack сообщением с тем же "cid";
+     * время от постановки команды до ответа попадает в гистограмму своей
+     * пары (теплица, устройство). Команда без ответа дольше timeout
+     * считается просроченной: она учитывается в счётчиках пары и в списке
+     * последних просрочек. В задержку входит и ожидание в CommandOutbox,
+     * поэтому обрыв связи с брокером тоже виден как просрочки.
+     *
+     * Ожидающие ответа команды хранятся только в памяти: ответы на
+     * команды, отправленные до перезапуска, считаются несопоставленными.
+     */
+    class CommandTracker
+    {
+    public:
+        /// Статистика пары (теплица, устройство)
+        struct Series
+        {
+            int gh_id = -1;
+            int comp_id = -1;
+            LatencyHistogram latency;
+            std::uint64_t failed = 0;    ///< Устройство ответило ошибкой
+            std::uint64_t timeouts = 0;  ///< Ответа не было за timeout
+        };
+
+        /// Просроченная команда
+        struct Timeout
+        {
+            std::string cid;
+            int gh_id = -1;
+            int comp_id = -1;
+            int rule_id = -1;
+            std::int64_t issued_at = 0; ///< Unix, сек
+        };
+
+        struct Snapshot
+        {
+            std::vector<Series> series;          ///< По (gh_id, comp_id)
+            std::vector<Timeout> recent_timeouts;///< Последние просрочки, новые в конце
+            std::uint64_t pending = 0;
+            std::uint64_t acked = 0;
+            std::uint64_t timed_out = 0;
+            std::uint64_t unmatched = 0;         ///< Ответы с неизвестным или просроченным cid
+            std::int64_t timeout_sec = 0;
+        };
+
+        /// Получение единственного экземпляра (Singleton)
+        static CommandTracker &instance();
+
+        /// Срок ответа устройства
+        void set_timeout(std::chrono::seconds timeout);
+
+        /// Зарегистрировать команду и получить её correlation id
+        std::string track(int gh_id, int comp_id, int rule_id);
+
+        /**
+         * @brief Учесть ответ устройства
+         * @param ok false — устройство сообщило, что команду выполнить не удалось
+         * @return false, если cid неизвестен (уже просрочен или до перезапуска)
+         */
+        bool ack(const std::string &cid, bool ok);
+
+        /// Перенести команды без ответа дольше timeout в просроченные
+        void sweep();
+
+        /// Текущая статистика (перед снимком выполняется sweep())
+        Snapshot snapshot();
+
+        CommandTracker(const CommandTracker &) = delete;
+        CommandTracker &operator=(const CommandTracker &) = delete;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Pending
+        {
+            int gh_id;
+            int comp_id;
+            int rule_id;
+            Clock::time_point issued;
+            std::int64_t issued_unix;
+        };
+
+        CommandTracker();
+        void sweep_locked(Clock::time_point now);
+
+        static constexpr size_t kMaxPending = 100000;
+        static constexpr size_t kRecentTimeouts = 100;
+
+        std::mutex mutex_;
+        std::string prefix_;   ///< Отличает cid разных запусков
+        std::uint64_t seq_ = 0;
+        Clock::duration timeout_ = std::chrono::seconds(30);
+        std::unordered_map<std::string, Pending> pending_;
+        std::deque<std::pair<Clock::time_point, std::string>> order_; ///< cid в порядке выдачи — для sweep
+        std::map<std::pair<int, int>, Series> series_;
+        std::deque<Timeout> recent_timeouts_;
+        std::uint64_t acked_ = 0;
+        std::uint64_t timed_out_ = 0;
+        std::uint64_t unmatched_ = 0;
+    };
+
+} // namespace processor
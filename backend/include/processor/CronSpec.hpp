@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace processor
+{
+
+    /**
+     * @class CronSpec
+     * @brief Расписание правила по времени (time_spec)
+     *
+     * Поддерживаемые формы:
+     * - `HH:MM[:SS]` — ежедневно (секунды игнорируются, как и раньше);
+     * - `YYYY-MM-DD HH:MM:SS` — однократно;
+     * - cron из 5 полей `мин час день месяц день_недели` со списками,
+     *   диапазонами и шагами (`*`, `1,5`, `8-18`, `0-30/10`), именами
+     *   (`jan`, `mon`), а также `@hourly`, `@daily`, `@weekly`, `@monthly`,
+     *   `@yearly`. Если ограничены и день месяца, и день недели, достаточно
+     *   совпадения любого из них (как в cron).
+     *
+     * Часовой пояс задаётся префиксом `TZ=<зона> ` (или `CRON_TZ=`):
+     * `local` (по умолчанию, с учётом перехода на летнее время), `UTC`,
+     * `UTC+03:00` / `UTC-5`. Именованные зоны IANA не поддерживаются.
+     */
+    class CronSpec
+    {
+    public:
+        /**
+         * @brief Разбор спецификации
+         * @param spec Строка time_spec
+         * @param error Куда записать причину ошибки (необязательно)
+         */
+        static std::optional<CronSpec> parse(std::string_view spec, std::string *error = nullptr);
+
+        /**
+         * @brief Ближайшее срабатывание строго после t
+         * @param t Unix-время
+         * @return Unix-время срабатывания или std::nullopt, если их больше не будет
+         */
+        std::optional<std::int64_t> next_after(std::int64_t t) const;
+
+        /// Однократное расписание
+        bool once() const noexcept { return once_at_.has_value(); }
+
+    private:
+        CronSpec() = default;
+
+        bool parse_fields(std::string_view fields, std::string *error);
+        bool day_matches(int mday, int wday) const noexcept;
+
+        std::uint64_t minutes_ = 0;  ///< Биты 0..59
+        std::uint32_t hours_ = 0;    ///< Биты 0..23
+        std::uint32_t mdays_ = 0;    ///< Биты 1..31
+        std::uint16_t months_ = 0;   ///< Биты 1..12
+        std::uint8_t wdays_ = 0;     ///< Биты 0..6 (0 — воскресенье)
+        bool mday_any_ = true;
+        bool wday_any_ = true;
+
+        bool local_ = true;             ///< Локальное время системы
+        std::int32_t utc_offset_ = 0;   ///< Смещение от UTC (сек), если не local_
+        std::optional<std::int64_t> once_at_;
+    };
+
+} // namespace processor
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "db/managers/IngestStateManager.hpp"
+#include "entities/Metric.hpp"
+#include "processor/SeriesKey.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class IngestDedup
+     * @brief Отбрасывание повторных доставок по порядковому номеру датчика
+     *
+     * Для каждого ряда хранит наибольший принятый seq и битовую маску
+     * последних 64 номеров (как окно анти-повтора в IPsec): проверка и
+     * отметка — O(1) без обращений к БД. Номер старше окна считается
+     * устаревшим повтором, откат на restart_gap и больше (или seq = 0 за
+     * пределами окна) — перезапуском датчика: счёт начинается заново.
+     * Точки без seq не проверяются.
+     *
+     * Изменения применяются пакетно: после успешной записи в БД commit()
+     * возвращает отметки изменившихся рядов для сохранения. Если пакет так
+     * и не записан (ServerProcessor повторяет запись несколько раз), он
+     * потерян; rollback() возвращает окна в прежнее состояние, чтобы новая
+     * отправка тех же точек не была отброшена как повтор.
+     * Вызывается только из потока IngestQueue, поэтому состояние без блокировок.
+     */
+    class IngestDedup
+    {
+    public:
+        /// Снимок счётчиков
+        struct Stats
+        {
+            std::uint64_t checked = 0;    ///< Точки с seq
+            std::uint64_t duplicates = 0; ///< Отброшены как уже принятые
+            std::uint64_t stale = 0;      ///< Отброшены как старше окна
+            std::uint64_t restarts = 0;   ///< Обнаружено перезапусков датчиков
+        };
+
+        static constexpr std::int64_t kWindow = 64;
+
+        explicit IngestDedup(const IngestDedupConfig &cfg);
+
+        /// Восстановление окон после перезапуска сервера
+        void load(const std::vector<db::SeqWatermark> &marks);
+
+        /**
+         * @brief Удаляет из пакета повторно доставленные точки
+         * @param metrics Пакет (порядок оставшихся точек сохраняется)
+         */
+        void apply(std::vector<Metric> &metrics);
+
+        /**
+         * @brief Фиксирует изменения после успешной записи пакета
+         * @param out Куда добавить отметки изменившихся рядов
+         */
+        void commit(std::vector<db::SeqWatermark> &out);
+
+        /// Откатывает изменения окон с момента последнего commit()
+        void rollback();
+
+        /// Счётчики (общие для процесса)
+        static Stats stats();
+
+    private:
+        struct Window
+        {
+            std::int64_t high = -1;
+            std::uint64_t mask = 0;
+            bool dirty = false;
+        };
+
+        enum class Verdict
+        {
+            Accept,
+            Duplicate,
+            Stale
+        };
+
+        /// Прежнее состояние ряда, изменённого с последнего commit()
+        struct Undo
+        {
+            const SeriesKey *key;
+            Window *window; ///< Узлы unordered_map не перемещаются при рехешировании
+            Window before;
+        };
+
+        Verdict check(Window &w, std::int64_t seq);
+
+        const IngestDedupConfig &cfg_;
+        std::unordered_map<SeriesKey, Window, SeriesKeyHash> series_;
+        std::vector<Undo> undo_;
+    };
+
+} // namespace processor
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "entities/Metric.hpp"
+#include "processor/SeriesKey.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class IngestFilter
+     * @brief Отбор метрик для записи в БД: deadband, минимальный интервал, heartbeat
+     *
+     * Для каждого ряда хранит последнее сохранённое значение и время и по
+     * правилам из `ingest.filters` решает, нужно ли сохранять новую точку.
+     * Правило выбирается по наибольшей специфичности: gh_id+subtype,
+     * затем subtype, затем gh_id, затем правило без условий.
+     * «Последнее сохранённое» меняется пакетно, как окна IngestDedup: после
+     * успешной записи в БД — commit(), иначе rollback() возвращает прежние
+     * значения, чтобы повторная отправка тех же точек не была отброшена
+     * как уже сохранённая.
+     * Вызывается только из потока IngestQueue, поэтому состояние без блокировок.
+     */
+    class IngestFilter
+    {
+    public:
+        /// Снимок счётчиков фильтра
+        struct Stats
+        {
+            std::uint64_t kept = 0;       ///< Точки, отправленные в БД
+            std::uint64_t dropped = 0;    ///< Точки, отброшенные фильтром
+            std::uint64_t heartbeats = 0; ///< Из kept: сохранены только по max_silence
+        };
+
+        explicit IngestFilter(const std::vector<IngestFilterConfig> &rules);
+
+        /**
+         * @brief Удаляет из пакета точки, которые не нужно сохранять
+         * @param metrics Пакет (порядок оставшихся точек сохраняется)
+         */
+        void apply(std::vector<Metric> &metrics);
+
+        /// Фиксирует состояние рядов после успешной записи пакета
+        void commit();
+
+        /// Откатывает состояние рядов с момента последнего commit()
+        void rollback();
+
+        /// Счётчики (общие для процесса)
+        static Stats stats();
+
+    private:
+        struct SeriesState
+        {
+            const IngestFilterConfig *rule = nullptr;
+            bool has_stored = false;
+            double value = 0.0;
+            std::int64_t ts = 0;
+            bool dirty = false; ///< Изменён с последнего commit()
+        };
+
+        /// Прежнее состояние ряда, изменённого с последнего commit()
+        struct Undo
+        {
+            SeriesState *state; ///< Узлы unordered_map не перемещаются при рехешировании
+            SeriesState before;
+        };
+
+        const IngestFilterConfig *match(const SeriesKey &key) const;
+        bool keep(const SeriesState &state, const Metric &m, std::int64_t ts, bool &heartbeat) const;
+
+        const std::vector<IngestFilterConfig> &rules_;
+        std::unordered_map<SeriesKey, SeriesState, SeriesKeyHash> series_;
+        std::vector<Undo> undo_;
+    };
+
+} // namespace processor
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "entities/Metric.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class IngestQueue
+     * @brief Единая очередь приёма метрик с групповой фиксацией в БД
+     *
+     * Все каналы (MQTT, HTTP, UDP) после декодирования кладут пакеты сюда.
+     * Точки раскладываются по очередям теплиц; на входе каждой теплицы
+     * действует token bucket, сверх квоты точки отбрасываются или
+     * прореживаются. Фоновый поток собирает группу до max_commit_points
+     * по deficit round robin (не больше quantum точек теплицы за раунд)
+     * и записывает её одной транзакцией через BatchSink, поэтому одна
+     * «шумная» теплица не задерживает запись остальных.
+     * Ёмкость ограничена числом точек; при переполнении try_push
+     * возвращает false, а push блокируется (обратное давление на брокер).
+     */
+    class IngestQueue
+    {
+    public:
+        /// Запись пакета в хранилище; false — пакет не сохранён.
+        /// Sink может удалить из пакета точки, которые не нужно сохранять.
+        using BatchSink = std::function<bool(std::vector<Metric> &)>;
+
+        /// Счётчики одной теплицы
+        struct GreenhouseStats
+        {
+            int gh_id = -1;
+            std::uint64_t accepted = 0; ///< Поставлено в очередь
+            std::uint64_t shed = 0;     ///< Отброшено сверх квоты / ёмкости
+            std::uint64_t sampled = 0;  ///< Из accepted: пропущено выборкой сверх квоты
+            size_t queued = 0;          ///< Ожидает записи
+        };
+
+        /// Снимок счётчиков очереди
+        struct Stats
+        {
+            std::uint64_t accepted_batches = 0;
+            std::uint64_t accepted_points = 0;
+            std::uint64_t saturated_batches = 0;
+            std::uint64_t stored_points = 0;
+            std::uint64_t failed_points = 0;
+            std::uint64_t commits = 0;
+            std::uint64_t shed_points = 0;
+            size_t pending_points = 0;
+            size_t capacity = 0;
+            std::vector<GreenhouseStats> greenhouses;
+        };
+
+        /// Получение единственного экземпляра (Singleton)
+        static IngestQueue &instance();
+
+        /**
+         * @brief Запуск потока записи
+         * @param cfg Настройки очереди
+         * @param sink Функция записи пакета (вызывается из потока очереди)
+         */
+        void start(const IngestConfig &cfg, BatchSink sink);
+
+        /// Остановка: дописывает накопленное и завершает поток
+        void stop();
+
+        /// Запущена ли очередь
+        bool running() const noexcept { return running_.load(std::memory_order_acquire); }
+
+        /**
+         * @brief Неблокирующая постановка пакета
+         * @return false, если очередь переполнена или остановлена
+         */
+        bool try_push(std::vector<Metric> &&batch);
+
+        /**
+         * @brief Блокирующая постановка пакета (ждёт освобождения места)
+         * @return false, если очередь остановлена
+         */
+        bool push(std::vector<Metric> &&batch);
+
+        /// Рекомендуемая задержка повтора для клиентов при переполнении (сек)
+        int retry_after() const noexcept { return cfg_.retry_after; }
+
+        /// Максимум точек в одном внешнем запросе
+        size_t max_request_points() const noexcept { return cfg_.max_request_points; }
+
+        Stats stats() const;
+
+        IngestQueue(const IngestQueue &) = delete;
+        IngestQueue &operator=(const IngestQueue &) = delete;
+
+    private:
+        IngestQueue() = default;
+        ~IngestQueue() { stop(); }
+
+        using Clock = std::chrono::steady_clock;
+
+        /// Очередь и квота одной теплицы
+        struct GhQueue
+        {
+            std::deque<Metric> points;
+            size_t deficit = 0;
+            bool active = false;
+            const IngestQuotaConfig *quota = nullptr;
+            double tokens = 0.0;
+            Clock::time_point refilled{};
+            std::uint64_t overflow_seen = 0;
+            std::uint64_t accepted = 0;
+            std::uint64_t shed = 0;
+            std::uint64_t sampled = 0;
+        };
+
+        bool fits(size_t n) const noexcept;
+        void enqueue(std::vector<Metric> &&batch);
+        GhQueue &queue_for(int gh_id);
+        bool admit(GhQueue &q, Clock::time_point now);
+        void take_group(std::vector<Metric> &group);
+        void run();
+
+        IngestConfig cfg_;
+        BatchSink sink_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+        std::unordered_map<int, GhQueue> queues_;
+        std::deque<int> active_; ///< Теплицы с непустой очередью в порядке обхода DRR
+        size_t pending_points_ = 0;
+        std::atomic<bool> running_{false};
+        std::thread worker_;
+
+        std::atomic<std::uint64_t> accepted_batches_{0};
+        std::atomic<std::uint64_t> accepted_points_{0};
+        std::atomic<std::uint64_t> saturated_batches_{0};
+        std::atomic<std::uint64_t> stored_points_{0};
+        std::atomic<std::uint64_t> failed_points_{0};
+        std::atomic<std::uint64_t> commits_{0};
+        std::atomic<std::uint64_t> shed_points_{0};
+    };
+
+} // namespace processor
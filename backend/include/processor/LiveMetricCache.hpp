@@ -0,0 +1,44 @@
+#pragma once
+
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "entities/Metric.hpp"
+#include "processor/SeriesKey.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class LiveMetricCache
+     * @brief Последнее принятое значение каждого ряда (до фильтров записи)
+     *
+     * Обновляется потоком IngestQueue для каждого пакета, поэтому видит и
+     * точки, которые фильтры не стали сохранять. Используется правилами и
+     * REST-запросом последней метрики вместо обращения к SQLite.
+     */
+    class LiveMetricCache
+    {
+    public:
+        /// Получение единственного экземпляра (Singleton)
+        static LiveMetricCache &instance();
+
+        /// Учесть пакет принятых метрик (более старые метки не перетирают новые)
+        void update(const std::vector<Metric> &metrics);
+
+        /// Последнее значение ряда или std::nullopt, если ряд ещё не встречался
+        std::optional<Metric> latest(int gh_id, const std::string &subtype) const;
+
+        LiveMetricCache(const LiveMetricCache &) = delete;
+        LiveMetricCache &operator=(const LiveMetricCache &) = delete;
+
+    private:
+        LiveMetricCache() = default;
+
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<SeriesKey, Metric, SeriesKeyHash> latest_;
+    };
+
+} // namespace processor
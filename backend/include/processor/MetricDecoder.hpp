@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "entities/Metric.hpp"
+
+namespace processor
+{
+
+    /**
+     * @brief Формат полезной нагрузки с метриками
+     */
+    enum class PayloadFormat
+    {
+        Json,  ///< JSON-объект или массив объектов
+        Binary ///< Компактные little-endian записи (см. MetricDecoder)
+    };
+
+    /**
+     * @brief Результат декодирования пакета метрик
+     */
+    struct DecodeResult
+    {
+        std::vector<Metric> metrics; ///< Прошедшие валидацию метрики
+        size_t rejected = 0;         ///< Количество отброшенных записей
+        size_t truncated = 0;        ///< Записи сверх max_points: не разбирались и не входят в rejected
+        bool malformed = false;      ///< Пакет целиком не удалось разобрать
+    };
+
+    /**
+     * @class MetricDecoder
+     * @brief Общий декодер и валидатор метрик для всех каналов приёма (MQTT, HTTP)
+     *
+     * JSON: объект или массив объектов вида
+     * `{"gh_id": 1, "subtype": "temperature", "value": 21.5, "ts": "2024-01-01 12:00:00"}`.
+     * Поля `gh_id` и `ts` необязательны: по умолчанию берутся теплица из топика/запроса
+     * и текущее время. Необязательное `seq` (или `msg_id`) — порядковый номер
+     * датчика для отбрасывания повторных доставок (см. IngestDedup).
+     *
+     * Binary: заголовок `SGM\x01`, затем записи по 16 байт (little-endian):
+     * `u16 gh_id | u16 subtype | u32 ts (unix, 0 = сейчас) | f64 value`.
+     *
+     * Binary compact (для узких каналов): заголовок
+     * `SGM\x02 | u16 gh_id (0 = из топика) | u32 base_ts (unix, 0 = сейчас)`,
+     * затем записи по 8 байт: `u16 subtype | u16 dt (сек от base_ts) | f32 value`.
+     *
+     * Числовой subtype записывается в БД десятичной строкой. Версия бинарного
+     * формата определяется по заголовку, Content-Type у обеих один.
+     */
+    class MetricDecoder
+    {
+    public:
+        static constexpr std::string_view kBinaryContentType = "application/x-sg-metrics";
+        static constexpr char kBinaryMagic[4] = {'S', 'G', 'M', '\x01'};
+        static constexpr size_t kBinaryHeaderSize = sizeof(kBinaryMagic);
+        static constexpr size_t kBinaryRecordSize = 16;
+        static constexpr char kCompactMagic[4] = {'S', 'G', 'M', '\x02'};
+        static constexpr size_t kCompactHeaderSize = sizeof(kCompactMagic) + 6;
+        static constexpr size_t kCompactRecordSize = 8;
+
+        /**
+         * @brief Определяет формат по Content-Type, а при его отсутствии — по сигнатуре
+         * @param content_type Значение Content-Type (может быть пустым)
+         * @param payload Тело сообщения
+         */
+        static PayloadFormat detect(std::string_view content_type, std::string_view payload);
+
+        /**
+         * @brief Декодирует и валидирует пакет метрик
+         * @param payload Тело сообщения
+         * @param format Формат тела
+         * @param default_gh_id Теплица по умолчанию (из топика или запроса), -1 если нет
+         * @param max_points Максимум записей в пакете (0 — без ограничения);
+         *        остальные только считаются в truncated
+         */
+        static DecodeResult decode(std::string_view payload,
+                                   PayloadFormat format,
+                                   int default_gh_id,
+                                   size_t max_points = 0);
+
+        /**
+         * @brief Проверяет метрику перед постановкой в очередь записи
+         */
+        static bool validate(const Metric &metric);
+
+        /**
+         * @brief Форматирует unix-время в формат БД "YYYY-MM-DD HH:MM:SS"
+         */
+        static std::string format_timestamp(std::int64_t unix_seconds);
+
+        /**
+         * @brief Быстрый разбор метки "YYYY-MM-DD HH:MM:SS" в секунды
+         *
+         * Без mktime и часовых поясов: результат пригоден для сравнения
+         * и вычисления интервалов между метками одного формата.
+         */
+        static std::optional<std::int64_t> parse_timestamp(std::string_view ts);
+
+    private:
+        static DecodeResult decode_json(std::string_view payload, int default_gh_id, size_t max_points);
+        static DecodeResult decode_binary(std::string_view payload, size_t max_points);
+        static DecodeResult decode_compact(std::string_view payload, int default_gh_id, size_t max_points);
+    };
+
+} // namespace processor
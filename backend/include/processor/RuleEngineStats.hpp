@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace processor
+{
+
+    /**
+     * @class RuleEngineStats
+     * @brief Время работы движка правил (GET /api/rules/engine/stats)
+     *
+     * Проход — периодическая проверка ServerProcessor::processActiveRules
+     * (сверка индекса, advance, просроченные подтверждения). Пакет — одно
+     * исполнение смен состояния fireThresholdRules; он делится на разделы
+     * по теплицам (сохранение состояний и постановка команд теплицы), и для
+     * пакета запоминается самый медленный раздел.
+     * Записывает только поток io_context; читать можно из любого потока.
+     */
+    class RuleEngineStats
+    {
+    public:
+        /// Снимок счётчиков
+        struct Stats
+        {
+            std::uint64_t ticks = 0;          ///< Проходы периодической проверки
+            double last_tick_ms = 0.0;        ///< Длительность последнего прохода
+            double max_tick_ms = 0.0;         ///< Наибольшая длительность прохода
+
+            std::uint64_t batches = 0;        ///< Исполненные пакеты смен состояния
+            std::uint64_t partitions = 0;     ///< Разделы (теплицы) в них
+            std::uint64_t triggers = 0;       ///< Смены состояния в них
+            double last_batch_ms = 0.0;       ///< Длительность последнего пакета
+            double max_batch_ms = 0.0;        ///< Наибольшая длительность пакета
+            int slowest_gh = -1;              ///< Самый медленный раздел последнего пакета
+            double slowest_partition_ms = 0.0;
+            int max_partition_gh = -1;        ///< Самый медленный раздел за всё время
+            double max_partition_ms = 0.0;
+        };
+
+        /// Завершён проход периодической проверки
+        static void record_tick(double ms);
+
+        /**
+         * @brief Завершён пакет смен состояния
+         * @param ms Длительность пакета
+         * @param partitions Число теплиц в пакете
+         * @param triggers Число смен состояния
+         * @param slowest_gh Самый медленный раздел
+         * @param slowest_ms Его длительность
+         */
+        static void record_batch(double ms, std::uint64_t partitions, std::uint64_t triggers,
+                                 int slowest_gh, double slowest_ms);
+
+        /// Счётчики (общие для процесса)
+        static Stats stats();
+    };
+
+} // namespace processor
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "processor/WindowAggregate.hpp"
+
+namespace processor
+{
+
+    /// Операнд выражения: агрегат ряда теплицы правила за окно
+    struct ExprOperand
+    {
+        std::string subtype;
+        Aggregate agg = Aggregate::Last;
+        std::int32_t window = 0; ///< Длина окна (сек); 0 — последнее значение
+    };
+
+    /**
+     * @class RuleExpression
+     * @brief Условие правила, скомпилированное в байт-код стековой машины
+     *
+     * Синтаксис (ключевые слова без учёта регистра):
+     * - ряд: `temperature` или `"12"` (subtype в теплице правила);
+     * - агрегаты: `avg(ряд, 5m)`, `min`, `max`, `rate` (ед./сек), `count`,
+     *   `last(ряд)`; длительность — число с суффиксом s, m, h или d;
+     * - арифметика `+ - * /`, сравнения `> >= < <= == = !=`;
+     * - логика `AND`/`&&`, `OR`/`||`, `NOT`/`!`, скобки.
+     *
+     * Пример: `avg(temperature, 5m) > 28 AND humidity < 60`.
+     *
+     * Отсутствие данных (пустое окно) даёт «неизвестно» (NaN), которое
+     * распространяется по трёхзначной логике: `false AND x` — ложь,
+     * `true OR x` — истина, иначе результат неизвестен.
+     */
+    class RuleExpression
+    {
+    public:
+        static constexpr size_t kMaxOperands = 32; ///< Предел различных операндов
+        static constexpr size_t kMaxStack = 64;    ///< Предел глубины стека вычисления
+        static constexpr size_t kMaxNesting = 64;  ///< Предел вложенности скобок и унарных операторов (глубина рекурсии парсера)
+        static constexpr size_t kMaxLength = 1024; ///< Предел длины текста выражения
+
+        /**
+         * @brief Компиляция выражения
+         * @param text Текст выражения
+         * @param error Куда записать причину ошибки (необязательно)
+         */
+        static std::optional<RuleExpression> compile(std::string_view text, std::string *error = nullptr);
+
+        /// Операнды в порядке номеров, используемых байт-кодом
+        const std::vector<ExprOperand> &operands() const noexcept { return operands_; }
+
+        /**
+         * @brief Вычисление
+         * @param values values[i] — значение operands()[i] (NaN — нет данных)
+         * @return 1 или 0 для логического результата, число для арифметического,
+         *         NaN — результат неизвестен
+         */
+        double eval(const double *values) const noexcept;
+
+    private:
+        enum class Op : std::uint8_t
+        {
+            Const,
+            Load,
+            Neg,
+            Add,
+            Sub,
+            Mul,
+            Div,
+            Gt,
+            Ge,
+            Lt,
+            Le,
+            Eq,
+            Ne,
+            And,
+            Or,
+            Not
+        };
+
+        struct Instr
+        {
+            Op op;
+            std::uint32_t arg = 0; ///< Load: номер операнда
+            double imm = 0.0;      ///< Const: значение
+        };
+
+        friend class ExprParser;
+
+        std::vector<Instr> code_;
+        std::vector<ExprOperand> operands_;
+    };
+
+} // namespace processor
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "db/managers/RuleManager.hpp"
+#include "entities/Metric.hpp"
+#include "entities/Rule.hpp"
+#include "processor/RuleExpression.hpp"
+#include "processor/SeriesKey.hpp"
+#include "processor/ThresholdKernel.hpp"
+#include "processor/WindowAggregate.hpp"
+
+namespace processor
+{
+
+    /// Оператор сравнения порогового правила
+    enum class CompareOp : std::uint8_t
+    {
+        Gt,
+        Ge,
+        Lt,
+        Le,
+        Eq,
+        Ne
+    };
+
+    /**
+     * @brief Пороговое правило в форме для быстрой проверки
+     *
+     * Строки Rule (kind, operator) разбираются один раз при загрузке или
+     * изменении правила; проверка сводится к switch по перечислению и
+     * сравнению чисел. Правила по времени ведёт RuleScheduler.
+     */
+    struct CompiledRule
+    {
+        int rule_id = -1;
+        int gh_id = -1;
+        int to_comp_id = -1;
+        std::uint32_t series = 0; ///< Интернированный ряд (gh_id, from_comp_id)
+        CompareOp op = CompareOp::Gt;
+        bool has_off = false;       ///< Задан порог выключения (гистерезис)
+        double threshold = 0.0;
+        double off_threshold = 0.0;
+        std::int32_t debounce = 0;  ///< Сколько условие должно держаться до смены состояния (сек)
+        std::int32_t min_dwell = 0; ///< Минимальное время между сменами состояния (сек)
+        bool expression = false;    ///< Условие задано выражением; проверяется его результат (≠ 0)
+
+        /// Выполняется ли условие включения
+        bool matches(double value) const noexcept
+        {
+            switch (op)
+            {
+            case CompareOp::Gt: return value > threshold;
+            case CompareOp::Ge: return value >= threshold;
+            case CompareOp::Lt: return value < threshold;
+            case CompareOp::Le: return value <= threshold;
+            case CompareOp::Eq: return value == threshold;
+            case CompareOp::Ne: return value != threshold;
+            }
+            return false;
+        }
+
+        /// Выполняется ли условие выключения: значение вернулось за off_threshold
+        bool releases(double value) const noexcept
+        {
+            if (!has_off) return !matches(value);
+            switch (op)
+            {
+            case CompareOp::Gt:
+            case CompareOp::Ge: return value < off_threshold;
+            case CompareOp::Lt:
+            case CompareOp::Le: return value > off_threshold;
+            default: return !matches(value);
+            }
+        }
+    };
+    static_assert(std::is_trivially_copyable_v<CompiledRule>);
+
+    /**
+     * @brief Состояние порогового правила
+     *
+     * Правило включается, когда условие держится debounce секунд, и
+     * выключается по условию releases() так же; между сменами состояния
+     * проходит не меньше min_dwell секунд. Команда формируется только при
+     * смене состояния.
+     */
+    struct RuleState
+    {
+        double value = 0.0;          ///< Значение, вызвавшее (ожидаемую) смену состояния
+        std::int64_t since = -1;     ///< Время последней смены состояния; -1 — не менялось
+        std::int64_t pending = -1;   ///< С какого времени держится условие смены; -1 — нет
+        bool active = false;
+
+        /**
+         * @brief Учёт нового значения ряда
+         * @return true, если состояние сменилось
+         */
+        bool observe(const CompiledRule &rule, double v, std::int64_t now) noexcept
+        {
+            const bool want = active ? !rule.releases(v) : rule.matches(v);
+            if (want == active) {
+                pending = -1;
+                return false;
+            }
+            if (pending < 0) pending = now;
+            value = v;
+            return settle(rule, now);
+        }
+
+        /**
+         * @brief Смена состояния, если истекли debounce и min_dwell
+         * @return true, если состояние сменилось
+         */
+        bool settle(const CompiledRule &rule, std::int64_t now) noexcept
+        {
+            if (pending < 0 || now - pending < rule.debounce) return false;
+            if (since >= 0 && now - since < rule.min_dwell) return false;
+            active = !active;
+            since = now;
+            pending = -1;
+            return true;
+        }
+    };
+
+    /**
+     * @class RuleIndex
+     * @brief Активные пороговые правила в памяти для проверки без обращений к SQLite
+     *
+     * Правила хранятся скомпилированными (CompiledRule) в плотном массиве:
+     * простые пороговые — отсортированы по интернированному ряду (gh_id,
+     * subtype), где subtype — from_comp_id в десятичной записи, и адресуются
+     * через массив смещений; за ними — правила с выражением (RuleExpression),
+     * которые проверяются при приходе точки любого ряда из выражения.
+     * Оконные агрегаты выражений (WindowAggregate) ведутся инкрементально по
+     * приходу метрик, без запросов к SQLite, и переживают перестройку индекса.
+     * Рядом с каждым правилом хранится его RuleState. Пороговые правила
+     * проверяются сразу по приходу пакета метрик; ожидающие смены
+     * состояния (debounce, min_dwell) досчитываются периодическим advance().
+     * Наружу отдаются только смены состояния.
+     * Когда пакет затрагивает заметную долю простых правил (много датчиков
+     * в одну секунду), они проверяются пакетно: условия включения и
+     * выключения всех правил вычисляются SIMD-ядром (ThresholdKernel) по
+     * плотному массиву последних значений рядов в битовые маски, и
+     * RuleState::observe вызывается только для правил, чьё состояние
+     * должно измениться или ожидает debounce.
+     * Индекс полностью загружается при старте и далее обновляется через
+     * RuleManager::add_change_listener: компилируется только изменённое
+     * правило, массивы перестраиваются.
+     *
+     * Потоки: states_ и окна выражений меняет on_metrics() (только поток
+     * IngestQueue, под shared_lock) и advance() (поток io_context, под
+     * unique_lock); правила меняются из потоков REST под unique_lock.
+     * Выданные смены состояния индекс не исполняет — их сохранение и команды
+     * ведёт поток io_context (ServerProcessor).
+     */
+    class RuleIndex
+    {
+    public:
+        /// Смена состояния порогового правила
+        struct Trigger
+        {
+            CompiledRule rule;
+            double value = 0.0;
+            bool active = false;   ///< Новое состояние
+            std::int64_t at = 0;   ///< Время смены (unix)
+        };
+
+        /// Получение единственного экземпляра (Singleton)
+        static RuleIndex &instance();
+
+        /// Отдельный экземпляр — для воспроизведения истории (RuleReplay)
+        RuleIndex() = default;
+
+        /**
+         * @brief Разбор правила в компактную форму
+         *
+         * Для правила с выражением само выражение компилируется отдельно
+         * (RuleExpression::compile).
+         * @return std::nullopt, если правило выключено, не пороговое или не может сработать
+         */
+        static std::optional<CompiledRule> compile(const Rule &rule);
+
+        /// Полная замена набора правил
+        void rebuild(const std::vector<Rule> &rules);
+
+        /// Добавление или обновление правила (выключенное правило удаляется)
+        void upsert(const Rule &rule);
+
+        /// Удаление правила
+        void remove(int rule_id);
+
+        /// Восстановление сохранённых состояний (после rebuild)
+        void restore(const std::vector<db::RuleStateRecord> &states);
+
+        /**
+         * @brief Проверка пороговых правил по пакету метрик
+         * @param metrics Принятые метрики
+         * @param now Время приёма (unix)
+         * @param out Куда добавить смены состояния
+         */
+        void on_metrics(const std::vector<Metric> &metrics, std::int64_t now, std::vector<Trigger> &out);
+
+        /**
+         * @brief Завершение смен состояния, ожидавших debounce или min_dwell
+         * @param now Текущее unix-время
+         * @param out Куда добавить смены состояния
+         */
+        void advance(std::int64_t now, std::vector<Trigger> &out);
+
+        /// Интернированный номер ряда; std::nullopt — ряд не нужен ни одному правилу
+        std::optional<std::uint32_t> series_id(const SeriesKey &key) const;
+
+        /**
+         * @brief Проверка правил по одной точке ряда, без блокировки
+         *
+         * Та же проверка, что в on_metrics, но без поиска ряда по строке.
+         * Только для экземпляра, которым владеет один поток (RuleReplay).
+         * @param sid Номер ряда из series_id()
+         */
+        void on_point(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger> &out);
+
+        /**
+         * @brief Выбор ядра пакетной проверки (для бенчмарков)
+         * @param level Набор инструкций (не выше detect_simd()); std::nullopt —
+         *              только поштучная проверка
+         */
+        void set_batch_kernel(std::optional<SimdLevel> level);
+
+        /// Количество правил в индексе
+        size_t size() const;
+
+        RuleIndex(const RuleIndex &) = delete;
+        RuleIndex &operator=(const RuleIndex &) = delete;
+
+    private:
+        /// Окно агрегата: ряд + длина окна
+        struct WindowKey
+        {
+            SeriesKey series;
+            std::int32_t window = 0;
+
+            bool operator==(const WindowKey &other) const = default;
+        };
+
+        struct WindowKeyHash
+        {
+            size_t operator()(const WindowKey &k) const noexcept
+            {
+                return SeriesKeyHash{}(k.series) * 31 + static_cast<size_t>(k.window);
+            }
+        };
+
+        /// Выражение правила rules_[plain_count_ + k]
+        struct ExprSlot
+        {
+            const RuleExpression *program = nullptr;
+            std::uint32_t operands = 0; ///< Начало окон операндов в operand_windows_
+        };
+
+        std::uint32_t intern(SeriesKey key);
+        void upsert_locked(const Rule &rule);
+        void layout();
+        void layout_expressions(size_t first);
+        void evaluate_expression(std::uint32_t k, std::int64_t now, std::vector<Trigger> &out);
+        void observe_plain(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger> &out);
+        void observe_expressions(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger> &out);
+        void observe_batch(std::int64_t now, std::vector<Trigger> &out);
+        void layout_batch();
+        void sync_bits(size_t i) noexcept;
+
+        mutable std::shared_mutex mutex_;
+
+        std::unordered_map<int, CompiledRule> compiled_;     ///< Все правила по rule_id
+        std::unordered_map<int, RuleExpression> expressions_; ///< Выражения по rule_id
+        std::unordered_map<SeriesKey, std::uint32_t, SeriesKeyHash> series_ids_;
+        std::vector<SeriesKey> series_keys_; ///< Ряд по интернированному номеру
+
+        std::vector<CompiledRule> rules_;         ///< Простые пороговые (по возрастанию series), затем с выражением
+        size_t plain_count_ = 0;                  ///< Число простых пороговых правил в начале rules_
+        std::vector<std::uint32_t> series_begin_; ///< Начало простых правил ряда в rules_ (size = рядов + 1)
+        std::vector<RuleState> states_;           ///< Состояние правила rules_[i]
+
+        // Правила с выражением; доступ к окнам — как к states_ (см. on_metrics)
+        std::unordered_map<WindowKey, WindowAggregate, WindowKeyHash> windows_;
+        std::vector<ExprSlot> expr_slots_;
+        std::vector<WindowAggregate *> operand_windows_;
+        std::vector<std::uint32_t> feed_begin_;  ///< Начало окон ряда в feeds_ (size = рядов + 1)
+        std::vector<WindowAggregate *> feeds_;   ///< Окна, пополняемые точками ряда
+        std::vector<std::uint32_t> watch_begin_; ///< Начало выражений ряда в watch_ (size = рядов + 1)
+        std::vector<std::uint32_t> watch_;       ///< Номера выражений (k), зависящих от ряда
+
+        // Пакетная проверка простых правил; буферы пакета меняет только поток on_metrics
+        static constexpr size_t kBatchShare = 8;  ///< Пакетно, если затронута хотя бы 1/8 простых правил
+        std::optional<SimdLevel> simd_ = detect_simd();
+        ThresholdBatch on_batch_;                 ///< Условия matches() простых правил
+        ThresholdBatch off_batch_;                ///< Условия releases()
+        std::vector<std::uint64_t> active_bits_;  ///< Бит i — states_[i].active
+        std::vector<std::uint64_t> pending_bits_; ///< Бит i — states_[i].pending >= 0
+        std::vector<std::uint64_t> match_bits_;
+        std::vector<std::uint64_t> release_bits_;
+        std::vector<double> latest_;              ///< Значение ряда в текущем пакете
+        std::vector<std::uint32_t> touched_;      ///< Номер пакета, в котором пришёл ряд
+        std::vector<std::uint32_t> last_point_;   ///< Последняя точка ряда в текущем пакете
+        std::vector<std::uint32_t> point_series_; ///< Ряды точек текущего пакета
+        std::uint32_t epoch_ = 0;
+    };
+
+} // namespace processor
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "db/managers/MetricManager.hpp"
+#include "entities/Rule.hpp"
+#include "processor/RuleIndex.hpp"
+#include "processor/SeriesKey.hpp"
+
+namespace processor
+{
+
+    /**
+     * @class RuleReplay
+     * @brief Воспроизведение истории метрик через пороговые правила (backtest)
+     *
+     * Правила компилируются в собственный RuleIndex — тот же код проверки,
+     * что и при приёме метрик, — и получают точки в порядке времени, причём
+     * временем проверки служит время самой точки. Между точками, как и на
+     * сервере, раз в tick секунд выполняется advance() для debounce и
+     * min_dwell. Команды не отправляются, состояния не сохраняются.
+     *
+     * История не загружается в память: строки курсора SQLite (replay) или
+     * точки вызывающего (push) проверяются по мере поступления, ряд
+     * ищется в индексе один раз на тип метрики. Память прогона не зависит
+     * от длины периода. Экземпляр рассчитан на один прогон: точки подаются
+     * по неубыванию времени, итог забирается через finish().
+     */
+    class RuleReplay
+    {
+    public:
+        /// Итог прогона
+        struct Report
+        {
+            /// Срабатывания одного правила
+            struct RuleCount
+            {
+                int rule_id = -1;
+                std::uint64_t on = 0;  ///< Включений
+                std::uint64_t off = 0; ///< Выключений
+            };
+
+            std::uint64_t points = 0;       ///< Воспроизведено точек
+            std::uint64_t skipped = 0;      ///< Отброшено (ряд без правил или неразобранное время)
+            std::uint64_t commands = 0;     ///< Команд, которые были бы отправлены
+            std::int64_t first = -1;        ///< Время первой точки
+            std::int64_t last = -1;         ///< Время последней точки
+            double eval_ms = 0.0;           ///< Время в replay(): чтение из БД и проверка
+            std::vector<RuleIndex::Trigger> timeline; ///< Первые max_timeline смен состояния
+            bool truncated = false;         ///< Смен состояния больше, чем в timeline
+            std::vector<RuleCount> rules;   ///< По правилам, в порядке rule_id
+            std::vector<int> ignored;       ///< Правила, не попавшие в прогон (не пороговые или с ошибкой)
+
+            /// Скорость прохода, точек в секунду
+            double points_per_sec() const noexcept
+            {
+                return eval_ms > 0.0 ? static_cast<double>(points) * 1000.0 / eval_ms : 0.0;
+            }
+        };
+
+        /**
+         * @param rules Проверяемые правила; выключенные тоже участвуют
+         * @param max_timeline Сколько смен состояния вернуть в Report::timeline
+         * @param tick Период досчёта debounce/min_dwell (сек), как у сервера
+         */
+        explicit RuleReplay(std::vector<Rule> rules, size_t max_timeline = 1000, std::int64_t tick = 60);
+
+        RuleReplay(const RuleReplay &) = delete;
+        RuleReplay &operator=(const RuleReplay &) = delete;
+
+        /**
+         * @brief Воспроизведение истории теплицы из БД курсором, по времени
+         * @return Число прочитанных записей или -1 при ошибке запроса
+         */
+        std::int64_t replay(db::MetricManager &metrics, int gh_id,
+                            const std::string &from_time = "", const std::string &to_time = "");
+
+        /// Проверка точки (время не убывает); false — ряд не нужен правилам
+        bool push(std::int64_t t, const SeriesKey &key, double value);
+
+        /// Итог прогона
+        Report finish();
+
+        /**
+         * @brief Разбор времени "YYYY-MM-DD HH:MM:SS" (или с 'T') без учёта пояса
+         *
+         * Время из БД считается как записано; для правил важны только
+         * интервалы между точками.
+         */
+        static std::optional<std::int64_t> parse_time(std::string_view ts) noexcept;
+
+        /// Обратное к parse_time преобразование для отчётов
+        static std::string format_time(std::int64_t t);
+
+    private:
+        void feed(std::int64_t t, std::uint32_t series, double value);
+
+        std::vector<Rule> rules_;
+        size_t max_timeline_;
+        std::int64_t tick_;
+        RuleIndex index_;
+        std::int64_t next_tick_ = 0;
+        std::vector<RuleIndex::Trigger> fired_;
+        std::map<int, Report::RuleCount> counts_;
+        Report report_;
+    };
+
+} // namespace processor
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/system_timer.hpp>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "entities/Rule.hpp"
+#include "processor/CronSpec.hpp"
+
+namespace processor
+{
+
+    /// Правило по расписанию в том виде, что нужен для отправки команды
+    struct ScheduledRule
+    {
+        int rule_id = -1;
+        int gh_id = -1;
+        int to_comp_id = -1;
+    };
+
+    /**
+     * @class RuleScheduler
+     * @brief Планировщик правил по времени на io_context
+     *
+     * Для каждого правила хранит ближайшее время срабатывания (CronSpec) в
+     * min-куче и держит один system_timer на самое раннее из них, поэтому
+     * работа пропорциональна числу наступивших срабатываний, а не правил.
+     * Изменение правила переносит только его запись (старая запись в куче
+     * помечается устаревшей по номеру поколения).
+     *
+     * Время последнего срабатывания сохраняется обработчиком Fire; при
+     * запуске следующее срабатывание считается от него, поэтому после
+     * перезапуска срабатывание не повторяется, а пропущенное за время
+     * простоя выполняется один раз, если опоздание не больше misfire_grace.
+     *
+     * Все методы, кроме sync до запуска io_context, вызываются в его потоке;
+     * из других потоков изменения передаются через post().
+     */
+    class RuleScheduler
+    {
+    public:
+        /// Срабатывание правила: rule, плановое время (unix)
+        using Fire = std::function<void(const ScheduledRule &rule, std::int64_t at)>;
+
+        RuleScheduler(boost::asio::io_context &ioc, const RulesConfig &cfg, Fire fire);
+
+        RuleScheduler(const RuleScheduler &) = delete;
+        RuleScheduler &operator=(const RuleScheduler &) = delete;
+
+        /**
+         * @brief Приведение набора правил к переданному (полная сверка)
+         * @param rules Активные правила (не-time правила пропускаются)
+         * @param last_fired Сохранённые времена срабатываний по rule_id
+         */
+        void sync(const std::vector<Rule> &rules,
+                  const std::unordered_map<int, std::int64_t> &last_fired);
+
+        /// Добавление или изменение правила (потокобезопасно)
+        void post_upsert(const Rule &rule);
+
+        /// Удаление правила (потокобезопасно)
+        void post_remove(int rule_id);
+
+        /// Остановка таймера
+        void stop();
+
+        /// Количество запланированных правил
+        size_t size() const noexcept { return entries_.size(); }
+
+    private:
+        struct Entry
+        {
+            ScheduledRule rule;
+            std::string spec_text;
+            CronSpec spec;
+            std::int64_t next = 0;
+            std::int64_t last_fired = -1;
+            std::uint64_t generation = 0;
+        };
+
+        struct Due
+        {
+            std::int64_t at;
+            int rule_id;
+            std::uint64_t generation;
+            bool operator>(const Due &o) const noexcept { return at > o.at; }
+        };
+
+        void upsert(const Rule &rule, std::int64_t last_fired, std::int64_t now, bool catch_up);
+        void remove(int rule_id);
+        void schedule(Entry &e, std::int64_t now);
+        void arm();
+        void on_timer(const boost::system::error_code &ec);
+
+        boost::asio::io_context &ioc_;
+        const RulesConfig &cfg_;
+        Fire fire_;
+        boost::asio::system_timer timer_;
+
+        std::unordered_map<int, Entry> entries_;
+        std::priority_queue<Due, std::vector<Due>, std::greater<Due>> queue_;
+        std::uint64_t generation_ = 0;
+        std::int64_t armed_at_ = -1;
+    };
+
+} // namespace processor
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace processor
+{
+
+    /**
+     * @brief Ключ временного ряда: теплица + тип метрики
+     */
+    struct SeriesKey
+    {
+        int gh_id = -1;
+        std::string subtype;
+
+        bool operator==(const SeriesKey &other) const = default;
+    };
+
+    struct SeriesKeyHash
+    {
+        size_t operator()(const SeriesKey &k) const noexcept
+        {
+            const size_t h = std::hash<std::string>{}(k.subtype);
+            return h ^ (static_cast<size_t>(k.gh_id) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+        }
+    };
+
+} // namespace processor
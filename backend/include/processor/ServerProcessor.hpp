@@ -3,11 +3,20 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <memory>
+#include <mutex>
 #include "config/ConfigLoader.hpp"
 #include "db/Database.hpp"
+#include "db/managers/CommandOutboxManager.hpp"
+#include "db/managers/IngestStateManager.hpp"
 #include "db/managers/MetricManager.hpp"
 #include "db/managers/RuleManager.hpp"
 #include "mqtt_client/MQTTClient.hpp"
+#include "processor/CommandOutbox.hpp"
+#include "processor/IngestDedup.hpp"
+#include "processor/IngestFilter.hpp"
+#include "processor/RuleIndex.hpp"
+#include "processor/RuleScheduler.hpp"
+#include "processor/UdpIngestListener.hpp"
 #include "entities/Metric.hpp"
 #include "entities/Rule.hpp"
 
@@ -18,8 +27,20 @@ namespace processor
      * @class ServerProcessor
      * @brief Обрабатывает метрики и правила, отправляет команды в MQTT
      *
-     * Инициализирует менеджеры метрик и правил, проверяет активные правила
-     * по таймеру и публикует команды через MQTTClient.
+     * Инициализирует менеджеры метрик и правил, проверяет пороговые правила
+     * по приходу метрик (через RuleIndex), правила по расписанию — по их
+     * собственным срокам (через RuleScheduler), и публикует команды через
+     * MQTTClient.
+     *
+     * Срабатывания правил исполняет только поток io_context: смены состояния
+     * из RuleIndex (поток IngestQueue и периодическая проверка) передаются
+     * туда через post, правила по расписанию срабатывают там же. В этом
+     * потоке сохраняются состояния и времена срабатываний, ведутся
+     * ActuatorStateCache и CommandTracker и команды ставятся в CommandOutbox;
+     * публикация идёт асинхронно и проверку правил не задерживает. Команды,
+     * повторяющие текущее состояние устройства, отсекает ActuatorStateCache.
+     * Смены состояния исполняются разделами по теплицам; время проходов и
+     * самый медленный раздел учитывает RuleEngineStats.
      */
     class ServerProcessor
     {
@@ -54,12 +75,18 @@ namespace processor
 
     private:
         void setupManagers();
+        void setupRules();
+        void setupIngest();
         void setupMQTT();
         void scheduleRuleCheck();
         void onRuleCheck(const boost::system::error_code &ec);
         void processActiveRules();
-        void evaluateRule(const Rule &rule);
-        void sendCommand(int gh_id, const std::string &command_json);
+        bool storeMetrics(const std::vector<Metric> &metrics);
+        void onMetricsAccepted(const std::vector<Metric> &metrics);
+        void fireTimeRule(const ScheduledRule &rule, std::int64_t at);
+        void postThresholdFires(std::vector<RuleIndex::Trigger> &&triggers);
+        void fireThresholdRules(const std::vector<RuleIndex::Trigger> &triggers);
+        void fireGreenhouse(const std::vector<const RuleIndex::Trigger *> &triggers);
 
     private:
         boost::asio::io_context &ioc_;
@@ -68,14 +95,25 @@ namespace processor
         std::shared_ptr<db::Database> db_;
         std::unique_ptr<db::MetricManager> metricMgr_;
         std::unique_ptr<db::RuleManager> ruleMgr_;
+        std::unique_ptr<db::IngestStateManager> ingestStateMgr_;
+        std::unique_ptr<db::CommandOutboxManager> outboxMgr_;
         std::unique_ptr<MQTTClient> mqttClient_;
+        std::unique_ptr<CommandOutbox> outbox_;
+        std::unique_ptr<UdpIngestListener> udpListener_;
+        std::unique_ptr<IngestFilter> ingestFilter_;
+        std::unique_ptr<IngestDedup> ingestDedup_;
+        std::unique_ptr<RuleScheduler> ruleScheduler_;
+        std::vector<db::SeqWatermark> watermarks_; ///< Буфер отметок (поток IngestQueue)
+        /// Смены состояния правил (поток IngestQueue и io_context) ставятся
+        /// в io_context в том порядке, в котором их выдал RuleIndex
+        std::mutex fireOrderMutex_;
 
         boost::asio::steady_timer ruleTimer_;
         std::chrono::seconds ruleInterval_{60}; // 60 секунд вместо 1 минуты
+        static constexpr unsigned kRuleResyncTicks = 10; // Полная сверка индекса правил раз в 10 проверок
+        unsigned ruleTicks_{0};
 
         bool initialized_{false};
-
-        bool isValidJson(const std::string &str) const;
     };
 
 } // namespace processor
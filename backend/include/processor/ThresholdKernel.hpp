@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace processor
+{
+
+    /// Набор инструкций для ядра проверки порогов
+    enum class SimdLevel : std::uint8_t
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @struct ThresholdBatch
+     * @brief Условия пороговых правил в виде структуры массивов
+     *
+     * Любое сравнение сводится к попаданию значения в отрезок [lo, hi]
+     * с возможной инверсией: `> t` — [next(t), +inf], `>= t` — [t, +inf],
+     * `< t` — [-inf, prev(t)], `= t` — [t, t], `!= t` — [t, t] с инверсией.
+     * Поэтому все операторы проверяются одним ядром без ветвлений, а
+     * правила остаются в исходном порядке. NaN не попадает ни в один
+     * отрезок — как и в скалярных сравнениях.
+     */
+    struct ThresholdBatch
+    {
+        std::vector<std::uint32_t> series; ///< Номер ряда — индекс в массиве значений
+        std::vector<double> lo;
+        std::vector<double> hi;
+        std::vector<std::uint64_t> invert; ///< Бит i — результат условия i инвертируется
+
+        size_t size() const noexcept { return series.size(); }
+        void clear();
+        void push(std::uint32_t sid, double lo_bound, double hi_bound, bool inverted);
+    };
+
+    /// Лучший набор инструкций, поддерживаемый процессором
+    SimdLevel detect_simd() noexcept;
+
+    /// Название набора инструкций для журналов и бенчмарков
+    const char *simd_name(SimdLevel level) noexcept;
+
+    /**
+     * @brief Проверка всех условий пакета по плотному массиву значений рядов
+     * @param batch Условия
+     * @param values values[series[i]] — текущее значение ряда условия i
+     * @param out Маска из (size() + 63) / 64 слов: бит i — условие i выполняется
+     * @param level Набор инструкций (не выше detect_simd())
+     */
+    void evaluate_thresholds(const ThresholdBatch &batch, const double *values,
+                             std::uint64_t *out, SimdLevel level) noexcept;
+
+} // namespace processor
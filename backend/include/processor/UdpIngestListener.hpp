@@ -0,0 +1,108 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "config/ConfigLoader.hpp"
+#include "entities/Metric.hpp"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+namespace processor
+{
+
+    /**
+     * @class UdpIngestListener
+     * @brief Приём метрик по UDP в формате, близком к Influx line protocol
+     *
+     * Строка: `[measurement][,gh=<id>][,subtype=<name>][,seq=<n>] <field>=<value>[,...] [timestamp]`.
+     * При наличии тега subtype берётся поле `value`, иначе каждое поле
+     * становится отдельной метрикой с subtype = имя поля.
+     * В одной датаграмме может быть несколько строк, разделённых '\n'.
+     *
+     * Работает на io_context ServerProcessor: ждёт готовности сокета и
+     * вычитывает пачку датаграмм одним recvmmsg (Linux), разбирает их
+     * через string_view без копирования буфера и кладёт в IngestQueue
+     * одним пакетом. Поток io_context никогда не блокируется: при
+     * переполнении очереди точки отбрасываются и учитываются в счётчиках.
+     */
+    class UdpIngestListener
+    {
+    public:
+        /// Снимок счётчиков приёма
+        struct Stats
+        {
+            std::uint64_t datagrams = 0;
+            std::uint64_t truncated_datagrams = 0;
+            std::uint64_t malformed_datagrams = 0;
+            std::uint64_t malformed_lines = 0;
+            std::uint64_t points = 0;
+            std::uint64_t dropped_points = 0;
+        };
+
+        UdpIngestListener(boost::asio::io_context &ioc, const UdpIngestConfig &cfg);
+        ~UdpIngestListener();
+
+        UdpIngestListener(const UdpIngestListener &) = delete;
+        UdpIngestListener &operator=(const UdpIngestListener &) = delete;
+
+        /// Открыть сокет и начать приём
+        void start();
+
+        /// Закрыть сокет
+        void stop();
+
+        /// Счётчики (общие для процесса)
+        static Stats stats();
+
+        /**
+         * @brief Разбор одной датаграммы
+         * @param datagram Содержимое датаграммы
+         * @param out Куда добавить метрики
+         * @return Количество строк, которые не удалось разобрать
+         */
+        size_t parse_datagram(std::string_view datagram, std::vector<Metric> &out);
+
+    private:
+        struct Counters
+        {
+            std::atomic<std::uint64_t> datagrams{0};
+            std::atomic<std::uint64_t> truncated_datagrams{0};
+            std::atomic<std::uint64_t> malformed_datagrams{0};
+            std::atomic<std::uint64_t> malformed_lines{0};
+            std::atomic<std::uint64_t> points{0};
+            std::atomic<std::uint64_t> dropped_points{0};
+        };
+        static Counters &counters();
+
+        void wait_readable();
+        void drain();
+        void handle_datagram(std::string_view datagram, bool truncated);
+        bool parse_line(std::string_view line, std::vector<Metric> &out);
+        const std::string &timestamp_for(std::int64_t raw);
+
+        boost::asio::io_context &ioc_;
+        const UdpIngestConfig &cfg_;
+        boost::asio::ip::udp::socket socket_;
+        std::vector<char> buffer_;
+        std::vector<Metric> pending_;
+        std::int64_t divisor_ = 1000; ///< Перевод метки времени в секунды
+
+#ifdef __linux__
+        std::vector<mmsghdr> msgs_;
+        std::vector<iovec> iovs_;
+#endif
+
+        // Кэш форматирования: соседние строки почти всегда в одной секунде
+        std::int64_t last_second_ = -1;
+        std::string last_ts_;
+        std::string now_ts_;
+    };
+
+} // namespace processor
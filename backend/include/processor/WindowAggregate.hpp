@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace processor
+{
+
+    /// Агрегат ряда за окно
+    enum class Aggregate : std::uint8_t
+    {
+        Last,  ///< Последнее значение
+        Avg,
+        Min,
+        Max,
+        Rate,  ///< Скорость изменения (ед./сек) между первой и последней точкой окна
+        Count
+    };
+
+    /**
+     * @class WindowAggregate
+     * @brief Скользящее окно ряда с агрегатами за O(1)
+     *
+     * Сумма ведётся нарастающим итогом, минимум и максимум — монотонными
+     * очередями, поэтому добавление точки и вытеснение старых стоят
+     * амортизированно O(1), а агрегаты не требуют прохода по окну.
+     * Окно 0 хранит только последнюю точку.
+     */
+    class WindowAggregate
+    {
+    public:
+        /// @param window Длина окна (сек); 0 — только последнее значение
+        explicit WindowAggregate(std::int32_t window) noexcept : window_(window) {}
+
+        /// Добавление точки (время не убывает)
+        void push(std::int64_t t, double v);
+
+        /// Вытеснение точек старше now - window
+        void evict(std::int64_t now);
+
+        /// Значение агрегата; NaN, если данных нет
+        double value(Aggregate agg) const noexcept;
+
+        std::int32_t window() const noexcept { return window_; }
+
+    private:
+        struct Sample
+        {
+            std::int64_t t;
+            double v;
+        };
+
+        std::int32_t window_;
+        std::deque<Sample> samples_;
+        std::deque<Sample> min_; ///< Значения возрастают от начала к концу
+        std::deque<Sample> max_; ///< Значения убывают от начала к концу
+        double sum_ = 0.0;
+    };
+
+} // namespace processor
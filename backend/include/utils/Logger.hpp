@@ -1,24 +1,29 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
-#include <boost/log/core.hpp>
-#include <boost/log/trivial.hpp>
-#include <boost/log/sources/severity_logger.hpp>
-#include <boost/log/sources/record_ostream.hpp>
-#include <boost/log/utility/setup/file.hpp>
-#include <boost/log/utility/setup/console.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/attributes.hpp>
-#include <boost/log/support/date_time.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
-
-#include <string>
-#include <string_view>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <format>
+#include <iterator>
 #include <memory>
-#include <source_location>
 #include <mutex>
+#include <new>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+// Минимальный уровень, попадающий в код (0 — TRACE ... 5 — FATAL).
+// Вызовы LOG_*_SG ниже него не компилируются вместе с аргументами;
+// задаётся в CMake (SG_LOG_MIN_LEVEL)
+#ifndef SG_LOG_MIN_LEVEL
+#define SG_LOG_MIN_LEVEL 0
+#endif
 
 // Уровни логирования
 enum class LogLevel : int
@@ -31,34 +36,57 @@ enum class LogLevel : int
     FATAL = 5
 };
 
+// Поведение при заполненной очереди записей
+enum class LogOverflow : int
+{
+    Block = 0, // Вызывающий поток ждёт, пока фоновый поток освободит место
+    Drop = 1,  // Запись отбрасывается, потеря видна только в stats()
+    Count = 2  // Запись отбрасывается, число потерянных записей пишется в журнал
+};
+
+class LogLimiter;
+
+/**
+ * @class Logger
+ * @brief Асинхронный журнал: файл с ротацией и консоль
+ *
+ * Вызывающий поток только проверяет уровень, занимает ячейку в кольцевой
+ * очереди (без блокировок, много писателей — один читатель) и форматирует
+ * сообщение прямо в неё. Временную метку, уровень и перевод строки
+ * добавляет фоновый поток: он забирает записи пачками и пишет каждую пачку
+ * одним write() в файл и в консоль. Сообщения длиннее ячейки хранятся
+ * в отдельной строке записи.
+ *
+ * Строка формата проверяется при компиляции (std::format_string). В режиме
+ * отложенного форматирования (set_deferred) вызов с одними числовыми
+ * аргументами копирует их в ячейку как есть, а текст собирает фоновый
+ * поток; остальные вызовы форматируются сразу.
+ *
+ * Через write() в ту же очередь идут готовые строки других подсистем
+ * (вывод drogon/trantor): у всех записей одна строка формата — метка
+ * времени, уровень, компонент, номер потока — и общий порядок постановки.
+ *
+ * Записи FATAL и вызов flush() ждут, пока всё поставленное ранее будет
+ * записано; при завершении процесса очередь дописывается до конца.
+ */
 class Logger
 {
 public:
-    using severity_logger = boost::log::sources::severity_logger_mt<boost::log::trivial::severity_level>;
+    /// Размер текста, помещающегося в ячейку очереди без выделения памяти
+    static constexpr size_t kRecordText = 480;
 
-private:
-    std::unique_ptr<severity_logger> logger_;
-    bool initialized_ = false;
-    std::mutex init_mutex_;
-    boost::log::trivial::severity_level min_severity_level_ = boost::log::trivial::info;
+    /// Компонент записей LOG_*_SG
+    static constexpr std::string_view kComponent = "app";
 
-    // Конвертация уровня логирования в уровень Boost
-    [[nodiscard]] static constexpr boost::log::trivial::severity_level
-    to_boost_level(LogLevel level) noexcept
+    /// Счётчики журнала (на процесс)
+    struct Stats
     {
-        switch (level)
-        {
-        case LogLevel::TRACE: return boost::log::trivial::trace;
-        case LogLevel::DEBUG: return boost::log::trivial::debug;
-        case LogLevel::INFO: return boost::log::trivial::info;
-        case LogLevel::WARNING: return boost::log::trivial::warning;
-        case LogLevel::ERROR: return boost::log::trivial::error;
-        case LogLevel::FATAL: return boost::log::trivial::fatal;
-        default: return boost::log::trivial::info;
-        }
-    }
+        std::uint64_t written = 0; ///< Записано сообщений
+        std::uint64_t dropped = 0; ///< Отброшено при заполненной очереди
+        std::uint64_t blocked = 0; ///< Вызовов, ждавших места в очереди
+        size_t capacity = 0;       ///< Ёмкость очереди, записей
+    };
 
-public:
     // Получение единственного экземпляра (Singleton)
     static Logger &instance()
     {
@@ -66,118 +94,237 @@ public:
         return instance;
     }
 
-    // Инициализация системы логирования
+    // Инициализация системы логирования и запуск фонового потока
     void initialize(const std::string &log_file = "app.log",
                     LogLevel min_level = LogLevel::INFO,
                     bool console_output = true,
-                    size_t rotation_size = 10 * 1024 * 1024)
-    {
-        std::lock_guard<std::mutex> lock(init_mutex_);
-        
-        if (initialized_) return;
-
-        namespace logging = boost::log;
-        namespace expr = boost::log::expressions;
-        namespace keywords = boost::log::keywords;
-
-        // Очищаем существующие sinks
-        logging::core::get()->remove_all_sinks();
-
-        // Формат логов: [TimeStamp] [Level] Message [File:Line:Function]
-        auto formatter = expr::stream
-            << expr::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S.%f")
-            << " [" << logging::trivial::severity << "] "
-            << expr::smessage;
-
-        // Файловый sink с ротацией
-        auto file_sink = logging::add_file_log(
-            keywords::file_name = log_file,
-            keywords::rotation_size = rotation_size,
-            keywords::time_based_rotation = boost::log::sinks::file::rotation_at_time_point(0, 0, 0),
-            keywords::format = formatter,
-            keywords::auto_flush = true);
-
-        min_severity_level_ = to_boost_level(min_level);
-        file_sink->set_filter(logging::trivial::severity >= min_severity_level_);
-
-        // Консольный sink
-        if (console_output)
-        {
-            auto console_sink = logging::add_console_log(
-                std::clog,
-                keywords::format = formatter);
-            console_sink->set_filter(logging::trivial::severity >= min_severity_level_);
-        }
-
-        // Добавляем общие атрибуты
-        logging::add_common_attributes();
-        logger_ = std::make_unique<severity_logger>();
-        initialized_ = true;
-    }
+                    size_t rotation_size = 10 * 1024 * 1024,
+                    size_t queue_capacity = 8192);
 
-    // Получение логгера
-    [[nodiscard]] severity_logger &get_logger()
+    // Проверка уровня до вычисления аргументов (макросы LOG_*_SG)
+    [[nodiscard]] bool enabled(LogLevel level)
     {
-        if (!initialized_) initialize();
-        return *logger_;
+        if (!ready_.load(std::memory_order_acquire))
+            initialize();
+        return static_cast<int>(level) >= min_level_.load(std::memory_order_relaxed);
     }
 
-    // Универсальный метод логирования с поддержкой std::format
+    // Универсальный метод логирования с поддержкой std::format;
+    // where — место вызова, для DEBUG и TRACE добавляется к сообщению
     template <typename... Args>
-    void log(LogLevel level, std::string_view format_str, Args &&...args)
+    void log(LogLevel level, const std::source_location &where,
+             std::format_string<Args...> format_str, Args &&...args)
     {
-        auto &logger = get_logger();
-        auto boost_level = to_boost_level(level);
-
-        // Проверяем, включено ли логирование
-        if (!boost::log::core::get()->get_logging_enabled())
+        if (!enabled(level))
             return;
 
-        // Проверяем уровень логирования через сохраненное значение
-        if (boost_level < min_severity_level_)
+        Record *r = acquire();
+        if (!r)
             return;
 
-        // Формируем основное сообщение
-        std::string message;
-        if constexpr (sizeof...(args) > 0)
+        stamp(*r, level, kComponent);
+        r->where = where;
+        r->located = level <= LogLevel::DEBUG;
+        r->render = nullptr;
+
+        if constexpr (deferrable<Args...>)
         {
-            message = std::vformat(format_str, std::make_format_args(args...));
+            if (deferred_.load(std::memory_order_relaxed))
+                defer(*r, format_str.get(), args...);
+            else
+                fill(*r, format_str.get(), std::make_format_args(args...));
         }
         else
         {
-            message = std::string(format_str);
+            fill(*r, format_str.get(), std::make_format_args(args...));
         }
+        commit(*r);
 
-        // Добавляем информацию о местоположении для DEBUG и TRACE
-        if (level <= LogLevel::DEBUG)
-        {
-            message += std::format(" [{}:{}:{}]",
-                                  std::source_location::current().file_name(),
-                                  std::source_location::current().line(),
-                                  std::source_location::current().function_name());
-        }
-
-        BOOST_LOG_SEV(logger, boost_level) << message;
+        if (level == LogLevel::FATAL)
+            flush();
     }
 
+    // Готовый текст другой подсистемы; component должен жить до конца процесса
+    // (литерал). Перевод строки в конце text не нужен
+    void write(LogLevel level, std::string_view component, std::string_view text);
+
     // Установка уровня логирования
     void set_level(LogLevel min_level)
     {
-        std::lock_guard<std::mutex> lock(init_mutex_);
-        min_severity_level_ = to_boost_level(min_level);
-        boost::log::core::get()->set_filter(
-            boost::log::trivial::severity >= min_severity_level_);
+        min_level_.store(static_cast<int>(min_level), std::memory_order_relaxed);
+        if (LevelObserver observer = level_observer_.load(std::memory_order_acquire))
+            observer(min_level);
+    }
+
+    // Уровень из set_level передаётся и журналу другой подсистемы (trantor);
+    // observer вызывается сразу с текущим уровнем
+    using LevelObserver = void (*)(LogLevel level);
+    void on_level_change(LevelObserver observer)
+    {
+        level_observer_.store(observer, std::memory_order_release);
+        if (observer)
+            observer(level());
+    }
+
+    [[nodiscard]] LogLevel level() const noexcept
+    {
+        return static_cast<LogLevel>(min_level_.load(std::memory_order_relaxed));
+    }
+
+    // Поведение при заполненной очереди
+    void set_overflow(LogOverflow policy)
+    {
+        overflow_.store(static_cast<int>(policy), std::memory_order_relaxed);
+    }
+
+    // Отложенное форматирование вызовов с числовыми аргументами
+    void set_deferred(bool enabled)
+    {
+        deferred_.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Вывод в консоль можно отключить после инициализации
+    void set_console_output(bool enabled)
+    {
+        console_.store(enabled, std::memory_order_relaxed);
     }
 
-    // Принудительная запись буферизованных логов
-    void flush()
+    // "block", "drop" или "count"; иначе — def
+    static LogOverflow overflow_from(std::string_view name, LogOverflow def = LogOverflow::Block);
+
+    // Грубое монотонное время, мс: обновляет фоновый поток не реже раза в 10 мс
+    [[nodiscard]] std::int64_t coarse_ms() const noexcept
     {
-        boost::log::core::get()->flush();
+        return coarse_ms_.load(std::memory_order_relaxed);
     }
 
+    // Место вызова начало подавлять сообщения: фоновый поток пишет по нему сводки
+    void watch(LogLimiter *limiter) noexcept;
+
+    // Ожидание записи всего, что поставлено в очередь до вызова
+    void flush();
+
+    // Разбудить фоновый поток, не дожидаясь записи
+    void flush_async();
+
+    // Дописать очередь и остановить фоновый поток; дальнейшие записи отбрасываются
+    void shutdown();
+
+    Stats stats() const;
+
 private:
-    Logger() = default;
-    ~Logger() { if (initialized_) flush(); }
+    struct Record;
+    using Render = void (*)(const Record &r, std::string &out);
+
+    struct alignas(64) Record
+    {
+        std::atomic<size_t> seq{0}; ///< Номер прохода по кольцу: ячейка свободна / заполнена
+        size_t pos = 0;             ///< Позиция в очереди, занятая писателем
+        std::int64_t at_ns = 0;     ///< Время постановки, нс от эпохи system_clock
+        LogLevel level = LogLevel::INFO;
+        std::uint32_t len = 0;      ///< Длина text; kSpilled — текст в spill
+        std::uint32_t tid = 0;      ///< Поток, поставивший запись
+        std::string_view component = kComponent;
+        std::source_location where;
+        bool located = false;       ///< Дописать место вызова
+        Render render = nullptr;    ///< Отложенное форматирование: аргументы в text
+        std::string_view format;    ///< Строка формата (литерал) для render
+        alignas(std::max_align_t) char text[kRecordText];
+        std::string spill;
+    };
+    static constexpr std::uint32_t kSpilled = ~std::uint32_t{0};
+
+    // Откладываются только значения без ссылок на чужую память
+    template <typename... Args>
+    static constexpr bool deferrable =
+        sizeof...(Args) > 0 && (std::is_arithmetic_v<std::remove_cvref_t<Args>> && ...) &&
+        sizeof(std::tuple<std::remove_cvref_t<Args>...>) <= kRecordText;
+
+    template <typename... Args>
+    static void defer(Record &r, std::string_view format_str, const Args &...args)
+    {
+        using Values = std::tuple<std::remove_cvref_t<Args>...>;
+        ::new (static_cast<void *>(r.text)) Values(args...);
+        r.format = format_str;
+        r.render = &render_deferred<Values>;
+    }
+
+    template <typename Values>
+    static void render_deferred(const Record &r, std::string &out)
+    {
+        const auto &values = *std::launder(reinterpret_cast<const Values *>(r.text));
+        std::apply([&](const auto &...v)
+                   { std::vformat_to(std::back_inserter(out), r.format, std::make_format_args(v...)); },
+                   values);
+    }
+
+    // Номер потока ОС (как в top и gdb), один системный вызов на поток
+    static std::uint32_t thread_id() noexcept
+    {
+        static thread_local const std::uint32_t id = current_thread_id();
+        return id;
+    }
+    static std::uint32_t current_thread_id() noexcept;
+
+    static void stamp(Record &r, LogLevel level, std::string_view component) noexcept
+    {
+        r.at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+        r.level = level;
+        r.tid = thread_id();
+        r.component = component;
+    }
+
+    Record *acquire();
+    void fill(Record &r, std::string_view format_str, std::format_args args);
+    void commit(Record &r) noexcept
+    {
+        r.seq.store(r.pos + 1, std::memory_order_release);
+    }
+
+    void run();
+    void note(std::string &batch, LogLevel level, const std::source_location *where, std::string_view text);
+    void report_suppressed(std::string &batch, std::int64_t now_ms, bool all);
+    size_t drain(std::string &batch);
+    void write_batch(const std::string &batch);
+    void wake();
+
+    // Кольцевая очередь; tail_ — общий счётчик писателей, head_ — только фонового потока
+    std::unique_ptr<Record[]> records_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+
+    alignas(64) std::atomic<bool> ready_{false};
+    std::atomic<bool> running_{false};
+    std::atomic<int> min_level_{static_cast<int>(LogLevel::INFO)};
+    std::atomic<int> overflow_{static_cast<int>(LogOverflow::Block)};
+    std::atomic<bool> console_{true};
+    std::atomic<bool> deferred_{false};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> blocked_{0};
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::int64_t> coarse_ms_{0};
+    std::atomic<LogLimiter *> limiters_{nullptr}; ///< Места вызова с подавленными сообщениями
+    std::atomic<LevelObserver> level_observer_{nullptr};
+
+    // Пробуждение фонового потока и ожидание flush()
+    std::mutex init_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    bool wake_requested_ = false;
+    bool stop_ = false;
+    size_t flushed_ = 0; ///< Позиция, до которой очередь записана (под mutex_)
+
+    struct Sink;
+    std::unique_ptr<Sink> sink_;
+    std::thread worker_;
+
+    Logger();
+    ~Logger();
 
     // Запрещаем копирование и перемещение
     Logger(const Logger &) = delete;
@@ -186,16 +333,104 @@ private:
     Logger &operator=(Logger &&) = delete;
 };
 
+/**
+ * @class LogLimiter
+ * @brief Ограничение частоты сообщений одного места вызова
+ *
+ * Пропускает первые limit сообщений за период, остальные только считает:
+ * подавленный вызов стоит двух атомарных операций, аргументы не вычисляются.
+ * Сводку «подавлено K сообщений» с местом вызова пишет фоновый поток
+ * журнала раз в период. Объект — статический в месте вызова (макросы
+ * LOG_*_LIMIT_SG), инициализируется при компиляции и не разрушается:
+ * фоновый поток читает его до конца процесса.
+ */
+class LogLimiter
+{
+public:
+    constexpr LogLimiter(LogLevel level, std::source_location where) noexcept
+        : level_(level), where_(where)
+    {
+    }
+
+    // true — сообщение писать; period_sec — длина окна
+    bool admit(std::uint32_t limit, std::uint32_t period_sec) noexcept
+    {
+        const std::int64_t now = Logger::instance().coarse_ms();
+        const std::int64_t period_ms = std::int64_t{period_sec} * 1000;
+        std::int64_t start = window_.load(std::memory_order_relaxed);
+        // Новое окно открывает один поток, остальные считают уже в нём
+        if (now - start >= period_ms &&
+            window_.compare_exchange_strong(start, now, std::memory_order_relaxed))
+        {
+            count_.store(0, std::memory_order_relaxed);
+        }
+        if (count_.fetch_add(1, std::memory_order_relaxed) < limit)
+            return true;
+
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        if (!registered_.load(std::memory_order_relaxed) &&
+            !registered_.exchange(true, std::memory_order_relaxed))
+        {
+            period_ms_ = period_ms;
+            Logger::instance().watch(this);
+        }
+        return false;
+    }
+
+private:
+    friend class Logger;
+
+    LogLevel level_;
+    std::source_location where_;
+    std::atomic<std::int64_t> window_{0};     ///< Начало окна, Logger::coarse_ms()
+    std::atomic<std::uint32_t> count_{0};     ///< Сообщений в окне
+    std::atomic<std::uint64_t> suppressed_{0};///< Подавлено с последней сводки
+    std::atomic<bool> registered_{false};
+    std::int64_t period_ms_ = 0;              ///< Период сводок; задаётся до watch()
+    LogLimiter *next_ = nullptr;              ///< Список Logger::limiters_
+    std::int64_t reported_at_ = 0;            ///< Последняя сводка (только фоновый поток)
+};
+
+// Вызов ниже SG_LOG_MIN_LEVEL не компилируется; ниже текущего уровня —
+// не вычисляет аргументы
+#define SG_LOG_AT(level, ...)                                                                  \
+    do                                                                                         \
+    {                                                                                          \
+        if constexpr (static_cast<int>(level) >= SG_LOG_MIN_LEVEL)                             \
+        {                                                                                      \
+            if (Logger::instance().enabled(level))                                             \
+                Logger::instance().log(level, std::source_location::current(), __VA_ARGS__); \
+        }                                                                                      \
+    } while (0)
+
 // Удобные макросы для логирования
-#define LOG_TRACE_SG(...) Logger::instance().log(LogLevel::TRACE, __VA_ARGS__)
-#define LOG_DEBUG_SG(...) Logger::instance().log(LogLevel::DEBUG, __VA_ARGS__)
-#define LOG_INFO_SG(...) Logger::instance().log(LogLevel::INFO, __VA_ARGS__)
-#define LOG_WARN_SG(...) Logger::instance().log(LogLevel::WARNING, __VA_ARGS__)
-#define LOG_ERROR_SG(...) Logger::instance().log(LogLevel::ERROR, __VA_ARGS__)
-#define LOG_FATAL_SG(...) Logger::instance().log(LogLevel::FATAL, __VA_ARGS__)
+#define LOG_TRACE_SG(...) SG_LOG_AT(LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG_SG(...) SG_LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO_SG(...) SG_LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN_SG(...) SG_LOG_AT(LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERROR_SG(...) SG_LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+#define LOG_FATAL_SG(...) SG_LOG_AT(LogLevel::FATAL, __VA_ARGS__)
+
+// Не больше limit сообщений места вызова за period_sec секунд, о подавленных —
+// сводка раз в период (для путей, которые может затопить внешний ввод)
+#define SG_LOG_LIMIT_AT(level, limit, period_sec, ...)                                         \
+    do                                                                                         \
+    {                                                                                          \
+        if constexpr (static_cast<int>(level) >= SG_LOG_MIN_LEVEL)                             \
+        {                                                                                      \
+            static LogLimiter sg_limiter_(level, std::source_location::current());             \
+            if (Logger::instance().enabled(level) && sg_limiter_.admit(limit, period_sec))     \
+                Logger::instance().log(level, std::source_location::current(), __VA_ARGS__); \
+        }                                                                                      \
+    } while (0)
+
+#define LOG_DEBUG_LIMIT_SG(limit, period_sec, ...) SG_LOG_LIMIT_AT(LogLevel::DEBUG, limit, period_sec, __VA_ARGS__)
+#define LOG_INFO_LIMIT_SG(limit, period_sec, ...) SG_LOG_LIMIT_AT(LogLevel::INFO, limit, period_sec, __VA_ARGS__)
+#define LOG_WARN_LIMIT_SG(limit, period_sec, ...) SG_LOG_LIMIT_AT(LogLevel::WARNING, limit, period_sec, __VA_ARGS__)
+#define LOG_ERROR_LIMIT_SG(limit, period_sec, ...) SG_LOG_LIMIT_AT(LogLevel::ERROR, limit, period_sec, __VA_ARGS__)
 
 // Инициализация логгера
 #define INIT_LOGGER_SG(file, level, console, size) Logger::instance().initialize(file, level, console, size)
 #define INIT_LOGGER_DEFAULT_SG() Logger::instance().initialize()
 
-#endif // LOGGER_HPP
\ No newline at end of file
+#endif // LOGGER_HPP
@@ -0,0 +1,15 @@
+// utils/TrantorLog.hpp
+#pragma once
+
+namespace utils_sg {
+
+/**
+ * @brief Направляет вывод drogon/trantor (LOG_INFO << ...) в очередь Logger
+ *
+ * Один фоновый поток, один файл с ротацией и общий порядок строк с LOG_*_SG.
+ * Уровень trantor следует за Logger::set_level, чтобы отброшенные строки
+ * не форматировались. Вызывается один раз при старте, до запуска потоков.
+ */
+void attachTrantorLogging();
+
+} // namespace utils_sg
@@ -4,6 +4,7 @@
 #include "entities/Component.hpp"
 #include "db/managers/ComponentManager.hpp"
 #include "db/managers/GreenhouseManager.hpp"
+#include "processor/ActuatorStateCache.hpp"
 #include "utils/AuthUtils.hpp"
 
 using namespace drogon;
@@ -11,6 +12,23 @@ using json = Json::Value;
 
 namespace api
 {
+    namespace
+    {
+        Json::Value stateToJson(const processor::ActuatorState &s)
+        {
+            Json::Value obj;
+            obj["comp_id"] = s.comp_id;
+            obj["gh_id"] = s.gh_id;
+            obj["state"] = s.current();
+            obj["commanded"] = s.commanded;
+            obj["commanded_at"] = static_cast<Json::Int64>(s.commanded_at);
+            obj["rule_id"] = s.rule_id;
+            obj["reported"] = s.reported;
+            obj["reported_at"] = static_cast<Json::Int64>(s.reported_at);
+            obj["suppressed"] = static_cast<Json::UInt64>(s.suppressed);
+            return obj;
+        }
+    } // namespace
 
     void ComponentController::get_components(
         const HttpRequestPtr &req,
@@ -383,4 +401,60 @@ namespace api
             callback(resp);
         }
     }
+
+    // Состояние исполнительного устройства из памяти (без обращения к БД)
+    void ComponentController::get_state(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback,
+        int comp_id)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        auto state = processor::ActuatorStateCache::instance().get(comp_id);
+        if (!state)
+        {
+            Json::Value error;
+            error["error"] = "Actuator state unknown";
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k404NotFound);
+            callback(resp);
+            return;
+        }
+        auto resp = HttpResponse::newHttpJsonResponse(stateToJson(*state));
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
+
+    // Известные состояния устройств теплицы
+    void ComponentController::get_states(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback,
+        int gh_id)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        Json::Value root(Json::arrayValue);
+        for (const auto &s : processor::ActuatorStateCache::instance().by_greenhouse(gh_id))
+            root.append(stateToJson(s));
+
+        auto resp = HttpResponse::newHttpJsonResponse(root);
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
 }
\ No newline at end of file
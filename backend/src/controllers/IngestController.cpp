@@ -0,0 +1,210 @@
+#include "controllers/IngestController.hpp"
+#include <json/json.h>
+#include <trantor/utils/Logger.h>
+#include "processor/IngestDedup.hpp"
+#include "processor/IngestFilter.hpp"
+#include "processor/IngestQueue.hpp"
+#include "processor/MetricDecoder.hpp"
+#include "processor/UdpIngestListener.hpp"
+#include "utils/AuthUtils.hpp"
+#include <string>
+
+using namespace drogon;
+using json = Json::Value;
+
+namespace api
+{
+
+    /**
+     * @brief Пакетный приём метрик от шлюзов без MQTT
+     *
+     * Тело — JSON (объект или массив) либо компактный бинарный формат
+     * (`Content-Type: application/x-sg-metrics`), см. processor::MetricDecoder.
+     * Необязательный параметр `gh_id` задаёт теплицу для записей без `gh_id`.
+     *
+     * **Пример запроса**
+     * ```
+     * POST /api/ingest?gh_id=3
+     * Authorization: Bearer <valid_token>
+     * Content-Type: application/json
+     *
+     * [{"subtype": "temperature", "value": 21.5, "ts": "2024-01-01 12:00:00"}]
+     * ```
+     *
+     * **Ответы**
+     * - 202 Accepted — пакет поставлен в очередь записи: `{"accepted": 1, "rejected": 0}`
+     * - 400 Bad Request — тело не разобрано или не содержит валидных записей
+     * - 413 Payload Too Large — записей больше max_request_points: пакет не принят
+     *   целиком, `{"error": ..., "limit": 5000, "points": 7000}` — разбейте его и повторите
+     * - 429 Too Many Requests — очередь переполнена, заголовок `Retry-After`
+     * - 503 Service Unavailable — очередь приёма не запущена
+     */
+    void IngestController::ingest(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        auto &queue = processor::IngestQueue::instance();
+        if (!queue.running())
+        {
+            Json::Value error;
+            error["error"] = "Ingest queue is not running";
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k503ServiceUnavailable);
+            callback(resp);
+            return;
+        }
+
+        try
+        {
+            int gh_id = -1;
+            auto gh_param = req->getParameter("gh_id");
+            if (!gh_param.empty())
+                gh_id = std::stoi(gh_param);
+
+            std::string_view body = req->body();
+            auto format = processor::MetricDecoder::detect(req->getHeader("Content-Type"), body);
+            auto res = processor::MetricDecoder::decode(body, format, gh_id, queue.max_request_points());
+
+            // Усечённый пакет не принимается: клиент не отличил бы его хвост от невалидных записей
+            if (!res.malformed && res.truncated > 0)
+            {
+                Json::Value error;
+                error["error"] = "Too many points in request";
+                error["limit"] = static_cast<Json::UInt64>(queue.max_request_points());
+                error["points"] = static_cast<Json::UInt64>(queue.max_request_points() + res.truncated);
+                auto resp = HttpResponse::newHttpJsonResponse(error);
+                resp->setStatusCode(k413RequestEntityTooLarge);
+                callback(resp);
+                return;
+            }
+
+            if (res.malformed || res.metrics.empty())
+            {
+                Json::Value error;
+                error["error"] = res.malformed ? "Malformed payload" : "No valid metrics in payload";
+                error["rejected"] = static_cast<Json::UInt64>(res.rejected);
+                auto resp = HttpResponse::newHttpJsonResponse(error);
+                resp->setStatusCode(k400BadRequest);
+                callback(resp);
+                return;
+            }
+
+            const auto accepted = res.metrics.size();
+            if (!queue.try_push(std::move(res.metrics)))
+            {
+                Json::Value error;
+                error["error"] = "Ingest queue is saturated";
+                auto resp = HttpResponse::newHttpJsonResponse(error);
+                resp->setStatusCode(k429TooManyRequests);
+                resp->addHeader("Retry-After", std::to_string(queue.retry_after()));
+                callback(resp);
+                return;
+            }
+
+            Json::Value result;
+            result["accepted"] = static_cast<Json::UInt64>(accepted);
+            result["rejected"] = static_cast<Json::UInt64>(res.rejected);
+            auto resp = HttpResponse::newHttpJsonResponse(result);
+            resp->setStatusCode(k202Accepted);
+            callback(resp);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR << "ingest error: " << e.what();
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k400BadRequest);
+            resp->setBody(e.what());
+            callback(resp);
+        }
+    }
+
+    /**
+     * @brief Счётчики очереди приёма метрик
+     *
+     * **Пример ответа (200 OK)**
+     * ```json
+     * {"queue": {"accepted_points": 1200, "pending_points": 0, "capacity": 200000, ...}}
+     * ```
+     */
+    void IngestController::get_stats(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        auto s = processor::IngestQueue::instance().stats();
+        Json::Value queue;
+        queue["accepted_batches"] = static_cast<Json::UInt64>(s.accepted_batches);
+        queue["accepted_points"] = static_cast<Json::UInt64>(s.accepted_points);
+        queue["saturated_batches"] = static_cast<Json::UInt64>(s.saturated_batches);
+        queue["stored_points"] = static_cast<Json::UInt64>(s.stored_points);
+        queue["failed_points"] = static_cast<Json::UInt64>(s.failed_points);
+        queue["commits"] = static_cast<Json::UInt64>(s.commits);
+        queue["pending_points"] = static_cast<Json::UInt64>(s.pending_points);
+        queue["capacity"] = static_cast<Json::UInt64>(s.capacity);
+        queue["shed_points"] = static_cast<Json::UInt64>(s.shed_points);
+
+        Json::Value greenhouses(Json::arrayValue);
+        for (const auto &g : s.greenhouses)
+        {
+            Json::Value item;
+            item["gh_id"] = g.gh_id;
+            item["accepted"] = static_cast<Json::UInt64>(g.accepted);
+            item["shed"] = static_cast<Json::UInt64>(g.shed);
+            item["sampled"] = static_cast<Json::UInt64>(g.sampled);
+            item["queued"] = static_cast<Json::UInt64>(g.queued);
+            greenhouses.append(item);
+        }
+        queue["greenhouses"] = greenhouses;
+
+        auto u = processor::UdpIngestListener::stats();
+        Json::Value udp;
+        udp["datagrams"] = static_cast<Json::UInt64>(u.datagrams);
+        udp["truncated_datagrams"] = static_cast<Json::UInt64>(u.truncated_datagrams);
+        udp["malformed_datagrams"] = static_cast<Json::UInt64>(u.malformed_datagrams);
+        udp["malformed_lines"] = static_cast<Json::UInt64>(u.malformed_lines);
+        udp["points"] = static_cast<Json::UInt64>(u.points);
+        udp["dropped_points"] = static_cast<Json::UInt64>(u.dropped_points);
+
+        auto f = processor::IngestFilter::stats();
+        Json::Value filter;
+        filter["kept"] = static_cast<Json::UInt64>(f.kept);
+        filter["dropped"] = static_cast<Json::UInt64>(f.dropped);
+        filter["heartbeats"] = static_cast<Json::UInt64>(f.heartbeats);
+
+        auto d = processor::IngestDedup::stats();
+        Json::Value dedup;
+        dedup["checked"] = static_cast<Json::UInt64>(d.checked);
+        dedup["duplicates"] = static_cast<Json::UInt64>(d.duplicates);
+        dedup["stale"] = static_cast<Json::UInt64>(d.stale);
+        dedup["restarts"] = static_cast<Json::UInt64>(d.restarts);
+
+        Json::Value result;
+        result["queue"] = queue;
+        result["udp"] = udp;
+        result["filter"] = filter;
+        result["dedup"] = dedup;
+        auto resp = HttpResponse::newHttpJsonResponse(result);
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
+
+} // namespace api
@@ -5,6 +5,7 @@
 #include "db/managers/MetricManager.hpp"
 #include "db/managers/GreenhouseManager.hpp"
 #include "db/managers/ComponentManager.hpp"
+#include "processor/LiveMetricCache.hpp"
 #include "utils/AuthUtils.hpp"
 
 using namespace drogon;
@@ -181,7 +182,12 @@ namespace api
             auto subtype = p.at("subtype");
             auto from = p.count("from") ? p.at("from") : "";
             auto to = p.count("to") ? p.at("to") : "";
-            auto metricOpt = metricManager_.get_latest_by_greenhouse_and_subtype(gh_id, subtype, from, to);
+            // Без диапазона отвечаем из live-кэша: он видит и точки, не сохранённые фильтрами
+            std::optional<Metric> metricOpt;
+            if (from.empty() && to.empty())
+                metricOpt = processor::LiveMetricCache::instance().latest(gh_id, subtype);
+            if (!metricOpt)
+                metricOpt = metricManager_.get_latest_by_greenhouse_and_subtype(gh_id, subtype, from, to);
             if (metricOpt)
             {
                 // Использует обновленный toJson() с новыми именами
@@ -2,8 +2,18 @@
 #include <json/json.h>
 #include <trantor/utils/Logger.h>
 #include "entities/Rule.hpp"
+#include "db/managers/MetricManager.hpp"
 #include "db/managers/RuleManager.hpp"
+#include "mqtt_client/MQTTClient.hpp"
+#include "processor/ActuatorStateCache.hpp"
+#include "processor/CommandOutbox.hpp"
+#include "processor/CommandTracker.hpp"
+#include "processor/CronSpec.hpp"
+#include "processor/RuleEngineStats.hpp"
+#include "processor/RuleExpression.hpp"
+#include "processor/RuleReplay.hpp"
 #include "utils/AuthUtils.hpp"
+#include <algorithm>
 #include <string>
 
 using namespace drogon;
@@ -12,6 +22,47 @@ using json = Json::Value;
 namespace api
 {
 
+    namespace
+    {
+        /// Наибольший период прогона истории (/api/rules/replay), сек
+        constexpr std::int64_t kMaxReplaySpan = 31 * 86400;
+
+        /// Проверка выражения, гистерезиса и задержек; пустая строка — ошибок нет
+        std::string validate_dynamics(const Rule &rule)
+        {
+            if (rule.debounce_sec < 0 || rule.min_dwell_sec < 0)
+                return "debounce_sec and min_dwell_sec must be non-negative";
+            if (rule.expression)
+            {
+                std::string error;
+                if (rule.kind != "threshold")
+                    return "expression requires a threshold rule";
+                if (rule.expression->size() > processor::RuleExpression::kMaxLength)
+                    return "expression must not exceed " +
+                           std::to_string(processor::RuleExpression::kMaxLength) + " characters";
+                if (!processor::RuleExpression::compile(*rule.expression, &error))
+                    return "Invalid expression: " + error;
+                if (rule.off_threshold)
+                    return "off_threshold is not supported for expression rules";
+                return {};
+            }
+            if (!rule.off_threshold)
+                return {};
+            if (rule.kind != "threshold" || !rule.threshold || !rule.operator_)
+                return "off_threshold requires a threshold rule";
+
+            // Порог выключения должен лежать по другую сторону от порога включения
+            const auto &op = *rule.operator_;
+            if ((op == ">" || op == ">=") && *rule.off_threshold > *rule.threshold)
+                return "off_threshold must not exceed threshold for '" + op + "'";
+            if ((op == "<" || op == "<=") && *rule.off_threshold < *rule.threshold)
+                return "off_threshold must not be below threshold for '" + op + "'";
+            if (op == "=" || op == "==" || op == "!=")
+                return "off_threshold is not supported for '" + op + "'";
+            return {};
+        }
+    } // namespace
+
     void RuleController::create_rule(
         const HttpRequestPtr &req,
         std::function<void(const HttpResponsePtr &)> &&callback)
@@ -59,14 +110,23 @@ namespace api
             Rule rule = Rule::fromJson(body);
 
             // Валидация данных
-            if (rule.kind == "threshold" && !rule.operator_.has_value())
+            if (rule.kind == "threshold" && !rule.operator_.has_value() && !rule.expression.has_value())
             {
-                throw std::runtime_error("Operator is required for threshold rules");
+                throw std::runtime_error("Operator or expression is required for threshold rules");
             }
             if (rule.kind == "time" && !rule.time_spec.has_value())
             {
                 throw std::runtime_error("Time specification is required for time rules");
             }
+            std::string spec_error;
+            if (rule.kind == "time" && !processor::CronSpec::parse(*rule.time_spec, &spec_error))
+            {
+                throw std::runtime_error("Invalid time specification: " + spec_error);
+            }
+            if (auto dyn_error = validate_dynamics(rule); !dyn_error.empty())
+            {
+                throw std::runtime_error(dyn_error);
+            }
 
             if (!ruleManager_.create(rule))
             {
@@ -201,12 +261,24 @@ namespace api
             rule.time_spec = body["time_spec"].asString();
         if (body.isMember("enabled"))
             rule.enabled = body["enabled"].asBool();
+        if (body.isMember("off_threshold"))
+            rule.off_threshold = body["off_threshold"].isNull()
+                                     ? std::nullopt
+                                     : std::optional<double>(body["off_threshold"].asDouble());
+        if (body.isMember("debounce_sec"))
+            rule.debounce_sec = body["debounce_sec"].asInt();
+        if (body.isMember("min_dwell_sec"))
+            rule.min_dwell_sec = body["min_dwell_sec"].asInt();
+        if (body.isMember("expression"))
+            rule.expression = body["expression"].isNull()
+                                  ? std::nullopt
+                                  : std::optional<std::string>(body["expression"].asString());
 
         // Валидация данных
-        if (rule.kind == "threshold" && !rule.operator_.has_value())
+        if (rule.kind == "threshold" && !rule.operator_.has_value() && !rule.expression.has_value())
         {
             Json::Value error;
-            error["error"] = "Operator is required for threshold rules";
+            error["error"] = "Operator or expression is required for threshold rules";
             auto resp = HttpResponse::newHttpJsonResponse(error);
             resp->setStatusCode(k400BadRequest);
 
@@ -223,6 +295,27 @@ namespace api
             callback(resp);
             return;
         }
+        std::string spec_error;
+        if (rule.kind == "time" && !processor::CronSpec::parse(*rule.time_spec, &spec_error))
+        {
+            Json::Value error;
+            error["error"] = "Invalid time specification: " + spec_error;
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k400BadRequest);
+
+            callback(resp);
+            return;
+        }
+        if (auto dyn_error = validate_dynamics(rule); !dyn_error.empty())
+        {
+            Json::Value error;
+            error["error"] = dyn_error;
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k400BadRequest);
+
+            callback(resp);
+            return;
+        }
 
         if (!ruleManager_.update(rule))
         {
@@ -376,4 +469,298 @@ namespace api
         callback(resp);
     }
 
+    // Счётчики исходящей очереди команд: доставка, повторы, ожидающие и подавленные команды;
+    // время проходов движка правил и самая медленная теплица
+    void RuleController::get_stats(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        auto s = processor::CommandOutbox::stats();
+        Json::Value result;
+        result["enqueued"] = static_cast<Json::UInt64>(s.enqueued);
+        result["delivered"] = static_cast<Json::UInt64>(s.delivered);
+        result["published"] = static_cast<Json::UInt64>(s.published);
+        result["failed"] = static_cast<Json::UInt64>(s.failed);
+        result["timeouts"] = static_cast<Json::UInt64>(s.timeouts);
+        result["resends"] = static_cast<Json::UInt64>(s.resends);
+        result["expired"] = static_cast<Json::UInt64>(s.expired);
+        result["unsaved"] = static_cast<Json::UInt64>(s.unsaved);
+        result["pending"] = static_cast<Json::UInt64>(s.pending);
+        result["in_flight"] = static_cast<Json::UInt64>(s.in_flight);
+        result["last_delivery_ms"] = s.last_delivery_ms;
+        result["suppressed"] = static_cast<Json::UInt64>(processor::ActuatorStateCache::instance().suppressed());
+
+        // Публикации MQTT-клиента: окно и время до ответа брокера
+        auto m = MQTTClient::publish_stats();
+        Json::Value mqtt;
+        mqtt["published"] = static_cast<Json::UInt64>(m.published);
+        mqtt["failed"] = static_cast<Json::UInt64>(m.failed);
+        mqtt["in_flight"] = static_cast<Json::UInt64>(m.in_flight);
+        mqtt["queued"] = static_cast<Json::UInt64>(m.queued);
+        mqtt["buffered"] = static_cast<Json::UInt64>(m.buffered);
+        mqtt["expired"] = static_cast<Json::UInt64>(m.expired);
+        mqtt["replaced"] = static_cast<Json::UInt64>(m.replaced);
+        mqtt["overflow"] = static_cast<Json::UInt64>(m.overflow);
+        mqtt["last_ms"] = m.last_ms;
+        mqtt["avg_ms"] = m.avg_ms;
+        mqtt["max_ms"] = m.max_ms;
+
+        // Подключение: состояние и время от (пере)подключения до SUBACK и первого сообщения
+        auto conn = MQTTClient::connection_stats();
+        mqtt["state"] = MQTTClient::state_name(conn.state);
+        mqtt["connects"] = static_cast<Json::UInt64>(conn.connects);
+        mqtt["subscribe_ms"] = conn.subscribe_ms;
+        mqtt["first_message_ms"] = conn.first_message_ms;
+        result["mqtt"] = mqtt;
+
+        // Движок правил: периодическая проверка и пакеты смен состояния по теплицам
+        auto e = processor::RuleEngineStats::stats();
+        Json::Value engine;
+        engine["ticks"] = static_cast<Json::UInt64>(e.ticks);
+        engine["last_tick_ms"] = e.last_tick_ms;
+        engine["max_tick_ms"] = e.max_tick_ms;
+        engine["batches"] = static_cast<Json::UInt64>(e.batches);
+        engine["partitions"] = static_cast<Json::UInt64>(e.partitions);
+        engine["triggers"] = static_cast<Json::UInt64>(e.triggers);
+        engine["last_batch_ms"] = e.last_batch_ms;
+        engine["max_batch_ms"] = e.max_batch_ms;
+        engine["slowest_gh"] = e.slowest_gh;
+        engine["slowest_partition_ms"] = e.slowest_partition_ms;
+        engine["max_partition_gh"] = e.max_partition_gh;
+        engine["max_partition_ms"] = e.max_partition_ms;
+        result["engine"] = engine;
+        auto resp = HttpResponse::newHttpJsonResponse(result);
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
+
+    // Время от отправки команды до подтверждения устройством (topics.ack):
+    // гистограммы по устройствам и последние команды без ответа
+    void RuleController::get_ack_stats(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+
+        const auto s = processor::CommandTracker::instance().snapshot();
+        Json::Value result;
+        result["pending"] = static_cast<Json::UInt64>(s.pending);
+        result["acked"] = static_cast<Json::UInt64>(s.acked);
+        result["timed_out"] = static_cast<Json::UInt64>(s.timed_out);
+        result["unmatched"] = static_cast<Json::UInt64>(s.unmatched);
+        result["timeout_sec"] = static_cast<Json::Int64>(s.timeout_sec);
+
+        Json::Value series(Json::arrayValue);
+        for (const auto &x : s.series)
+        {
+            const auto &h = x.latency;
+            Json::Value item;
+            item["gh_id"] = x.gh_id;
+            item["comp_id"] = x.comp_id;
+            item["count"] = static_cast<Json::UInt64>(h.count);
+            item["avg_ms"] = h.count ? h.sum_ms / static_cast<double>(h.count) : 0.0;
+            item["max_ms"] = h.max_ms;
+            item["p50_ms"] = h.quantile(0.50);
+            item["p95_ms"] = h.quantile(0.95);
+            item["p99_ms"] = h.quantile(0.99);
+            item["failed"] = static_cast<Json::UInt64>(x.failed);
+            item["timeouts"] = static_cast<Json::UInt64>(x.timeouts);
+
+            // Корзины не накопительные; у последней le = null (больше всех границ)
+            Json::Value buckets(Json::arrayValue);
+            for (size_t i = 0; i < h.buckets.size(); ++i)
+            {
+                Json::Value b;
+                b["le"] = i < processor::LatencyHistogram::kBounds.size()
+                              ? Json::Value(processor::LatencyHistogram::kBounds[i])
+                              : Json::Value();
+                b["count"] = static_cast<Json::UInt64>(h.buckets[i]);
+                buckets.append(b);
+            }
+            item["buckets"] = buckets;
+            series.append(item);
+        }
+        result["series"] = series;
+
+        Json::Value timeouts(Json::arrayValue);
+        for (const auto &t : s.recent_timeouts)
+        {
+            Json::Value item;
+            item["cid"] = t.cid;
+            item["gh_id"] = t.gh_id;
+            item["comp_id"] = t.comp_id;
+            item["rule_id"] = t.rule_id;
+            item["issued_at"] = static_cast<Json::Int64>(t.issued_at);
+            timeouts.append(item);
+        }
+        result["recent_timeouts"] = timeouts;
+
+        auto resp = HttpResponse::newHttpJsonResponse(result);
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
+
+    // Прогон правил по истории теплицы: сколько раз они сработали бы
+    // Тело: gh_id, from и to ("YYYY-MM-DD HH:MM:SS"), необязательные rule_ids
+    // (сохранённые правила, в т.ч. выключенные), rules (непроверенные
+    // черновики), max_timeline. Без rule_ids и rules проверяются все
+    // пороговые правила теплицы. Период длиннее kMaxReplaySpan сокращается
+    // (clamped: true): прогон идёт в потоке обработчика.
+    void RuleController::replay_rules(
+        const HttpRequestPtr &req,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+    {
+        auto auth = validateTokenAndGetRole(req);
+        if (!auth.success)
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k401Unauthorized);
+            resp->setBody("Unauthorized: Invalid or expired token");
+            callback(resp);
+            return;
+        }
+        if (!isAdmin(auth))
+        {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k403Forbidden);
+            resp->setBody("Forbidden: Admin access required");
+            callback(resp);
+            return;
+        }
+
+        Json::CharReaderBuilder builder;
+        json body;
+        std::string errs;
+        std::string body_str(req->getBody());
+        std::istringstream body_stream(body_str);
+        if (!Json::parseFromStream(builder, body_stream, &body, &errs) || !body["gh_id"].isInt())
+        {
+            Json::Value error;
+            error["error"] = errs.empty() ? "Missing 'gh_id' field" : errs;
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k400BadRequest);
+            callback(resp);
+            return;
+        }
+
+        const int gh_id = body["gh_id"].asInt();
+        const auto from_t = processor::RuleReplay::parse_time(body.get("from", "").asString());
+        const auto to_t = processor::RuleReplay::parse_time(body.get("to", "").asString());
+        if (!from_t || !to_t || *to_t < *from_t)
+        {
+            Json::Value error;
+            error["error"] = "'from' and 'to' are required as \"YYYY-MM-DD HH:MM:SS\", from <= to";
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k400BadRequest);
+            callback(resp);
+            return;
+        }
+        const bool clamped = *to_t - *from_t > kMaxReplaySpan;
+        // Границы приводятся к формату ts в БД: строки сравниваются посимвольно
+        const std::string from = processor::RuleReplay::format_time(*from_t);
+        const std::string to = processor::RuleReplay::format_time(clamped ? *from_t + kMaxReplaySpan : *to_t);
+        const auto max_timeline = static_cast<size_t>(std::max(0, body.get("max_timeline", 1000).asInt()));
+
+        db::RuleManager ruleManager_;
+        std::vector<Rule> rules;
+        for (const auto &id : body["rule_ids"])
+        {
+            auto rule = ruleManager_.get_by_id(id.asInt());
+            if (rule && rule->gh_id == gh_id)
+                rules.push_back(std::move(*rule));
+        }
+        // Черновикам присваиваются отрицательные id, чтобы не смешивать их с сохранёнными
+        int draft_id = 0;
+        for (const auto &item : body["rules"])
+        {
+            Rule rule = Rule::fromJson(item);
+            rule.rule_id = --draft_id;
+            rule.gh_id = gh_id;
+            rules.push_back(std::move(rule));
+        }
+        if (body["rule_ids"].empty() && body["rules"].empty())
+            rules = ruleManager_.get_by_greenhouse(gh_id);
+
+        processor::RuleReplay replay(std::move(rules), max_timeline);
+        db::MetricManager metricManager;
+        if (replay.replay(metricManager, gh_id, from, to) < 0)
+        {
+            Json::Value error;
+            error["error"] = "Failed to read metrics";
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k500InternalServerError);
+            callback(resp);
+            return;
+        }
+        const auto report = replay.finish();
+
+        Json::Value result;
+        result["gh_id"] = gh_id;
+        result["from"] = from;
+        result["to"] = to;
+        result["clamped"] = clamped;
+        result["points"] = static_cast<Json::UInt64>(report.points);
+        result["skipped"] = static_cast<Json::UInt64>(report.skipped);
+        result["commands"] = static_cast<Json::UInt64>(report.commands);
+        if (report.first >= 0)
+        {
+            result["first"] = processor::RuleReplay::format_time(report.first);
+            result["last"] = processor::RuleReplay::format_time(report.last);
+        }
+        result["eval_ms"] = report.eval_ms;
+        result["points_per_sec"] = report.points_per_sec();
+
+        Json::Value per_rule(Json::arrayValue);
+        for (const auto &c : report.rules)
+        {
+            Json::Value item;
+            item["rule_id"] = c.rule_id;
+            item["on"] = static_cast<Json::UInt64>(c.on);
+            item["off"] = static_cast<Json::UInt64>(c.off);
+            per_rule.append(item);
+        }
+        result["rules"] = per_rule;
+
+        Json::Value ignored(Json::arrayValue);
+        for (int id : report.ignored)
+            ignored.append(id);
+        result["ignored"] = ignored;
+
+        Json::Value timeline(Json::arrayValue);
+        for (const auto &t : report.timeline)
+        {
+            Json::Value item;
+            item["rule_id"] = t.rule.rule_id;
+            item["to_component"] = t.rule.to_comp_id;
+            item["at"] = processor::RuleReplay::format_time(t.at);
+            item["state"] = t.active ? "on" : "off";
+            item["value"] = t.value;
+            timeline.append(item);
+        }
+        result["timeline"] = timeline;
+        result["truncated"] = report.truncated;
+
+        auto resp = HttpResponse::newHttpJsonResponse(result);
+        resp->setStatusCode(k200OK);
+        callback(resp);
+    }
+
 } // namespace api
\ No newline at end of file
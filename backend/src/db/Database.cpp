@@ -24,7 +24,7 @@ Database::Database(const std::string &db_path) : db_(nullptr), db_path_(db_path)
 
 Database::~Database()
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
     if (db_)
     {
         sqlite3_close(db_);
@@ -35,7 +35,7 @@ Database::~Database()
 // Core database operations
 bool Database::open_connection()
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
 
     if (sqlite3_open(db_path_.c_str(), &db_) != SQLITE_OK)
     {
@@ -123,12 +123,18 @@ bool Database::initialize()
             std::string current_version = get_schema_version();
             if (current_version != DATABASE_VERSION)
             {
-                LOG_WARN_SG("Schema version mismatch: expected " + std::string(DATABASE_VERSION) +
-                            ", found " + current_version);
+                LOG_WARN_SG("Schema version mismatch: expected {}, found {}", DATABASE_VERSION,
+                            current_version);
                 // TODO: implement schema migration logic
             }
         }
 
+        if (!create_service_tables())
+        {
+            LOG_ERROR_SG("Failed to create service tables");
+            return false;
+        }
+
         if (!transaction.commit())
         {
             LOG_ERROR_SG("Failed to commit initialization transaction");
@@ -140,7 +146,7 @@ bool Database::initialize()
     }
     catch (const std::exception &e)
     {
-        LOG_ERROR_SG("Database initialization failed: " + std::string(e.what()));
+        LOG_ERROR_SG("Database initialization failed: {}", e.what());
         return false;
     }
 }
@@ -207,7 +213,11 @@ bool Database::create_tables()
             time_spec     TEXT,  
             enabled       BOOLEAN NOT NULL DEFAULT 1,  
             created_at    DATETIME DEFAULT CURRENT_TIMESTAMP,  
-            updated_at    DATETIME DEFAULT CURRENT_TIMESTAMP  
+            updated_at    DATETIME DEFAULT CURRENT_TIMESTAMP,
+            off_threshold REAL,
+            debounce_sec  INTEGER NOT NULL DEFAULT 0 CHECK(debounce_sec >= 0),
+            min_dwell_sec INTEGER NOT NULL DEFAULT 0 CHECK(min_dwell_sec >= 0),
+            expression    TEXT
         ); 
 
         -- 5. Пользователи  
@@ -271,10 +281,70 @@ bool Database::create_indexes()
     return execute_sql(sql);
 }
 
+bool Database::create_service_tables()
+{
+    const char *sql = R"(
+        -- Отметки приёма по порядковым номерам датчиков (отбрасывание повторов)
+        CREATE TABLE IF NOT EXISTS ingest_watermarks (
+            gh_id         INTEGER NOT NULL,
+            subtype       TEXT NOT NULL,
+            high_seq      INTEGER NOT NULL,
+            seen_mask     INTEGER NOT NULL,
+            updated_at    DATETIME DEFAULT CURRENT_TIMESTAMP,
+            PRIMARY KEY (gh_id, subtype)
+        ) WITHOUT ROWID;
+
+        -- Последнее срабатывание правил по расписанию (однократность после перезапуска)
+        CREATE TABLE IF NOT EXISTS rule_fires (
+            rule_id       INTEGER PRIMARY KEY REFERENCES rules(rule_id) ON DELETE CASCADE,
+            last_fired    INTEGER NOT NULL
+        );
+
+        -- Состояние пороговых правил (без повторной команды после перезапуска)
+        CREATE TABLE IF NOT EXISTS rule_states (
+            rule_id       INTEGER PRIMARY KEY REFERENCES rules(rule_id) ON DELETE CASCADE,
+            active        INTEGER NOT NULL,
+            since         INTEGER NOT NULL
+        );
+
+        -- Исходящие команды: хранятся до подтверждения брокером, затем retention_hours
+        CREATE TABLE IF NOT EXISTS command_outbox (
+            id            INTEGER PRIMARY KEY AUTOINCREMENT,
+            gh_id         INTEGER NOT NULL,
+            payload       TEXT NOT NULL,
+            created_at    INTEGER NOT NULL,
+            attempts      INTEGER NOT NULL DEFAULT 0,
+            delivered_at  INTEGER
+        );
+        CREATE INDEX IF NOT EXISTS idx_command_outbox_pending
+            ON command_outbox(id) WHERE delivered_at IS NULL;
+    )";
+
+    if (!execute_sql(sql))
+        return false;
+
+    // Столбцы, добавленные в rules после версии 1.0.0 (в конец таблицы)
+    const std::pair<const char *, const char *> rule_columns[] = {
+        {"off_threshold", "REAL"},
+        {"debounce_sec", "INTEGER NOT NULL DEFAULT 0 CHECK(debounce_sec >= 0)"},
+        {"min_dwell_sec", "INTEGER NOT NULL DEFAULT 0 CHECK(min_dwell_sec >= 0)"},
+        {"expression", "TEXT"},
+    };
+    for (const auto &[name, definition] : rule_columns)
+    {
+        if (!column_exists("rules", name) &&
+            !execute_sql(std::string("ALTER TABLE rules ADD COLUMN ") + name + " " + definition))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Statement management
 sqlite3_stmt *Database::prepare_statement(const std::string &sql) const
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
 
     if (!db_)
     {
@@ -300,6 +370,7 @@ bool Database::execute_statement(sqlite3_stmt *stmt) const
         return false;
     }
 
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
     const int result = sqlite3_step(stmt);
     const bool success = (result == SQLITE_DONE || result == SQLITE_ROW);
 
@@ -322,7 +393,7 @@ void Database::finalize_statement(sqlite3_stmt *stmt) const
 
 bool Database::execute_sql(const std::string &sql)
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
 
     if (!db_)
     {
@@ -335,8 +406,7 @@ bool Database::execute_sql(const std::string &sql)
 
     if (result != SQLITE_OK)
     {
-        std::string error = errMsg ? errMsg : "Unknown error";
-        LOG_ERROR_SG("execute_sql failed: " + sql + " | Error: " + error);
+        LOG_ERROR_SG("execute_sql failed: {} | Error: {}", sql, errMsg ? errMsg : "Unknown error");
         if (errMsg)
         {
             sqlite3_free(errMsg);
@@ -441,7 +511,7 @@ Database::DatabaseInfo Database::get_database_info() const
     }
     catch (const std::exception &e)
     {
-        LOG_WARN_SG("Failed to get database file size: " + std::string(e.what()));
+        LOG_WARN_SG("Failed to get database file size: {}", e.what());
     }
 
     // Count rows in each table
@@ -473,7 +543,7 @@ Database::DatabaseInfo Database::get_database_info() const
 
 bool Database::create_backup(const std::string &backup_path) const
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
 
     if (!db_)
     {
@@ -484,7 +554,7 @@ bool Database::create_backup(const std::string &backup_path) const
     sqlite3 *backup_db = nullptr;
     if (sqlite3_open(backup_path.c_str(), &backup_db) != SQLITE_OK)
     {
-        LOG_ERROR_SG("Failed to open backup database: " + backup_path);
+        LOG_ERROR_SG("Failed to open backup database: {}", backup_path);
         return false;
     }
 
@@ -502,11 +572,11 @@ bool Database::create_backup(const std::string &backup_path) const
 
     if (result != SQLITE_DONE)
     {
-        LOG_ERROR_SG("Backup failed with code: " + std::to_string(result));
+        LOG_ERROR_SG("Backup failed with code: {}", result);
         return false;
     }
 
-    LOG_INFO_SG("Database backup created: " + backup_path);
+    LOG_INFO_SG("Database backup created: {}", backup_path);
     return true;
 }
 
@@ -566,7 +636,7 @@ Database::parse_timestamp(const std::string &timestamp)
 
 sqlite3_int64 Database::get_last_insert_rowid() const
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
     if (!db_)
     {
         LOG_ERROR_SG("Database not connected");
@@ -580,23 +650,20 @@ void Database::log_sqlite_error(const std::string &operation) const
 {
     if (!db_)
     {
-        LOG_ERROR_SG("SQLite error in [" + operation + "]: Database not connected");
+        LOG_ERROR_SG("SQLite error in [{}]: Database not connected", operation);
         return;
     }
 
     const char *errMsg = sqlite3_errmsg(db_);
     const int errCode = sqlite3_errcode(db_);
 
-    std::string fullMsg = "SQLite error in [" + operation + "] (code: " +
-                          std::to_string(errCode) + "): " +
-                          (errMsg ? errMsg : "Unknown error");
-
-    LOG_ERROR_SG(fullMsg);
+    LOG_ERROR_SG("SQLite error in [{}] (code: {}): {}", operation, errCode,
+                 errMsg ? errMsg : "Unknown error");
 }
 
 std::string Database::get_last_error() const
 {
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    std::lock_guard<std::recursive_mutex> lock(db_mutex_);
 
     if (!db_)
     {
@@ -609,7 +676,7 @@ std::string Database::get_last_error() const
 
 // Transaction RAII implementation
 Database::Transaction::Transaction()
-    : db_(Database::getInstance()), success_(false), committed_(false)
+    : db_(Database::getInstance()), lock_(db_->db_mutex_), success_(false), committed_(false)
 {
     success_ = db_->begin_transaction();
     if (!success_)
@@ -0,0 +1,129 @@
+#include "db/managers/CommandOutboxManager.hpp"
+
+using namespace db;
+
+std::vector<std::int64_t> CommandOutboxManager::enqueue(
+    const std::vector<std::pair<int, std::string>> &commands, std::int64_t created_at)
+{
+    std::vector<std::int64_t> ids;
+    if (commands.empty())
+        return ids;
+
+    Database::Transaction transaction;
+    if (!transaction.is_valid())
+        return ids;
+
+    // id берётся из RETURNING, а не last_insert_rowid(): тот общий на соединение
+    const std::string sql =
+        "INSERT INTO command_outbox (gh_id, payload, created_at) VALUES (?, ?, ?) RETURNING id";
+
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return ids;
+
+    ids.reserve(commands.size());
+    for (const auto &[gh_id, payload] : commands)
+    {
+        sqlite3_reset(stmt.get());
+
+        sqlite3_bind_int(stmt.get(), 1, gh_id);
+        sqlite3_bind_text(stmt.get(), 2, payload.c_str(), static_cast<int>(payload.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt.get(), 3, created_at);
+
+        if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+        {
+            LOG_ERROR_SG("Outbox insert failed at step");
+            ids.clear();
+            return ids;
+        }
+        ids.push_back(sqlite3_column_int64(stmt.get(), 0));
+    }
+    // Незавершённый INSERT ... RETURNING не даст зафиксировать транзакцию
+    sqlite3_reset(stmt.get());
+
+    if (!transaction.commit())
+        ids.clear();
+    return ids;
+}
+
+std::vector<OutboxRecord> CommandOutboxManager::load_pending()
+{
+    std::vector<OutboxRecord> records;
+    const std::string sql = R"(
+        SELECT id, gh_id, payload, created_at FROM command_outbox
+        WHERE delivered_at IS NULL ORDER BY id
+    )";
+
+    // Без блокировки курсор увидел бы строки ещё не зафиксированного enqueue
+    auto lock = db_->lock();
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+    {
+        LOG_ERROR_SG("Failed to prepare statement for CommandOutbox::load_pending");
+        return records;
+    }
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        OutboxRecord r;
+        r.id = sqlite3_column_int64(stmt.get(), 0);
+        r.gh_id = sqlite3_column_int(stmt.get(), 1);
+        r.payload = reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 2));
+        r.created_at = sqlite3_column_int64(stmt.get(), 3);
+        records.push_back(std::move(r));
+    }
+
+    return records;
+}
+
+bool CommandOutboxManager::mark_delivered(const std::vector<OutboxDelivery> &deliveries)
+{
+    if (deliveries.empty())
+        return true;
+
+    Database::Transaction transaction;
+    if (!transaction.is_valid())
+        return false;
+
+    const std::string sql =
+        "UPDATE command_outbox SET delivered_at = ?, attempts = ? WHERE id = ?";
+
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return false;
+
+    for (const auto &d : deliveries)
+    {
+        sqlite3_reset(stmt.get());
+
+        sqlite3_bind_int64(stmt.get(), 1, d.delivered_at);
+        sqlite3_bind_int(stmt.get(), 2, d.attempts);
+        sqlite3_bind_int64(stmt.get(), 3, d.id);
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            LOG_ERROR_SG("Outbox delivery update failed at step");
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+int CommandOutboxManager::prune_delivered(std::int64_t before)
+{
+    const std::string sql =
+        "DELETE FROM command_outbox WHERE delivered_at IS NOT NULL AND delivered_at < ?";
+
+    // sqlite3_changes относится к последнему запросу соединения
+    auto lock = db_->lock();
+    auto stmt = db_->prepare_statement(sql);
+    if (!stmt)
+        return -1;
+
+    sqlite3_bind_int64(stmt, 1, before);
+
+    const bool success = db_->execute_statement(stmt);
+    db_->finalize_statement(stmt);
+    return success ? sqlite3_changes(db_->db_) : -1;
+}
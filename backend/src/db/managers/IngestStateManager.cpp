@@ -0,0 +1,70 @@
+#include "db/managers/IngestStateManager.hpp"
+
+using namespace db;
+
+std::vector<SeqWatermark> IngestStateManager::load_watermarks()
+{
+    std::vector<SeqWatermark> marks;
+    const std::string sql = "SELECT gh_id, subtype, high_seq, seen_mask FROM ingest_watermarks";
+
+    auto lock = db_->lock();
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+    {
+        LOG_ERROR_SG("Failed to prepare statement for IngestState::load_watermarks");
+        return marks;
+    }
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        SeqWatermark m;
+        m.gh_id = sqlite3_column_int(stmt.get(), 0);
+        m.subtype = reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 1));
+        m.high_seq = sqlite3_column_int64(stmt.get(), 2);
+        m.seen_mask = static_cast<std::uint64_t>(sqlite3_column_int64(stmt.get(), 3));
+        marks.push_back(std::move(m));
+    }
+
+    return marks;
+}
+
+bool IngestStateManager::save_watermarks(const std::vector<SeqWatermark> &marks)
+{
+    if (marks.empty())
+        return true;
+
+    Database::Transaction transaction;
+    if (!transaction.is_valid())
+        return false;
+
+    const std::string sql = R"(
+        INSERT INTO ingest_watermarks (gh_id, subtype, high_seq, seen_mask)
+        VALUES (?, ?, ?, ?)
+        ON CONFLICT(gh_id, subtype) DO UPDATE SET
+            high_seq = excluded.high_seq,
+            seen_mask = excluded.seen_mask,
+            updated_at = CURRENT_TIMESTAMP
+    )";
+
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return false;
+
+    for (const auto &m : marks)
+    {
+        sqlite3_reset(stmt.get());
+
+        sqlite3_bind_int(stmt.get(), 1, m.gh_id);
+        sqlite3_bind_text(stmt.get(), 2, m.subtype.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt.get(), 3, m.high_seq);
+        sqlite3_bind_int64(stmt.get(), 4, static_cast<sqlite3_int64>(m.seen_mask));
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            LOG_ERROR_SG("Watermark upsert failed at step");
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
@@ -105,6 +105,58 @@ std::vector<Metric> MetricManager::get_by_greenhouse(int gh_id,
     return get_metrics_with_params(sql, params);
 }
 
+std::int64_t MetricManager::scan_by_greenhouse(int gh_id,
+                                               const std::string &from_time,
+                                               const std::string &to_time,
+                                               const MetricVisitor &visit)
+{
+    std::string sql = R"(
+        SELECT ts, subtype, value
+        FROM metrics
+        WHERE gh_id = ?
+    )";
+    if (!from_time.empty())
+        sql += " AND ts >= ?";
+    if (!to_time.empty())
+        sql += " AND ts <= ?";
+    // metric_id упорядочивает точки с одинаковым временем в порядке записи
+    sql += " ORDER BY ts ASC, metric_id ASC";
+
+    // Соединение занято до конца обхода, поэтому период ограничивают
+    // вызывающие (/api/rules/replay — не больше 31 дня)
+    auto lock = db_->lock();
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return -1;
+
+    int param = 1;
+    sqlite3_bind_int(stmt.get(), param++, gh_id);
+    if (!from_time.empty())
+        sqlite3_bind_text(stmt.get(), param++, from_time.c_str(), -1, SQLITE_TRANSIENT);
+    if (!to_time.empty())
+        sqlite3_bind_text(stmt.get(), param++, to_time.c_str(), -1, SQLITE_TRANSIENT);
+
+    std::int64_t rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        const auto *ts = reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 0));
+        const int ts_len = sqlite3_column_bytes(stmt.get(), 0);
+        const auto *subtype = reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 1));
+        const int subtype_len = sqlite3_column_bytes(stmt.get(), 1);
+        visit(ts ? std::string_view(ts, ts_len) : std::string_view{},
+              subtype ? std::string_view(subtype, subtype_len) : std::string_view{},
+              sqlite3_column_double(stmt.get(), 2));
+        ++rows;
+    }
+    if (rc != SQLITE_DONE)
+    {
+        LOG_ERROR_SG("Metric scan for GH {} failed: {}", gh_id, sqlite3_errmsg(sqlite3_db_handle(stmt.get())));
+        return -1;
+    }
+    return rows;
+}
+
 std::vector<Metric> MetricManager::get_by_subtype(const std::string &subtype,
                                                   const std::string &from_time,
                                                   const std::string &to_time,
@@ -240,7 +292,7 @@ std::optional<double> MetricManager::get_aggregate_value(const std::string &agg_
     SQLiteStmt stmt(db_->prepare_statement(sql));
     if (!stmt)
     {
-        LOG_ERROR_SG("Failed to prepare statement for %s", agg_function.c_str());
+        LOG_ERROR_SG("Failed to prepare statement for {}", agg_function);
         return std::nullopt;
     }
 
@@ -256,7 +308,7 @@ std::optional<double> MetricManager::get_aggregate_value(const std::string &agg_
             }
             catch (...)
             {
-                LOG_ERROR_SG("Invalid integer parameter: %s", value + 2);
+                LOG_ERROR_SG("Invalid integer parameter: {}", value + 2);
                 return std::nullopt;
             }
         }
@@ -268,7 +320,7 @@ std::optional<double> MetricManager::get_aggregate_value(const std::string &agg_
 
     if (sqlite3_step(stmt.get()) != SQLITE_ROW)
     {
-        LOG_INFO_SG("No result for %s", agg_function.c_str());
+        LOG_INFO_SG("No result for {}", agg_function);
         return std::nullopt;
     }
 
@@ -350,7 +402,7 @@ std::vector<Metric> MetricManager::get_metrics_with_params(
             }
             catch (...)
             {
-                LOG_ERROR_SG("Invalid integer parameter: %s", value + 2);
+                LOG_ERROR_SG("Invalid integer parameter: {}", value + 2);
                 return {};
             }
         }
@@ -1,15 +1,63 @@
 #include "db/managers/RuleManager.hpp"
 #include <algorithm>
+#include <mutex>
 
 using namespace db;
 
+namespace
+{
+    struct ChangeListeners
+    {
+        std::mutex mutex;
+        std::vector<RuleManager::ChangeListener> listeners;
+    };
+
+    ChangeListeners &change_listeners()
+    {
+        static ChangeListeners l;
+        return l;
+    }
+}
+
+void RuleManager::add_change_listener(ChangeListener listener)
+{
+    auto &l = change_listeners();
+    std::lock_guard<std::mutex> lock(l.mutex);
+    l.listeners.push_back(std::move(listener));
+}
+
+void RuleManager::notify_changed(int rule_id, bool removed)
+{
+    auto &l = change_listeners();
+    std::vector<ChangeListener> listeners;
+    {
+        std::lock_guard<std::mutex> lock(l.mutex);
+        if (l.listeners.empty())
+            return;
+        listeners = l.listeners;
+    }
+
+    std::optional<Rule> rule;
+    if (!removed)
+    {
+        rule = get_by_id(rule_id);
+        if (!rule)
+            return;
+    }
+    for (const auto &listener : listeners)
+    {
+        listener(rule_id, rule);
+    }
+}
+
 bool RuleManager::create(Rule &rule)
 {
     const std::string sql = R"(
         INSERT INTO rules (
             gh_id, name, from_comp_id, to_comp_id, kind, 
-            operator, threshold, time_spec, enabled
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+            operator, threshold, time_spec, enabled,
+            off_threshold, debounce_sec, min_dwell_sec, expression
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
 
     auto stmt = db_->prepare_statement(sql);
@@ -51,6 +99,7 @@ bool RuleManager::create(Rule &rule)
     }
 
     sqlite3_bind_int(stmt, 9, rule.enabled ? 1 : 0);
+    bind_dynamics(stmt, 10, rule);
 
     if (!db_->execute_statement(stmt))
     {
@@ -69,6 +118,7 @@ bool RuleManager::create(Rule &rule)
         rule.updated_at = full_rule->updated_at;
     }
 
+    notify_changed(rule.rule_id, false);
     return true;
 }
 
@@ -84,7 +134,11 @@ bool RuleManager::update(const Rule &rule)
             operator = ?,
             threshold = ?,
             time_spec = ?,
-            enabled = ?
+            enabled = ?,
+            off_threshold = ?,
+            debounce_sec = ?,
+            min_dwell_sec = ?,
+            expression = ?
         WHERE rule_id = ?
     )";
 
@@ -127,10 +181,13 @@ bool RuleManager::update(const Rule &rule)
     }
 
     sqlite3_bind_int(stmt, 9, rule.enabled ? 1 : 0);
-    sqlite3_bind_int(stmt, 10, rule.rule_id);
+    bind_dynamics(stmt, 10, rule);
+    sqlite3_bind_int(stmt, 14, rule.rule_id);
 
     const bool success = db_->execute_statement(stmt);
     db_->finalize_statement(stmt);
+    if (success)
+        notify_changed(rule.rule_id, false);
     return success;
 }
 
@@ -144,6 +201,8 @@ bool RuleManager::remove(int rule_id)
     sqlite3_bind_int(stmt, 1, rule_id);
     const bool success = db_->execute_statement(stmt);
     db_->finalize_statement(stmt);
+    if (success)
+        notify_changed(rule_id, true);
     return success;
 }
 
@@ -153,7 +212,8 @@ std::optional<Rule> RuleManager::get_by_id(int rule_id)
         SELECT 
             rule_id, gh_id, name, from_comp_id, to_comp_id,
             kind, operator, threshold, time_spec, enabled,
-            created_at, updated_at
+            created_at, updated_at,
+            off_threshold, debounce_sec, min_dwell_sec, expression
         FROM rules 
         WHERE rule_id = ?
     )";
@@ -182,7 +242,8 @@ std::vector<Rule> RuleManager::get_by_greenhouse(int gh_id)
         SELECT 
             rule_id, gh_id, name, from_comp_id, to_comp_id,
             kind, operator, threshold, time_spec, enabled,
-            created_at, updated_at
+            created_at, updated_at,
+            off_threshold, debounce_sec, min_dwell_sec, expression
         FROM rules 
         WHERE gh_id = ?
     )";
@@ -209,7 +270,8 @@ std::vector<Rule> RuleManager::get_active_rules()
         SELECT 
             rule_id, gh_id, name, from_comp_id, to_comp_id,
             kind, operator, threshold, time_spec, enabled,
-            created_at, updated_at
+            created_at, updated_at,
+            off_threshold, debounce_sec, min_dwell_sec, expression
         FROM rules 
         WHERE enabled = 1
     )";
@@ -259,6 +321,8 @@ bool RuleManager::toggle_rule(int rule_id, bool enabled)
 
     const bool success = db_->execute_statement(stmt);
     db_->finalize_statement(stmt);
+    if (success)
+        notify_changed(rule_id, false);
     return success;
 }
 
@@ -282,6 +346,123 @@ bool RuleManager::is_rule_active(int rule_id)
     return enabled;
 }
 
+bool RuleManager::record_fired(int rule_id, std::int64_t fired_at)
+{
+    const std::string sql = R"(
+        INSERT INTO rule_fires (rule_id, last_fired) VALUES (?, ?)
+        ON CONFLICT(rule_id) DO UPDATE SET last_fired = excluded.last_fired
+    )";
+    auto stmt = db_->prepare_statement(sql);
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, rule_id);
+    sqlite3_bind_int64(stmt, 2, fired_at);
+
+    const bool success = db_->execute_statement(stmt);
+    db_->finalize_statement(stmt);
+    return success;
+}
+
+std::unordered_map<int, std::int64_t> RuleManager::get_last_fired()
+{
+    std::unordered_map<int, std::int64_t> fired;
+    const std::string sql = "SELECT rule_id, last_fired FROM rule_fires";
+
+    auto lock = db_->lock();
+    auto stmt = db_->prepare_statement(sql);
+    if (!stmt)
+        return fired;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        fired.emplace(sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1));
+    }
+
+    db_->finalize_statement(stmt);
+    return fired;
+}
+
+bool RuleManager::save_rule_states(const std::vector<RuleStateRecord> &states)
+{
+    if (states.empty())
+        return true;
+
+    Database::Transaction transaction;
+    if (!transaction.is_valid())
+        return false;
+
+    const std::string sql = R"(
+        INSERT INTO rule_states (rule_id, active, since) VALUES (?, ?, ?)
+        ON CONFLICT(rule_id) DO UPDATE SET active = excluded.active, since = excluded.since
+    )";
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return false;
+
+    for (const auto &st : states)
+    {
+        sqlite3_reset(stmt.get());
+        sqlite3_bind_int(stmt.get(), 1, st.rule_id);
+        sqlite3_bind_int(stmt.get(), 2, st.active ? 1 : 0);
+        sqlite3_bind_int64(stmt.get(), 3, st.since);
+
+        // Правило могло быть удалено, пока команда ждала отправки
+        const int rc = sqlite3_step(stmt.get());
+        if (rc != SQLITE_DONE && rc != SQLITE_CONSTRAINT)
+        {
+            LOG_ERROR_SG("Rule state upsert failed at step");
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+std::vector<RuleStateRecord> RuleManager::get_rule_states()
+{
+    std::vector<RuleStateRecord> states;
+    const std::string sql = "SELECT rule_id, active, since FROM rule_states";
+
+    auto lock = db_->lock();
+    SQLiteStmt stmt(db_->prepare_statement(sql));
+    if (!stmt)
+        return states;
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        RuleStateRecord st;
+        st.rule_id = sqlite3_column_int(stmt.get(), 0);
+        st.active = sqlite3_column_int(stmt.get(), 1) != 0;
+        st.since = sqlite3_column_int64(stmt.get(), 2);
+        states.push_back(st);
+    }
+
+    return states;
+}
+
+void RuleManager::bind_dynamics(sqlite3_stmt *stmt, int first, const Rule &rule) const
+{
+    if (rule.off_threshold)
+    {
+        sqlite3_bind_double(stmt, first, *rule.off_threshold);
+    }
+    else
+    {
+        sqlite3_bind_null(stmt, first);
+    }
+    sqlite3_bind_int(stmt, first + 1, rule.debounce_sec);
+    sqlite3_bind_int(stmt, first + 2, rule.min_dwell_sec);
+    if (rule.expression)
+    {
+        sqlite3_bind_text(stmt, first + 3, rule.expression->c_str(), -1, SQLITE_TRANSIENT);
+    }
+    else
+    {
+        sqlite3_bind_null(stmt, first + 3);
+    }
+}
+
 Rule RuleManager::parse_rule_from_db(sqlite3_stmt *stmt) const
 {
     Rule rule;
@@ -312,5 +493,17 @@ Rule RuleManager::parse_rule_from_db(sqlite3_stmt *stmt) const
     rule.created_at = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 10));
     rule.updated_at = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 11));
 
+    // Столбцы гистерезиса и выражения добавлены в конец таблицы, поэтому SELECT * тоже подходит
+    if (sqlite3_column_type(stmt, 12) != SQLITE_NULL)
+    {
+        rule.off_threshold = sqlite3_column_double(stmt, 12);
+    }
+    rule.debounce_sec = sqlite3_column_int(stmt, 13);
+    rule.min_dwell_sec = sqlite3_column_int(stmt, 14);
+    if (sqlite3_column_type(stmt, 15) != SQLITE_NULL)
+    {
+        rule.expression = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 15));
+    }
+
     return rule;
 }
\ No newline at end of file
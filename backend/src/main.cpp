@@ -3,12 +3,17 @@
 #include "plugins/JwtPlugin.hpp"
 #include <chrono>
 #include <cassert>
+#include <iomanip>
 #include <iostream>
 #include <csignal>
+#include <limits>
 #include "config/ConfigLoader.hpp"
 #include <memory>
 #include "utils/PasswordHasher.hpp"
+#include "utils/TrantorLog.hpp"
 #include "db/Database.hpp"
+#include "db/managers/MetricManager.hpp"
+#include "db/managers/RuleManager.hpp"
 #include "db/managers/UserManager.hpp"
 #include "entities/User.hpp"
 #include <optional>
@@ -18,6 +23,7 @@
 #include <drogon/HttpAppFramework.h>
 #include <drogon/HttpResponse.h>
 #include "trantor/utils/Logger.h"
+#include "processor/RuleReplay.hpp"
 #include "processor/ServerProcessor.hpp"
 #include <boost/asio/io_context.hpp>
 
@@ -100,6 +106,7 @@ void testDatabase();
 void runRestServer();
 void printBanner();
 void testAuthController();
+int replayRules(int argc, char *argv[]);
 
 /* ---------- обработчик сигналов ---------- */
 namespace
@@ -124,6 +131,7 @@ namespace
 int main(int argc, char *argv[])
 {
     INIT_LOGGER_DEFAULT_SG();
+    utils_sg::attachTrantorLogging();
     std::signal(SIGINT, onSignal);
     std::signal(SIGTERM, onSignal);
 
@@ -140,11 +148,17 @@ int main(int argc, char *argv[])
             testAuthController();
             return 0;
         }
+        else if (command == "--replay")
+        {
+            return replayRules(argc, argv);
+        }
         else if (command == "--run")
         {
             ConfigLoader cfgLoader;
             boost::asio::io_context ioc;
             auto cfg = cfgLoader.load("./config");
+            Logger::instance().set_overflow(Logger::overflow_from(cfg.logging.overflow));
+            Logger::instance().set_deferred(cfg.logging.deferred);
 
             // Создаем и инициализируем ServerProcessor
             processor::ServerProcessor business_logic(ioc, cfg);
@@ -172,7 +186,9 @@ int main(int argc, char *argv[])
     std::cerr << "Usage: " << argv[0] << " [option]\n"
               << "Options:\n"
               << "  --test   Run all tests\n"
-              << "  --run    Start REST API server\n";
+              << "  --run    Start REST API server\n"
+              << "  --replay GH_ID [FROM [TO]] [RULE_ID...]\n"
+              << "           Replay stored metrics through threshold rules\n";
     return 1;
 }
 
@@ -390,4 +406,88 @@ void runRestServer()
     }
 
     LOG_INFO << "Server shutdown";
-}
\ No newline at end of file
+}
+
+// Воспроизведение истории теплицы: --replay GH_ID [FROM [TO]] [RULE_ID...]
+// Время — в формате БД ("YYYY-MM-DD HH:MM:SS"); без RULE_ID проверяются
+// все пороговые правила теплицы, включая выключенные. История читается
+// курсором, память не зависит от длины периода
+int replayRules(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " --replay GH_ID [FROM [TO]] [RULE_ID...]\n";
+        return 1;
+    }
+
+    int gh_id = 0;
+    std::string from, to;
+    std::vector<int> rule_ids;
+    try
+    {
+        gh_id = std::stoi(argv[2]);
+        for (int i = 3; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (processor::RuleReplay::parse_time(arg))
+                (from.empty() ? from : to) = arg;
+            else
+                rule_ids.push_back(std::stoi(arg));
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid argument; times must be \"YYYY-MM-DD HH:MM:SS\"\n";
+        return 1;
+    }
+
+    if (!db::Database::getInstance()->initialize())
+    {
+        std::cerr << "Database initialization: FAILURE" << std::endl;
+        return 1;
+    }
+
+    db::RuleManager ruleManager;
+    std::vector<Rule> rules;
+    if (rule_ids.empty())
+        rules = ruleManager.get_by_greenhouse(gh_id);
+    for (int id : rule_ids)
+        if (auto rule = ruleManager.get_by_id(id))
+            rules.push_back(std::move(*rule));
+
+    processor::RuleReplay replay(std::move(rules), std::numeric_limits<size_t>::max());
+    db::MetricManager metricManager;
+    const auto rows = replay.replay(metricManager, gh_id, from, to);
+    if (rows < 0)
+    {
+        std::cerr << "Failed to read metrics for GH " << gh_id << std::endl;
+        return 1;
+    }
+    const auto report = replay.finish();
+
+    for (const auto &t : report.timeline)
+    {
+        std::cout << processor::RuleReplay::format_time(t.at) << "  rule " << t.rule.rule_id
+                  << " -> " << (t.active ? "on " : "off") << "  component " << t.rule.to_comp_id
+                  << "  value " << t.value << "\n";
+    }
+    std::cout << "\nRule        on      off\n";
+    for (const auto &c : report.rules)
+    {
+        std::cout << std::left << std::setw(8) << c.rule_id << std::right
+                  << std::setw(6) << c.on << std::setw(9) << c.off << "\n";
+    }
+    for (int id : report.ignored)
+        std::cout << "Rule " << id << " skipped (not a valid threshold rule)\n";
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "\nGreenhouse " << gh_id << ": " << rows << " rows read, "
+              << report.points << " points replayed, " << report.skipped << " skipped\n";
+    if (report.first >= 0)
+        std::cout << "Period: " << processor::RuleReplay::format_time(report.first)
+                  << " .. " << processor::RuleReplay::format_time(report.last) << "\n";
+    std::cout << "Commands: " << report.commands << "\n"
+              << "Replay: " << report.eval_ms << " ms ("
+              << report.points_per_sec() / 1e6 << " M points/s)" << std::endl;
+    return 0;
+}
@@ -1,8 +1,274 @@
 #include "mqtt_client/MQTTClient.hpp"
+#include <boost/asio/post.hpp>
+#include <algorithm>
 #include <chrono>
 
 using namespace std::chrono_literals;
 
+namespace
+{
+    struct PublishCounters
+    {
+        std::atomic<std::uint64_t> published{0};
+        std::atomic<std::uint64_t> failed{0};
+        std::atomic<std::uint64_t> in_flight{0};
+        std::atomic<std::uint64_t> queued{0};
+        std::atomic<std::uint64_t> buffered{0};
+        std::atomic<std::uint64_t> expired{0};
+        std::atomic<std::uint64_t> replaced{0};
+        std::atomic<std::uint64_t> overflow{0};
+        std::atomic<std::uint64_t> total_us{0};
+        std::atomic<std::uint64_t> last_us{0};
+        std::atomic<std::uint64_t> max_us{0};
+    };
+
+    PublishCounters& publish_counters()
+    {
+        static PublishCounters c;
+        return c;
+    }
+
+    struct ConnectionCounters
+    {
+        std::atomic<MQTTClient::State> state{MQTTClient::State::Disconnected};
+        std::atomic<std::uint64_t> connects{0};
+        std::atomic<std::uint64_t> subscribe_us{0};
+        std::atomic<std::uint64_t> first_message_us{0};
+    };
+
+    ConnectionCounters& connection_counters()
+    {
+        static ConnectionCounters c;
+        return c;
+    }
+
+    std::uint64_t us_since(std::chrono::steady_clock::time_point t)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t).count());
+    }
+
+    // Все фильтры — одним пакетом SUBSCRIBE; ответ придёт в listener
+    void subscribe_all(mqtt::async_client& client, const std::vector<std::string>& filters,
+                       int qos, mqtt::iaction_listener& listener)
+    {
+        client.subscribe(mqtt::string_collection::create(filters),
+                         std::vector<int>(filters.size(), qos), nullptr, listener);
+    }
+
+    // Фильтры, отклонённые брокером в SUBACK (код >= 0x80); остальные действуют
+    size_t log_rejected(const mqtt::token& tok, const std::vector<std::string>& filters)
+    {
+        size_t rejected = 0;
+        const auto codes = tok.get_subscribe_response().get_reason_codes();
+        for (size_t i = 0; i < codes.size() && i < filters.size(); ++i) {
+            if (codes[i] >= 0x80) {
+                LOG_ERROR_SG("MQTTClient: subscription to {} rejected (0x{:02x})", filters[i], codes[i]);
+                ++rejected;
+            }
+        }
+        return rejected;
+    }
+
+    // Буфер без связи разбирается порциями drain_rate / kOfflineTicks раз в kOfflineTick
+    constexpr auto kOfflineTick = std::chrono::milliseconds(100);
+    constexpr int kOfflineTicks = 10;
+
+    // Тип содержимого сообщения MQTT 5: стандартное свойство Content Type,
+    // а у устройств, которые его не задают, — user property "content-type"
+    std::string content_type_of(const mqtt::message& msg)
+    {
+        const auto& props = msg.get_properties();
+        if (props.contains(mqtt::property::CONTENT_TYPE)) {
+            return mqtt::get<std::string>(props, mqtt::property::CONTENT_TYPE);
+        }
+        for (size_t i = 0, n = props.count(mqtt::property::USER_PROPERTY); i < n; ++i) {
+            auto [key, value] = mqtt::get<mqtt::string_pair>(props, mqtt::property::USER_PROPERTY, i);
+            if (key == "content-type" || key == "content_type") {
+                return value;
+            }
+        }
+        return {};
+    }
+} // namespace
+
+// Слушатель одной публикации: сообщает итог клиенту и удаляет себя
+class MQTTClient::DeliveryListener : public virtual mqtt::iaction_listener
+{
+public:
+    DeliveryListener(MQTTClient& client, DeliveryHandler done)
+        : client_(client), done_(std::move(done)), sent_at_(std::chrono::steady_clock::now()) {}
+
+    void on_success(const mqtt::token&) override { finish(true); }
+    void on_failure(const mqtt::token&) override { finish(false); }
+
+    /// Публикация отклонена до отправки — Paho слушателя не вызовет
+    void abandon() { finish(false); }
+
+private:
+    void finish(bool delivered)
+    {
+        auto& client = client_;
+        auto done = std::move(done_);
+        const auto sent_at = sent_at_;
+        delete this;
+        client.on_published(delivered, sent_at, std::move(done));
+    }
+
+    MQTTClient& client_;
+    DeliveryHandler done_;
+    std::chrono::steady_clock::time_point sent_at_;
+};
+
+// Слушатель действия (подписки) с обработчиком-функцией; живёт, пока живёт владелец
+class MQTTClient::ActionListener : public virtual mqtt::iaction_listener
+{
+public:
+    using Handler = std::function<void(const mqtt::token&, bool ok)>;
+
+    explicit ActionListener(Handler handler) : handler_(std::move(handler)) {}
+
+    void on_success(const mqtt::token& tok) override { handler_(tok, true); }
+    void on_failure(const mqtt::token& tok) override { handler_(tok, false); }
+
+private:
+    Handler handler_;
+};
+
+// Дополнительное подключение для приёма метрик по общей подписке:
+// своё соединение, свой поток Paho и свой reconnect
+class MQTTClient::Consumer : public virtual mqtt::callback,
+                             public virtual mqtt::iaction_listener
+{
+public:
+    Consumer(MQTTClient& owner, int index)
+        : owner_(owner),
+          index_(index),
+          client_(std::make_unique<mqtt::async_client>(
+              owner.cfg_.broker,
+              owner.cfg_.client_id + "-c" + std::to_string(index),
+              mqtt::create_options(MQTTVERSION_5))),
+          opts_(owner.make_connect_options()),
+          reconnect_timer_(owner.ioc_),
+          subscribe_listener_([this](const mqtt::token& tok, bool ok) { on_subscribed(tok, ok); })
+    {
+        client_->set_callback(*this);
+    }
+
+    void start() { do_connect(); }
+
+    void stop()
+    {
+        reconnect_timer_.cancel();
+        if (client_->is_connected()) {
+            try {
+                client_->disconnect()->wait_for(3s);
+            }
+            catch (const mqtt::exception& e) {
+                LOG_ERROR_SG("MQTTClient consumer #{} disconnect error: {}", index_, e.what());
+            }
+        }
+    }
+
+    std::uint64_t messages() const { return messages_.load(std::memory_order_relaxed); }
+
+    // === mqtt::callback ===
+    void connected(const std::string&) override
+    {
+        reconnect_attempts_ = 0;
+        connection_counters().connects.fetch_add(1, std::memory_order_relaxed);
+        connected_at_ = std::chrono::steady_clock::now();
+        awaiting_first_.store(true, std::memory_order_relaxed);
+        subscribe();
+    }
+
+    void connection_lost(const std::string& cause) override
+    {
+        LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient consumer #{}: connection lost ({})", index_, cause);
+        schedule_reconnect();
+    }
+
+    void message_arrived(mqtt::const_message_ptr msg) override
+    {
+        messages_.fetch_add(1, std::memory_order_relaxed);
+        owner_.dispatch_metrics(msg->get_topic(), msg->to_string(), content_type_of(*msg));
+        if (awaiting_first_.exchange(false, std::memory_order_relaxed)) {
+            connection_counters().first_message_us.store(us_since(connected_at_), std::memory_order_relaxed);
+        }
+    }
+
+    void delivery_complete(mqtt::delivery_token_ptr) override {}
+
+    // === mqtt::iaction_listener (connect) ===
+    void on_failure(const mqtt::token& tok) override
+    {
+        LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient consumer #{} connect failed: {}", index_, rc_to_string(tok.get_return_code()));
+        schedule_reconnect();
+    }
+
+    void on_success(const mqtt::token&) override {}
+
+private:
+    void subscribe()
+    {
+        try {
+            subscribe_all(*client_, {owner_.metrics_filter()}, owner_.cfg_.qos, subscribe_listener_);
+        }
+        catch (const mqtt::exception& e) {
+            LOG_ERROR_SG("MQTTClient consumer #{} subscribe error: {}", index_, e.what());
+            schedule_reconnect();
+        }
+    }
+
+    void on_subscribed(const mqtt::token& tok, bool ok)
+    {
+        if (!ok || log_rejected(tok, {owner_.metrics_filter()}) > 0) {
+            LOG_ERROR_SG("MQTTClient consumer #{} subscribe failed", index_);
+            schedule_reconnect();
+            return;
+        }
+        connection_counters().subscribe_us.store(us_since(connected_at_), std::memory_order_relaxed);
+        LOG_INFO_SG("MQTTClient consumer #{} subscribed to {}", index_, owner_.metrics_filter());
+    }
+
+    void do_connect()
+    {
+        if (owner_.stopping_) return;
+        try {
+            client_->connect(opts_, nullptr, *this);
+        }
+        catch (const mqtt::exception& e) {
+            LOG_ERROR_SG("MQTTClient consumer #{} connect error: {}", index_, e.what());
+            schedule_reconnect();
+        }
+    }
+
+    void schedule_reconnect()
+    {
+        if (owner_.stopping_) return;
+        const int delay_seconds = std::min(5 * (1 << std::min(reconnect_attempts_, 4)), owner_.max_backoff_);
+        ++reconnect_attempts_;
+        reconnect_timer_.expires_after(std::chrono::seconds(delay_seconds));
+        // Связь есть, не удалась только подписка — повторяется она
+        reconnect_timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec || owner_.stopping_) return;
+            if (client_->is_connected()) subscribe();
+            else do_connect();
+        });
+    }
+
+    MQTTClient& owner_;
+    const int index_;
+    std::unique_ptr<mqtt::async_client> client_;
+    mqtt::connect_options opts_;
+    boost::asio::steady_timer reconnect_timer_;
+    ActionListener subscribe_listener_;
+    int reconnect_attempts_ = 0;
+    std::chrono::steady_clock::time_point connected_at_;
+    std::atomic<bool> awaiting_first_{false};
+    std::atomic<std::uint64_t> messages_{0};
+};
+
 MQTTClient::MQTTClient(boost::asio::io_context& ioc,
                        const MQTTConfig& config,
                        MetricsHandler onMetrics,
@@ -14,26 +280,21 @@ MQTTClient::MQTTClient(boost::asio::io_context& ioc,
       client_(std::make_unique<mqtt::async_client>(
           cfg_.broker, 
           cfg_.client_id,
-          mqtt::create_options(MQTTVERSION_3_1_1)
+          mqtt::create_options(cfg_.version == 5 ? MQTTVERSION_5 : MQTTVERSION_3_1_1)
       )),
       reconnect_timer_(ioc_),
       reconnect_attempts_(0), // Инициализация счетчика попыток
       max_backoff_(60),       // Максимальная задержка 60 секунд
+      offline_timer_(ioc_),
       cmd_rx_(std::regex_replace(cfg_.topics.at("command"),
                                   std::regex(R"(\{gh_id\})"), R"(([^/]+))")),
       met_rx_(std::regex_replace(cfg_.topics.at("metrics"),
                                   std::regex(R"(\{gh_id\})"), R"(([^/]+))"))
 {
     // Настройка опций подключения
-    conn_opts_.set_clean_session(cfg_.clean_session);
-    conn_opts_.set_keep_alive_interval(cfg_.keep_alive);
-    
-    if (!cfg_.username.empty()) {
-        conn_opts_.set_user_name(cfg_.username);
-        conn_opts_.set_password(cfg_.password);
-    }
+    conn_opts_ = make_connect_options();
 
-    // Добавление LWT (Last Will and Testament)
+    // Добавление LWT (только у основного подключения) (Last Will and Testament)
     if (!cfg_.will_topic.empty() && !cfg_.will_message.empty()) {
         mqtt::will_options will(
             cfg_.will_topic,
@@ -47,6 +308,12 @@ MQTTClient::MQTTClient(boost::asio::io_context& ioc,
 
     // Регистрация коллбеков
     client_->set_callback(*this);
+    subscribe_listener_ = std::make_unique<ActionListener>(
+        [this](const mqtt::token& tok, bool ok) { on_subscribed(tok, ok); });
+
+    for (int i = 1; i < cfg_.consumers; ++i) {
+        consumers_.push_back(std::make_unique<Consumer>(*this, i));
+    }
 }
 
 MQTTClient::~MQTTClient() {
@@ -55,13 +322,34 @@ MQTTClient::~MQTTClient() {
 
 void MQTTClient::start() {
     if (stopping_) return;
-    LOG_INFO_SG("MQTTClient: connecting to {}", cfg_.broker);
+    LOG_INFO_SG("MQTTClient: connecting to {} ({} metrics consumers)", cfg_.broker, cfg_.consumers);
     do_connect();
+    for (auto& c : consumers_) {
+        c->start();
+    }
 }
 
 void MQTTClient::stop() {
     stopping_ = true;
+    set_state(State::Stopped);
     reconnect_timer_.cancel();
+    offline_timer_.cancel();
+    for (auto& c : consumers_) {
+        c->stop();
+    }
+    // Буфер не переживает остановку: владельцы команд повторят их сами
+    Results results;
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        for (auto& p : offline_) {
+            results.emplace_back(std::move(p.done), Delivery::Failed);
+        }
+        offline_.clear();
+        publish_counters().buffered.store(0, std::memory_order_relaxed);
+    }
+    for (auto& [done, result] : results) {
+        if (done) done(result);
+    }
     if (client_ && client_->is_connected()) {
         try {
             client_->disconnect()->wait_for(3s);
@@ -73,34 +361,426 @@ void MQTTClient::stop() {
     }
 }
 
+std::vector<std::uint64_t> MQTTClient::consumer_messages() const
+{
+    std::vector<std::uint64_t> counts{metrics_messages_.load(std::memory_order_relaxed)};
+    for (const auto& c : consumers_) {
+        counts.push_back(c->messages());
+    }
+    return counts;
+}
+
+const char* MQTTClient::state_name(State state)
+{
+    switch (state)
+    {
+    case State::Disconnected: return "disconnected";
+    case State::Connecting: return "connecting";
+    case State::Subscribing: return "subscribing";
+    case State::Ready: return "ready";
+    case State::Stopped: return "stopped";
+    }
+    return "unknown";
+}
+
+MQTTClient::ConnectionStats MQTTClient::connection_stats()
+{
+    auto& c = connection_counters();
+    ConnectionStats s;
+    s.state = c.state.load(std::memory_order_relaxed);
+    s.connects = c.connects.load(std::memory_order_relaxed);
+    s.subscribe_ms = c.subscribe_us.load(std::memory_order_relaxed) / 1000.0;
+    s.first_message_ms = c.first_message_us.load(std::memory_order_relaxed) / 1000.0;
+    return s;
+}
+
+MQTTClient::PublishStats MQTTClient::publish_stats()
+{
+    auto& c = publish_counters();
+    PublishStats s;
+    s.published = c.published.load(std::memory_order_relaxed);
+    s.failed = c.failed.load(std::memory_order_relaxed);
+    s.in_flight = c.in_flight.load(std::memory_order_relaxed);
+    s.queued = c.queued.load(std::memory_order_relaxed);
+    s.buffered = c.buffered.load(std::memory_order_relaxed);
+    s.expired = c.expired.load(std::memory_order_relaxed);
+    s.replaced = c.replaced.load(std::memory_order_relaxed);
+    s.overflow = c.overflow.load(std::memory_order_relaxed);
+    s.last_ms = c.last_us.load(std::memory_order_relaxed) / 1000.0;
+    s.max_ms = c.max_us.load(std::memory_order_relaxed) / 1000.0;
+    if (s.published > 0) {
+        s.avg_ms = c.total_us.load(std::memory_order_relaxed) / 1000.0 / s.published;
+    }
+    return s;
+}
+
 void MQTTClient::publish_command(const std::string& gh_id,
                                  const std::string& cmd)
 {
-    if (!client_->is_connected()) {
-        LOG_WARN_SG("MQTTClient: not connected, cannot publish");
+    auto delivered = publish_command_async(gh_id, cmd);
+    if (delivered.wait_for(3s) != std::future_status::ready) {
+        LOG_WARN_LIMIT_SG(10, 60, "MQTTClient: no broker response for command to GH {} within 3 s", gh_id);
+    } else if (!delivered.get()) {
+        LOG_WARN_LIMIT_SG(10, 60, "MQTTClient: command to GH {} not delivered", gh_id);
+    }
+}
+
+void MQTTClient::publish_command_async(const std::string& gh_id,
+                                       const std::string& cmd,
+                                       DeliveryHandler done)
+{
+    std::vector<OutgoingCommand> commands;
+    // Без ключа замены команда не буферизуется: повторять её — дело вызывающего
+    commands.push_back({gh_id, cmd, std::move(done), std::string(), std::string()});
+    publish_commands(std::move(commands));
+}
+
+std::future<bool> MQTTClient::publish_command_async(const std::string& gh_id,
+                                                    const std::string& cmd)
+{
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    publish_command_async(gh_id, cmd, [promise](Delivery result) {
+        promise->set_value(result == Delivery::Delivered);
+    });
+    return future;
+}
+
+void MQTTClient::publish_commands(std::vector<OutgoingCommand> commands)
+{
+    if (commands.empty()) return;
+
+    const bool connected = client_->is_connected();
+    if (!connected && cfg_.offline.capacity == 0) {
+        LOG_WARN_SG("MQTTClient: not connected, {} commands not published", commands.size());
+        publish_counters().failed.fetch_add(commands.size(), std::memory_order_relaxed);
+        for (auto& c : commands) {
+            if (c.done) c.done(Delivery::Failed);
+        }
         return;
     }
-    
-    auto topic = resolve_topic(cfg_.topics.at("command"), gh_id);
-    auto msg = mqtt::make_message(topic, cmd);
+
+    const auto& tmpl = cfg_.topics.at("command");
+    Results results;
+    bool buffered = false;
+    size_t rejected = 0;
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        for (auto& c : commands) {
+            QueuedPublish p{resolve_topic(tmpl, c.gh_id), std::move(c.command), std::move(c.done),
+                            std::move(c.replaces),
+                            c.created + std::chrono::seconds(cfg_.offline.max_age_for(c.type))};
+            if (p.replaces.empty()) {
+                // Повтор такой команды не нашёл бы копию в буфере и ушёл бы дважды
+                if (connected) {
+                    pub_queue_.push_back(std::move(p));
+                } else {
+                    results.emplace_back(std::move(p.done), Delivery::Failed);
+                    ++rejected;
+                }
+            } else if (!connected || !offline_.empty()) {
+                // Пока буфер не разобран, новые команды встают за ним — порядок сохраняется
+                buffer_locked(std::move(p), results);
+                buffered = true;
+            } else {
+                pub_queue_.push_back(std::move(p));
+            }
+        }
+        publish_counters().failed.fetch_add(rejected, std::memory_order_relaxed);
+        publish_counters().queued.store(pub_queue_.size(), std::memory_order_relaxed);
+        publish_counters().buffered.store(offline_.size(), std::memory_order_relaxed);
+    }
+    for (auto& [done, result] : results) {
+        if (done) done(result);
+    }
+    if (buffered && connected) {
+        start_offline_drain();
+    }
+    drain();
+}
+
+void MQTTClient::buffer_locked(QueuedPublish p, Results& results)
+{
+    auto& c = publish_counters();
+    // Новая команда тому же устройству делает прежнюю ненужной
+    if (!p.replaces.empty()) {
+        auto it = std::find_if(offline_.begin(), offline_.end(), [&](const QueuedPublish& q) {
+            return q.replaces == p.replaces && q.topic == p.topic;
+        });
+        if (it != offline_.end()) {
+            results.emplace_back(std::move(it->done), Delivery::Expired);
+            offline_.erase(it);
+            c.replaced.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    // Вытесненная команда не устарела — её владелец может повторить её позже
+    if (offline_.size() >= static_cast<size_t>(cfg_.offline.capacity)) {
+        results.emplace_back(std::move(offline_.front().done), Delivery::Failed);
+        offline_.pop_front();
+        c.overflow.fetch_add(1, std::memory_order_relaxed);
+    }
+    offline_.push_back(std::move(p));
+}
+
+void MQTTClient::expire_locked(Results& results)
+{
+    const auto now = std::chrono::steady_clock::now();
+    size_t expired = 0;
+    for (auto it = offline_.begin(); it != offline_.end();) {
+        if (it->expires_at > now) {
+            ++it;
+            continue;
+        }
+        results.emplace_back(std::move(it->done), Delivery::Expired);
+        it = offline_.erase(it);
+        ++expired;
+    }
+    if (expired > 0) {
+        publish_counters().expired.fetch_add(expired, std::memory_order_relaxed);
+        LOG_WARN_SG("MQTTClient: {} buffered commands expired", expired);
+    }
+}
+
+void MQTTClient::start_offline_drain()
+{
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        if (offline_draining_ || offline_.empty()) return;
+        offline_draining_ = true;
+    }
+    boost::asio::post(ioc_, [this] { drain_offline(); });
+}
+
+void MQTTClient::drain_offline()
+{
+    Results results;
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        expire_locked(results);
+        const bool connected = client_->is_connected();
+        if (connected) {
+            const int burst = std::max(1, cfg_.offline.drain_rate / kOfflineTicks);
+            for (int n = 0; n < burst && !offline_.empty(); ++n) {
+                pub_queue_.push_back(std::move(offline_.front()));
+                offline_.pop_front();
+            }
+        }
+        // Без связи разбор продолжит следующий connected()
+        more = connected && !offline_.empty() && !stopping_;
+        offline_draining_ = more;
+        publish_counters().queued.store(pub_queue_.size(), std::memory_order_relaxed);
+        publish_counters().buffered.store(offline_.size(), std::memory_order_relaxed);
+    }
+    for (auto& [done, result] : results) {
+        if (done) done(result);
+    }
+    drain();
+
+    if (more) {
+        offline_timer_.expires_after(kOfflineTick);
+        offline_timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (!ec) drain_offline();
+        });
+    }
+}
+
+void MQTTClient::drain()
+{
+    // Очередь разбирает один поток за раз — так публикации уходят в её порядке;
+    // остальные только освобождают место в окне, поток-разборщик его увидит
+    std::unique_lock<std::mutex> lock(pub_mutex_);
+    if (draining_) return;
+    draining_ = true;
+    const size_t window = static_cast<size_t>(std::max(1, cfg_.max_inflight));
+    while (pub_in_flight_ < window && !pub_queue_.empty()) {
+        auto p = std::move(pub_queue_.front());
+        pub_queue_.pop_front();
+        ++pub_in_flight_;
+        publish_counters().queued.store(pub_queue_.size(), std::memory_order_relaxed);
+        publish_counters().in_flight.store(pub_in_flight_, std::memory_order_relaxed);
+        lock.unlock();
+        send(std::move(p));
+        lock.lock();
+    }
+    draining_ = false;
+}
+
+void MQTTClient::send(QueuedPublish p)
+{
+    int alias = 0;
+    bool full_topic = true;
+    std::uint64_t epoch = 0;
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        if (alias_max_ > 0) {
+            auto it = aliases_.find(p.topic);
+            if (it == aliases_.end() && aliases_.size() < static_cast<size_t>(alias_max_)) {
+                const int id = static_cast<int>(aliases_.size()) + 1;
+                it = aliases_.emplace(p.topic, TopicAlias{id}).first;
+            }
+            if (it != aliases_.end()) {
+                alias = it->second.id;
+                full_topic = !it->second.confirmed;
+                epoch = alias_epoch_;
+            }
+        }
+    }
+
+    auto msg = mqtt::make_message(full_topic ? p.topic : std::string(), p.payload);
     msg->set_qos(cfg_.qos);
-    
+    if (alias > 0) {
+        msg->set_properties({mqtt::property(mqtt::property::TOPIC_ALIAS, alias)});
+        // Пока брокер не подтвердил сопоставление, имя топика отправляется целиком
+        if (full_topic) {
+            p.done = [this, topic = p.topic, epoch, done = std::move(p.done)](Delivery result) {
+                if (result == Delivery::Delivered) confirm_alias(topic, epoch);
+                if (done) done(result);
+            };
+        }
+    }
+
+    // Слушатель живёт до ответа брокера
+    auto* listener = new DeliveryListener(*this, std::move(p.done));
     try {
-        client_->publish(msg)->wait_for(3s);
-        LOG_INFO_SG("MQTTClient: published {} => {}", topic, cmd);
+        client_->publish(msg, nullptr, *listener);
+        return;
     }
     catch (const mqtt::exception& e) {
-        LOG_ERROR_SG("MQTTClient publish error: {}", e.what());
+        LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient publish error: {}", e.what());
     }
     catch (const std::exception& e) {
-        LOG_ERROR_SG("MQTTClient publish unexpected error: {}", e.what());
+        LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient publish unexpected error: {}", e.what());
+    }
+    listener->abandon();
+}
+
+void MQTTClient::on_published(bool delivered, std::chrono::steady_clock::time_point sent_at,
+                              DeliveryHandler done)
+{
+    auto& c = publish_counters();
+    if (delivered) {
+        const auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - sent_at).count());
+        c.published.fetch_add(1, std::memory_order_relaxed);
+        c.total_us.fetch_add(us, std::memory_order_relaxed);
+        c.last_us.store(us, std::memory_order_relaxed);
+        auto max = c.max_us.load(std::memory_order_relaxed);
+        while (us > max && !c.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    } else {
+        c.failed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (done) {
+        try {
+            done(delivered ? Delivery::Delivered : Delivery::Failed);
+        } catch (const std::exception& e) {
+            LOG_ERROR_SG("MQTTClient delivery handler error: {}", e.what());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        --pub_in_flight_;
+        c.in_flight.store(pub_in_flight_, std::memory_order_relaxed);
+    }
+    drain();
+}
+
+void MQTTClient::confirm_alias(const std::string& topic, std::uint64_t epoch)
+{
+    std::lock_guard<std::mutex> lock(pub_mutex_);
+    if (epoch != alias_epoch_) return;
+    auto it = aliases_.find(topic);
+    if (it != aliases_.end()) {
+        it->second.confirmed = true;
     }
 }
 
+void MQTTClient::set_connected_handler(std::function<void()> handler)
+{
+    connected_cb_ = std::move(handler);
+}
+
+bool MQTTClient::add_topic_handler(const std::string& key, TopicHandler handler)
+{
+    auto it = cfg_.topics.find(key);
+    if (it == cfg_.topics.end()) {
+        return false;
+    }
+    extra_topics_.push_back({
+        resolve_topic(it->second, "+"),
+        std::regex(std::regex_replace(it->second, std::regex(R"(\{gh_id\})"), R"(([^/]+))")),
+        std::move(handler)});
+    return true;
+}
+
 // ---------------- Internal ----------------
 
+void MQTTClient::set_state(State state)
+{
+    const auto prev = state_.exchange(state);
+    // После stop() подключение не оживает, даже если колбек Paho опоздал
+    if (prev == State::Stopped && state != State::Stopped) {
+        state_.store(State::Stopped);
+        return;
+    }
+    connection_counters().state.store(state, std::memory_order_relaxed);
+    if (prev != state) {
+        LOG_DEBUG_SG("MQTTClient: {} -> {}", state_name(prev), state_name(state));
+    }
+}
+
+mqtt::connect_options MQTTClient::make_connect_options() const
+{
+    mqtt::connect_options opts;
+    // В MQTT 5 clean session называется clean start
+    if (cfg_.version == 5) {
+        opts.set_mqtt_version(MQTTVERSION_5);
+        opts.set_clean_start(cfg_.clean_session);
+    } else {
+        opts.set_clean_session(cfg_.clean_session);
+    }
+    opts.set_keep_alive_interval(cfg_.keep_alive);
+
+    if (!cfg_.username.empty()) {
+        opts.set_user_name(cfg_.username);
+        opts.set_password(cfg_.password);
+    }
+    return opts;
+}
+
+std::string MQTTClient::metrics_filter() const
+{
+    auto filter = resolve_topic(cfg_.topics.at("metrics"), "+");
+    if (cfg_.consumers > 1) {
+        filter = "$share/" + cfg_.share_group + "/" + filter;
+    }
+    return filter;
+}
+
+bool MQTTClient::dispatch_metrics(const std::string& topic, const std::string& payload,
+                                  const std::string& content_type)
+{
+    std::smatch m;
+    if (!std::regex_match(topic, m, met_rx_)) {
+        return false;
+    }
+    if (metrics_cb_) {
+        try {
+            metrics_cb_(m[1].str(), payload, content_type);
+        }
+        catch (const std::exception& e) {
+            LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient message error: {}", e.what());
+        }
+    }
+    return true;
+}
+
 void MQTTClient::do_connect() {
     if (stopping_) return;
+    set_state(State::Connecting);
 
     LOG_INFO_SG("Connecting to {}", cfg_.broker);
     LOG_INFO_SG("  clean_session={}, keep_alive={}, username={}",
@@ -123,13 +803,48 @@ void MQTTClient::do_connect() {
 
 void MQTTClient::connected(const std::string& cause) {
     reconnect_attempts_ = 0;
+    connected_at_ = std::chrono::steady_clock::now();
+    awaiting_first_.store(true, std::memory_order_relaxed);
+    connection_counters().connects.fetch_add(1, std::memory_order_relaxed);
     LOG_INFO_SG("MQTTClient: connected ({})", cause);
+    // Подписка не ждёт SUBACK: сообщения сессии обрабатываются сразу
     do_subscribe();
+    start_offline_drain();
+    if (connected_cb_) {
+        connected_cb_();
+    }
 }
 
 
 void MQTTClient::connection_lost(const std::string& cause) {
-    LOG_ERROR_SG("MQTTClient: connection lost ({})", cause);
+    LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient: connection lost ({})", cause);
+    set_state(State::Disconnected);
+    Results lost;
+    {
+        // Алиасы живут только в рамках подключения
+        std::lock_guard<std::mutex> lock(pub_mutex_);
+        aliases_.clear();
+        alias_max_ = 0;
+        ++alias_epoch_;
+
+        // Ещё не отправленное возвращается в начало буфера, в прежнем порядке
+        if (cfg_.offline.capacity > 0) {
+            while (!pub_queue_.empty()) {
+                offline_.push_front(std::move(pub_queue_.back()));
+                pub_queue_.pop_back();
+            }
+            while (offline_.size() > static_cast<size_t>(cfg_.offline.capacity)) {
+                lost.emplace_back(std::move(offline_.front().done), Delivery::Failed);
+                offline_.pop_front();
+                publish_counters().overflow.fetch_add(1, std::memory_order_relaxed);
+            }
+            publish_counters().queued.store(0, std::memory_order_relaxed);
+            publish_counters().buffered.store(offline_.size(), std::memory_order_relaxed);
+        }
+    }
+    for (auto& [done, result] : lost) {
+        if (done) done(result);
+    }
     if (!stopping_) {
         schedule_reconnect();
     }
@@ -139,32 +854,51 @@ void MQTTClient::message_arrived(mqtt::const_message_ptr msg) {
     auto topic = msg->get_topic();
     auto payload = msg->to_string();
     
-    LOG_INFO_SG("MQTTClient: received message on {}: {}", topic, payload);
-    
+    LOG_DEBUG_SG("MQTTClient: received message on {}: {}", topic, payload);
+
+    if (dispatch_metrics(topic, payload, content_type_of(*msg))) {
+        metrics_messages_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        dispatch_other(topic, payload);
+    }
+
+    if (awaiting_first_.exchange(false, std::memory_order_relaxed)) {
+        const auto us = us_since(connected_at_);
+        connection_counters().first_message_us.store(us, std::memory_order_relaxed);
+        LOG_INFO_SG("MQTTClient: first message {:.1f} ms after connect", us / 1000.0);
+    }
+}
+
+void MQTTClient::dispatch_other(const std::string& topic, const std::string& payload)
+{
     try {
         std::smatch m;
-        if (std::regex_match(topic, m, met_rx_) && metrics_cb_) {
-            metrics_cb_(m[1].str(), payload);
-        }
-        else if (std::regex_match(topic, m, cmd_rx_) && command_cb_) {
+        if (std::regex_match(topic, m, cmd_rx_) && command_cb_) {
             command_cb_(m[1].str(), payload);
         }
         else {
-            LOG_WARN_SG("MQTTClient: unmatched topic: {}", topic);
+            auto extra = std::find_if(extra_topics_.begin(), extra_topics_.end(),
+                                      [&](const ExtraTopic& t) { return std::regex_match(topic, m, t.rx); });
+            if (extra != extra_topics_.end()) {
+                extra->handler(m[1].str(), payload);
+            } else {
+                LOG_WARN_LIMIT_SG(10, 60, "MQTTClient: unmatched topic: {}", topic);
+            }
         }
     }
     catch (const std::exception& e) {
-        LOG_ERROR_SG("MQTTClient message error: {}", e.what());
+        LOG_ERROR_LIMIT_SG(10, 60, "MQTTClient message error: {}", e.what());
     }
 }
 
 void MQTTClient::on_failure(const mqtt::token& tok) {
     int rc = tok.get_return_code();
-    LOG_ERROR_SG("Connect failed (id={}): {} [{}]",
-              tok.get_message_id(),
-              rc_to_string(rc),
-              rc);
-    
+    LOG_ERROR_LIMIT_SG(10, 60, "Connect failed (id={}): {} [{}]",
+                       tok.get_message_id(),
+                       rc_to_string(rc),
+                       rc);
+    set_state(State::Disconnected);
+
     if (!stopping_) {
         schedule_reconnect();
     }
@@ -173,19 +907,37 @@ void MQTTClient::on_failure(const mqtt::token& tok) {
 void MQTTClient::on_success(const mqtt::token& tok) {
     LOG_INFO_SG("MQTTClient connect succeeded (id={})",
               tok.get_message_id());
+    if (cfg_.version != 5) return;
+
+    // Брокер сообщает в CONNACK, сколько алиасов он готов принять (нет свойства — ни одного)
+    int broker_max = 0;
+    const auto& props = tok.get_connect_response().get_properties();
+    if (props.contains(mqtt::property::TOPIC_ALIAS_MAXIMUM)) {
+        broker_max = mqtt::get<int>(props, mqtt::property::TOPIC_ALIAS_MAXIMUM);
+    }
+    std::lock_guard<std::mutex> lock(pub_mutex_);
+    aliases_.clear();
+    alias_max_ = std::min(cfg_.topic_alias_max, broker_max);
+    ++alias_epoch_;
+    LOG_INFO_SG("MQTTClient: MQTT 5, topic aliases for commands: {}", alias_max_);
+}
+
+std::vector<std::string> MQTTClient::subscription_filters() const
+{
+    std::vector<std::string> filters{metrics_filter()};
+    if (command_cb_) {
+        filters.push_back(resolve_topic(cfg_.topics.at("command"), "+"));
+    }
+    for (const auto& t : extra_topics_) {
+        filters.push_back(t.filter);
+    }
+    return filters;
 }
 
 void MQTTClient::do_subscribe() {
+    set_state(State::Subscribing);
     try {
-        auto met_t = resolve_topic(cfg_.topics.at("metrics"), "+");
-        client_->subscribe(met_t, cfg_.qos)->wait_for(3s);
-        LOG_INFO_SG("MQTTClient subscribed to {}", met_t);
-
-        if (command_cb_) {
-            auto cmd_t = resolve_topic(cfg_.topics.at("command"), "+");
-            client_->subscribe(cmd_t, cfg_.qos)->wait_for(3s);
-            LOG_INFO_SG("MQTTClient subscribed to {}", cmd_t);
-        }
+        subscribe_all(*client_, subscription_filters(), cfg_.qos, *subscribe_listener_);
     }
     catch (const mqtt::exception& e) {
         LOG_ERROR_SG("MQTTClient subscribe error: {}", e.what());
@@ -202,16 +954,40 @@ void MQTTClient::do_subscribe() {
     }
 }
 
+void MQTTClient::on_subscribed(const mqtt::token& tok, bool ok)
+{
+    const auto filters = subscription_filters();
+    if (!ok || log_rejected(tok, filters) > 0) {
+        LOG_ERROR_SG("MQTTClient subscribe failed: {}", rc_to_string(tok.get_return_code()));
+        if (!stopping_) {
+            schedule_reconnect();
+        }
+        return;
+    }
+    const auto us = us_since(connected_at_);
+    connection_counters().subscribe_us.store(us, std::memory_order_relaxed);
+    set_state(State::Ready);
+    LOG_INFO_SG("MQTTClient subscribed to {} filters in {:.1f} ms", filters.size(), us / 1000.0);
+}
+
 ///< Экспоненциальный backoff с ограничением максимума
 void MQTTClient::schedule_reconnect() {
     if (stopping_) return;
-    int delay_seconds = std::min(5 * (1 << reconnect_attempts_), max_backoff_);
+    int delay_seconds = std::min(5 * (1 << std::min(reconnect_attempts_, 4)), max_backoff_);
     reconnect_attempts_++;
-    
+
+    // Связь есть, не удалась только подписка — повторяется она
+    if (!client_->is_connected()) {
+        set_state(State::Disconnected);
+    }
     LOG_INFO_SG("MQTTClient: scheduling reconnect in {} seconds...", delay_seconds);
     reconnect_timer_.expires_after(std::chrono::seconds(delay_seconds));
     reconnect_timer_.async_wait([this](const boost::system::error_code& ec) {
-        if (!ec && !stopping_) {
+        if (!ec && !stopping_ && client_->is_connected()) {
+            LOG_INFO_SG("MQTTClient: resubscribing (attempt #{})...", reconnect_attempts_);
+            do_subscribe();
+        }
+        else if (!ec && !stopping_) {
             LOG_INFO_SG("MQTTClient: reconnecting (attempt #{})...", reconnect_attempts_);
             do_connect();
         }
@@ -0,0 +1,76 @@
+#include "processor/ActuatorStateCache.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace processor
+{
+
+ActuatorStateCache& ActuatorStateCache::instance()
+{
+    static ActuatorStateCache instance;
+    return instance;
+}
+
+void ActuatorStateCache::set_window(std::int64_t seconds)
+{
+    std::unique_lock lock(mutex_);
+    window_ = std::max<std::int64_t>(0, seconds);
+}
+
+bool ActuatorStateCache::command(int gh_id, int comp_id, const std::string& state,
+                                 int rule_id, std::int64_t now)
+{
+    std::unique_lock lock(mutex_);
+    auto& s = states_[comp_id];
+    s.comp_id = comp_id;
+    s.gh_id = gh_id;
+    if (window_ > 0 && !state.empty() && s.current() == state && now - s.current_at() < window_) {
+        ++s.suppressed;
+        ++suppressed_;
+        return false;
+    }
+    s.commanded = state;
+    s.commanded_at = now;
+    s.rule_id = rule_id;
+    return true;
+}
+
+void ActuatorStateCache::report(int gh_id, int comp_id, const std::string& state, std::int64_t now)
+{
+    std::unique_lock lock(mutex_);
+    auto& s = states_[comp_id];
+    s.comp_id = comp_id;
+    s.gh_id = gh_id;
+    s.reported = state;
+    s.reported_at = now;
+}
+
+std::optional<ActuatorState> ActuatorStateCache::get(int comp_id) const
+{
+    std::shared_lock lock(mutex_);
+    auto it = states_.find(comp_id);
+    if (it == states_.end()) return std::nullopt;
+    return it->second;
+}
+
+std::vector<ActuatorState> ActuatorStateCache::by_greenhouse(int gh_id) const
+{
+    std::vector<ActuatorState> result;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& [comp_id, s] : states_) {
+            if (s.gh_id == gh_id) result.push_back(s);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const ActuatorState& a, const ActuatorState& b) { return a.comp_id < b.comp_id; });
+    return result;
+}
+
+std::uint64_t ActuatorStateCache::suppressed() const
+{
+    std::shared_lock lock(mutex_);
+    return suppressed_;
+}
+
+} // namespace processor
@@ -0,0 +1,354 @@
+#include "processor/CommandOutbox.hpp"
+#include "utils/Logger.hpp"
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace processor
+{
+
+namespace
+{
+    struct Counters
+    {
+        std::atomic<std::uint64_t> enqueued{0};
+        std::atomic<std::uint64_t> delivered{0};
+        std::atomic<std::uint64_t> published{0};
+        std::atomic<std::uint64_t> failed{0};
+        std::atomic<std::uint64_t> timeouts{0};
+        std::atomic<std::uint64_t> resends{0};
+        std::atomic<std::uint64_t> expired{0};
+        std::atomic<std::uint64_t> unsaved{0};
+        std::atomic<std::uint64_t> pending{0};
+        std::atomic<std::uint64_t> in_flight{0};
+        std::atomic<double> last_delivery_ms{0.0};
+    };
+
+    Counters& counters()
+    {
+        static Counters c;
+        return c;
+    }
+
+    std::int64_t unix_now()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    constexpr auto kPruneInterval = std::chrono::hours(1);
+} // namespace
+
+CommandOutbox::CommandOutbox(boost::asio::io_context& ioc, const OutboxConfig& cfg,
+                             db::CommandOutboxManager& store, Publisher publish)
+    : ioc_(ioc),
+      cfg_(cfg),
+      store_(store),
+      publish_(std::move(publish)),
+      timer_(ioc),
+      prune_timer_(ioc)
+{
+}
+
+CommandOutbox::Stats CommandOutbox::stats()
+{
+    auto& c = counters();
+    Stats s;
+    s.enqueued = c.enqueued.load(std::memory_order_relaxed);
+    s.delivered = c.delivered.load(std::memory_order_relaxed);
+    s.published = c.published.load(std::memory_order_relaxed);
+    s.failed = c.failed.load(std::memory_order_relaxed);
+    s.timeouts = c.timeouts.load(std::memory_order_relaxed);
+    s.resends = c.resends.load(std::memory_order_relaxed);
+    s.expired = c.expired.load(std::memory_order_relaxed);
+    s.unsaved = c.unsaved.load(std::memory_order_relaxed);
+    s.pending = c.pending.load(std::memory_order_relaxed);
+    s.in_flight = c.in_flight.load(std::memory_order_relaxed);
+    s.last_delivery_ms = c.last_delivery_ms.load(std::memory_order_relaxed);
+    return s;
+}
+
+void CommandOutbox::start()
+{
+    boost::asio::post(ioc_, [this] {
+        // Чтение идёт в потоке io_context: команды, поставленные раньше,
+        // уже в БД и придут отсюда, поставленные позже — из enqueue()
+        const auto records = store_.load_pending();
+        const auto now = Clock::now();
+        const auto unix = unix_now();
+        loaded_up_to_ = 0;
+        for (const auto& r : records) {
+            loaded_up_to_ = std::max(loaded_up_to_, r.id);
+            append(r.gh_id, r.id, r.payload,
+                   now - std::chrono::seconds(std::max<std::int64_t>(0, unix - r.created_at)));
+        }
+        if (!records.empty()) {
+            LOG_INFO_SG("CommandOutbox: {} undelivered commands loaded", records.size());
+        }
+        schedule_prune();
+        pump();
+    });
+}
+
+void CommandOutbox::stop()
+{
+    boost::asio::post(ioc_, [this] {
+        stopped_ = true;
+        timer_.cancel();
+        prune_timer_.cancel();
+        flush_delivered();
+    });
+}
+
+bool CommandOutbox::enqueue(std::vector<Command> commands)
+{
+    if (commands.empty()) return true;
+
+    auto ids = store_.enqueue(commands, unix_now());
+    const bool saved = ids.size() == commands.size();
+    if (!saved) {
+        LOG_WARN_SG("CommandOutbox: failed to persist {} commands, sending from memory only",
+                    commands.size());
+        counters().unsaved.fetch_add(commands.size(), std::memory_order_relaxed);
+        ids.assign(commands.size(), 0);
+    }
+    counters().enqueued.fetch_add(commands.size(), std::memory_order_relaxed);
+
+    boost::asio::post(ioc_, [this, commands = std::move(commands), ids = std::move(ids),
+                             at = Clock::now()]() mutable {
+        for (size_t i = 0; i < commands.size(); ++i) {
+            // Сохранённые до загрузки из БД команды придут вместе с ней
+            if (ids[i] > 0 && (loaded_up_to_ < 0 || ids[i] <= loaded_up_to_)) continue;
+            append(commands[i].first, ids[i], std::move(commands[i].second), at);
+        }
+        pump();
+    });
+    return saved;
+}
+
+void CommandOutbox::resume()
+{
+    boost::asio::post(ioc_, [this] {
+        for (auto& [gh_id, q] : queues_) {
+            q.failures = 0;
+            q.retry_at = {};
+        }
+        pump();
+    });
+}
+
+void CommandOutbox::append(int gh_id, std::int64_t id, std::string payload, Clock::time_point at)
+{
+    queues_[gh_id].entries.push_back({++next_key_, id, std::move(payload), at});
+    ++pending_;
+}
+
+void CommandOutbox::pump()
+{
+    std::vector<Publish> batch;
+    if (!stopped_ && !queues_.empty()) {
+        const auto now = Clock::now();
+        const size_t window = static_cast<size_t>(std::max(1, cfg_.max_in_flight));
+
+        // По одной команде от каждой готовой теплицы за круг, пока есть окно
+        bool progress = true;
+        while (progress && inflight_.size() < window) {
+            progress = false;
+            auto it = queues_.lower_bound(cursor_);
+            for (size_t n = queues_.size(); n > 0 && inflight_.size() < window; --n, ++it) {
+                if (it == queues_.end()) it = queues_.begin();
+                auto& [gh_id, q] = *it;
+                if (q.next < q.entries.size() && q.retry_at <= now) {
+                    send(gh_id, q, batch);
+                    progress = true;
+                }
+            }
+            cursor_ = it == queues_.end() ? queues_.begin()->first : it->first;
+        }
+    }
+    // Всё, что освободившееся окно позволило отправить, уходит одним вызовом
+    if (!batch.empty()) {
+        publish_(std::move(batch));
+    }
+    sync_gauges();
+    arm_timer();
+}
+
+void CommandOutbox::send(int gh_id, Queue& q, std::vector<Publish>& batch)
+{
+    auto& e = q.entries[q.next++];
+    ++e.attempts;
+    const auto seq = ++seq_;
+    inflight_.emplace(seq, Inflight{gh_id, q.generation, e.key, Clock::now()});
+    counters().published.fetch_add(1, std::memory_order_relaxed);
+
+    // Итог может прийти из потока Paho или сразу — учёт всегда в io_context
+    batch.push_back({gh_id, e.key, e.payload, e.enqueued_at, [this, seq](Result result) {
+        boost::asio::post(ioc_, [this, seq, result] { on_result(seq, result); });
+    }});
+}
+
+void CommandOutbox::on_result(std::uint64_t seq, Result result)
+{
+    auto it = inflight_.find(seq);
+    if (it == inflight_.end()) return; // Уже списана по таймауту
+    const Inflight f = it->second;
+    inflight_.erase(it);
+    if (result == Result::Failed) {
+        counters().failed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Ответы на отправки прошлых проходов не меняют очередь: команды
+    // после возврата к началу будут отправлены заново
+    auto qi = queues_.find(f.gh_id);
+    if (qi != queues_.end() && qi->second.generation == f.generation) {
+        auto& q = qi->second;
+        if (result == Result::Failed) {
+            go_back(f.gh_id, q);
+        } else {
+            auto e = std::find_if(q.entries.begin(), q.entries.end(),
+                                  [&](const Entry& x) { return x.key == f.key; });
+            if (e != q.entries.end()) {
+                e->acked = true;
+                e->expired = result == Result::Expired;
+            }
+            q.failures = 0;
+            pop_acked(f.gh_id, q);
+        }
+    }
+    pump();
+}
+
+void CommandOutbox::go_back(int gh_id, Queue& q)
+{
+    ++q.generation;
+    q.next = 0;
+    for (auto& e : q.entries) {
+        e.acked = false;
+        e.expired = false;
+    }
+    const unsigned shift = std::min(q.failures, 16u);
+    ++q.failures;
+    const int delay = static_cast<int>(std::min<std::int64_t>(
+        static_cast<std::int64_t>(cfg_.retry_initial) << shift, cfg_.retry_max));
+    q.retry_at = Clock::now() + std::chrono::seconds(delay);
+    counters().resends.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN_SG("CommandOutbox: publish for GH {} failed, {} commands pending, retry in {} s",
+                gh_id, q.entries.size(), delay);
+}
+
+void CommandOutbox::pop_acked(int gh_id, Queue& q)
+{
+    const auto now = Clock::now();
+    const auto unix = unix_now();
+    while (!q.entries.empty() && q.entries.front().acked) {
+        const auto& e = q.entries.front();
+        // Устаревшая команда тоже завершена: в БД она больше не ждёт отправки
+        if (e.id > 0) {
+            delivered_.push_back({e.id, e.attempts, unix});
+        }
+        if (e.expired) {
+            counters().expired.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            counters().delivered.fetch_add(1, std::memory_order_relaxed);
+            counters().last_delivery_ms.store(
+                std::chrono::duration<double, std::milli>(now - e.enqueued_at).count(),
+                std::memory_order_relaxed);
+        }
+        q.entries.pop_front();
+        --q.next;
+        --pending_;
+    }
+    if (q.entries.empty()) {
+        queues_.erase(gh_id);
+    }
+
+    // Отметки, накопленные до обработки этого задания, сохраняются одной транзакцией
+    if (!delivered_.empty() && !flush_posted_) {
+        flush_posted_ = true;
+        boost::asio::post(ioc_, [this] { flush_delivered(); });
+    }
+}
+
+void CommandOutbox::flush_delivered()
+{
+    flush_posted_ = false;
+    if (delivered_.empty()) return;
+    // При неудаче команды останутся недоставленными и повторятся после перезапуска
+    if (!store_.mark_delivered(delivered_)) {
+        LOG_WARN_SG("CommandOutbox: failed to persist {} deliveries", delivered_.size());
+    }
+    delivered_.clear();
+}
+
+void CommandOutbox::arm_timer()
+{
+    if (stopped_) return;
+
+    // Ближайшее из: конец паузы теплицы с неотправленными командами,
+    // срок ответа на отправленную команду
+    auto wake = Clock::time_point::max();
+    const auto now = Clock::now();
+    for (const auto& [gh_id, q] : queues_) {
+        if (q.next < q.entries.size() && q.retry_at > now) {
+            wake = std::min(wake, q.retry_at);
+        }
+    }
+    const auto ack_timeout = std::chrono::seconds(cfg_.ack_timeout);
+    for (const auto& [seq, f] : inflight_) {
+        wake = std::min(wake, f.sent_at + ack_timeout);
+    }
+
+    if (wake == timer_at_) return;
+    timer_at_ = wake;
+    if (wake == Clock::time_point::max()) {
+        timer_.cancel();
+        return;
+    }
+    timer_.expires_at(wake);
+    timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted) return;
+        timer_at_ = Clock::time_point::max();
+        on_timer();
+    });
+}
+
+void CommandOutbox::on_timer()
+{
+    const auto deadline = Clock::now() - std::chrono::seconds(cfg_.ack_timeout);
+    for (auto it = inflight_.begin(); it != inflight_.end();) {
+        if (it->second.sent_at > deadline) {
+            ++it;
+            continue;
+        }
+        const Inflight f = it->second;
+        it = inflight_.erase(it);
+        counters().timeouts.fetch_add(1, std::memory_order_relaxed);
+        auto qi = queues_.find(f.gh_id);
+        if (qi != queues_.end() && qi->second.generation == f.generation) {
+            go_back(f.gh_id, qi->second);
+        }
+    }
+    pump();
+}
+
+void CommandOutbox::schedule_prune()
+{
+    if (stopped_) return;
+    const int pruned = store_.prune_delivered(unix_now() - std::int64_t{cfg_.retention_hours} * 3600);
+    if (pruned > 0) {
+        LOG_INFO_SG("CommandOutbox: {} delivered commands pruned", pruned);
+    }
+    prune_timer_.expires_after(kPruneInterval);
+    prune_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (!ec) schedule_prune();
+    });
+}
+
+void CommandOutbox::sync_gauges()
+{
+    counters().pending.store(pending_, std::memory_order_relaxed);
+    counters().in_flight.store(inflight_.size(), std::memory_order_relaxed);
+}
+
+} // namespace processor
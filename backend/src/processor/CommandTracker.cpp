@@ -0,0 +1,137 @@
+#include "processor/CommandTracker.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+
+namespace processor
+{
+
+void LatencyHistogram::add(double ms) noexcept
+{
+    const auto it = std::lower_bound(kBounds.begin(), kBounds.end(), ms);
+    ++buckets[static_cast<size_t>(it - kBounds.begin())];
+    ++count;
+    sum_ms += ms;
+    max_ms = std::max(max_ms, ms);
+}
+
+double LatencyHistogram::quantile(double q) const noexcept
+{
+    if (count == 0) return 0.0;
+    const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < kBounds.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(kBounds[i], max_ms);
+    }
+    return max_ms;
+}
+
+CommandTracker& CommandTracker::instance()
+{
+    static CommandTracker instance;
+    return instance;
+}
+
+CommandTracker::CommandTracker()
+    : prefix_(std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count()) + "-")
+{
+}
+
+void CommandTracker::set_timeout(std::chrono::seconds timeout)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ = std::max(timeout, std::chrono::seconds(1));
+}
+
+std::string CommandTracker::track(int gh_id, int comp_id, int rule_id)
+{
+    const auto now = Clock::now();
+    const auto unix = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweep_locked(now);
+    std::string cid = prefix_ + std::to_string(++seq_);
+    if (pending_.size() < kMaxPending) {
+        pending_.emplace(cid, Pending{gh_id, comp_id, rule_id, now, unix});
+        order_.emplace_back(now, cid);
+    }
+    return cid;
+}
+
+bool CommandTracker::ack(const std::string& cid, bool ok)
+{
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(cid);
+    if (it == pending_.end()) {
+        ++unmatched_;
+        return false;
+    }
+    const Pending p = it->second;
+    pending_.erase(it); // Запись в order_ снимется при sweep
+
+    auto& s = series_[{p.gh_id, p.comp_id}];
+    s.gh_id = p.gh_id;
+    s.comp_id = p.comp_id;
+    if (ok) {
+        s.latency.add(std::chrono::duration<double, std::milli>(now - p.issued).count());
+    } else {
+        ++s.failed;
+    }
+    ++acked_;
+    return true;
+}
+
+void CommandTracker::sweep()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweep_locked(Clock::now());
+}
+
+void CommandTracker::sweep_locked(Clock::time_point now)
+{
+    // Команды выдаются по порядку времени — просроченные в начале order_
+    std::uint64_t expired = 0;
+    while (!order_.empty() && now - order_.front().first >= timeout_) {
+        auto it = pending_.find(order_.front().second);
+        if (it != pending_.end()) {
+            const Pending& p = it->second;
+            auto& s = series_[{p.gh_id, p.comp_id}];
+            s.gh_id = p.gh_id;
+            s.comp_id = p.comp_id;
+            ++s.timeouts;
+            ++timed_out_;
+            ++expired;
+            recent_timeouts_.push_back({it->first, p.gh_id, p.comp_id, p.rule_id, p.issued_unix});
+            if (recent_timeouts_.size() > kRecentTimeouts) recent_timeouts_.pop_front();
+            pending_.erase(it);
+        }
+        order_.pop_front();
+    }
+    if (expired > 0) {
+        LOG_WARN_SG("CommandTracker: {} commands not acknowledged within {} s", expired,
+                    std::chrono::duration_cast<std::chrono::seconds>(timeout_).count());
+    }
+}
+
+CommandTracker::Snapshot CommandTracker::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweep_locked(Clock::now());
+    Snapshot snap;
+    snap.series.reserve(series_.size());
+    for (const auto& [key, s] : series_) {
+        snap.series.push_back(s);
+    }
+    snap.recent_timeouts.assign(recent_timeouts_.begin(), recent_timeouts_.end());
+    snap.pending = pending_.size();
+    snap.acked = acked_;
+    snap.timed_out = timed_out_;
+    snap.unmatched = unmatched_;
+    snap.timeout_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout_).count();
+    return snap;
+}
+
+} // namespace processor
@@ -0,0 +1,325 @@
+#include "processor/CronSpec.hpp"
+#include "processor/MetricDecoder.hpp"
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <ctime>
+#include <vector>
+
+namespace processor
+{
+
+namespace
+{
+    constexpr int kMaxSteps = 100000; ///< Предел итераций поиска (невозможные даты вроде 30 февраля)
+
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+        return s;
+    }
+
+    bool parse_uint(std::string_view s, int &out)
+    {
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc{} && ptr == s.data() + s.size() && out >= 0;
+    }
+
+    bool iequals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+        }
+        return true;
+    }
+
+    /// Описание поля cron: допустимый диапазон и имена значений
+    struct Field
+    {
+        int min;
+        int max;
+        const char *const *names; ///< Имена для значений min..; nullptr — без имён
+        int names_count;
+    };
+
+    constexpr const char *kMonthNames[] = {"jan", "feb", "mar", "apr", "may", "jun",
+                                           "jul", "aug", "sep", "oct", "nov", "dec"};
+    constexpr const char *kDayNames[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+    bool parse_value(std::string_view s, const Field &f, int &out)
+    {
+        if (parse_uint(s, out)) return out >= f.min && out <= f.max;
+        for (int i = 0; i < f.names_count; ++i) {
+            if (iequals(s, f.names[i])) {
+                out = f.min + i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Разбор одного поля в битовую маску; any — поле без ограничений ("*")
+    bool parse_field(std::string_view s, const Field &f, std::uint64_t &bits, bool &any)
+    {
+        bits = 0;
+        any = s == "*";
+        while (!s.empty()) {
+            auto comma = s.find(',');
+            auto item = s.substr(0, comma);
+            s = comma == std::string_view::npos ? std::string_view{} : s.substr(comma + 1);
+            if (item.empty()) return false;
+
+            int step = 1;
+            if (auto slash = item.find('/'); slash != std::string_view::npos) {
+                if (!parse_uint(item.substr(slash + 1), step) || step == 0) return false;
+                item = item.substr(0, slash);
+            }
+
+            int lo, hi;
+            if (item == "*") {
+                lo = f.min;
+                hi = f.max;
+            } else if (auto dash = item.find('-'); dash != std::string_view::npos) {
+                if (!parse_value(item.substr(0, dash), f, lo) ||
+                    !parse_value(item.substr(dash + 1), f, hi) || lo > hi) {
+                    return false;
+                }
+            } else {
+                if (!parse_value(item, f, lo)) return false;
+                // "5/15" — от 5 до конца диапазона с шагом 15
+                hi = step > 1 ? f.max : lo;
+            }
+            for (int v = lo; v <= hi; v += step) {
+                bits |= std::uint64_t{1} << v;
+            }
+        }
+        return bits != 0;
+    }
+
+    bool parse_offset(std::string_view s, std::int32_t &out)
+    {
+        // UTC, UTC+3, UTC+03:00, UTC-05:30
+        if (s.empty()) {
+            out = 0;
+            return true;
+        }
+        const int sign = s.front() == '-' ? -1 : s.front() == '+' ? 1 : 0;
+        if (!sign) return false;
+        s.remove_prefix(1);
+        int h = 0, m = 0;
+        auto colon = s.find(':');
+        if (!parse_uint(s.substr(0, colon), h) || h > 14) return false;
+        if (colon != std::string_view::npos && (!parse_uint(s.substr(colon + 1), m) || m > 59)) return false;
+        out = sign * (h * 3600 + m * 60);
+        return true;
+    }
+
+    void set_error(std::string *error, std::string msg)
+    {
+        if (error) *error = std::move(msg);
+    }
+} // namespace
+
+std::optional<CronSpec> CronSpec::parse(std::string_view spec, std::string *error)
+{
+    CronSpec c;
+    spec = trim(spec);
+
+    for (std::string_view prefix : {std::string_view("CRON_TZ="), std::string_view("TZ=")}) {
+        if (!spec.starts_with(prefix)) continue;
+        spec.remove_prefix(prefix.size());
+        auto space = spec.find(' ');
+        if (space == std::string_view::npos) {
+            set_error(error, "time zone without schedule");
+            return std::nullopt;
+        }
+        auto zone = spec.substr(0, space);
+        spec = trim(spec.substr(space + 1));
+        if (iequals(zone, "local")) {
+            c.local_ = true;
+        } else if (zone.starts_with("UTC") && parse_offset(zone.substr(3), c.utc_offset_)) {
+            c.local_ = false;
+        } else if (zone == "Z" || zone == "GMT") {
+            c.local_ = false;
+            c.utc_offset_ = 0;
+        } else {
+            set_error(error, "unsupported time zone: " + std::string(zone));
+            return std::nullopt;
+        }
+        break;
+    }
+
+    // Однократное срабатывание: YYYY-MM-DD HH:MM:SS
+    if (spec.size() >= 19 && spec[4] == '-') {
+        auto naive = MetricDecoder::parse_timestamp(spec);
+        if (!naive) {
+            set_error(error, "invalid date-time: " + std::string(spec));
+            return std::nullopt;
+        }
+        if (c.local_) {
+            std::tm tm{};
+            const std::time_t t = static_cast<std::time_t>(*naive);
+            gmtime_r(&t, &tm);
+            tm.tm_isdst = -1;
+            c.once_at_ = static_cast<std::int64_t>(std::mktime(&tm));
+        } else {
+            c.once_at_ = *naive - c.utc_offset_;
+        }
+        return c;
+    }
+
+    // Ежедневно: HH:MM[:SS]
+    if (spec.size() >= 4 && spec.size() <= 8 && spec.find(':') != std::string_view::npos &&
+        spec.find(' ') == std::string_view::npos) {
+        auto colon = spec.find(':');
+        auto rest = spec.substr(colon + 1);
+        int h, m;
+        if (!parse_uint(spec.substr(0, colon), h) ||
+            !parse_uint(rest.substr(0, rest.find(':')), m) || h > 23 || m > 59) {
+            set_error(error, "invalid time: " + std::string(spec));
+            return std::nullopt;
+        }
+        std::string fields = std::to_string(m) + " " + std::to_string(h) + " * * *";
+        if (!c.parse_fields(fields, error)) return std::nullopt;
+        return c;
+    }
+
+    static const std::array<std::pair<std::string_view, std::string_view>, 7> macros{{
+        {"@hourly", "0 * * * *"},
+        {"@daily", "0 0 * * *"},
+        {"@midnight", "0 0 * * *"},
+        {"@weekly", "0 0 * * 0"},
+        {"@monthly", "0 0 1 * *"},
+        {"@yearly", "0 0 1 1 *"},
+        {"@annually", "0 0 1 1 *"},
+    }};
+    for (const auto &[name, fields] : macros) {
+        if (spec == name) {
+            spec = fields;
+            break;
+        }
+    }
+
+    if (!c.parse_fields(spec, error)) return std::nullopt;
+    return c;
+}
+
+bool CronSpec::parse_fields(std::string_view fields, std::string *error)
+{
+    std::vector<std::string_view> parts;
+    while (!fields.empty()) {
+        fields = trim(fields);
+        auto space = fields.find_first_of(" \t");
+        parts.push_back(fields.substr(0, space));
+        fields = space == std::string_view::npos ? std::string_view{} : fields.substr(space);
+    }
+    if (parts.size() != 5) {
+        set_error(error, "cron expression must have 5 fields");
+        return false;
+    }
+
+    static constexpr Field kMinute{0, 59, nullptr, 0};
+    static constexpr Field kHour{0, 23, nullptr, 0};
+    static constexpr Field kMday{1, 31, nullptr, 0};
+    static constexpr Field kMonth{1, 12, kMonthNames, 12};
+    static constexpr Field kWday{0, 7, kDayNames, 7};
+
+    std::uint64_t bits = 0;
+    bool any = false;
+    const char *bad = nullptr;
+
+    if (!parse_field(parts[0], kMinute, bits, any)) bad = "minute";
+    minutes_ = bits;
+    if (!bad && !parse_field(parts[1], kHour, bits, any)) bad = "hour";
+    hours_ = static_cast<std::uint32_t>(bits);
+    if (!bad && !parse_field(parts[2], kMday, bits, mday_any_)) bad = "day of month";
+    mdays_ = static_cast<std::uint32_t>(bits);
+    if (!bad && !parse_field(parts[3], kMonth, bits, any)) bad = "month";
+    months_ = static_cast<std::uint16_t>(bits);
+    if (!bad && !parse_field(parts[4], kWday, bits, wday_any_)) bad = "day of week";
+    // 7 — тоже воскресенье
+    wdays_ = static_cast<std::uint8_t>((bits | (bits >> 7)) & 0x7F);
+
+    if (bad) {
+        set_error(error, std::string("invalid cron ") + bad + " field");
+        return false;
+    }
+    return true;
+}
+
+bool CronSpec::day_matches(int mday, int wday) const noexcept
+{
+    const bool m = (mdays_ >> mday) & 1;
+    const bool w = (wdays_ >> wday) & 1;
+    if (mday_any_ && wday_any_) return true;
+    if (mday_any_) return w;
+    if (wday_any_) return m;
+    return m || w;
+}
+
+std::optional<std::int64_t> CronSpec::next_after(std::int64_t t) const
+{
+    if (once_at_) {
+        if (*once_at_ > t) return once_at_;
+        return std::nullopt;
+    }
+
+    auto to_tm = [this](std::int64_t v) {
+        std::tm tm{};
+        if (local_) {
+            const std::time_t tt = static_cast<std::time_t>(v);
+            localtime_r(&tt, &tm);
+        } else {
+            const std::time_t tt = static_cast<std::time_t>(v + utc_offset_);
+            gmtime_r(&tt, &tm);
+        }
+        return tm;
+    };
+    auto from_tm = [this](std::tm tm) -> std::int64_t {
+        if (local_) {
+            tm.tm_isdst = -1;
+            return static_cast<std::int64_t>(std::mktime(&tm));
+        }
+        return static_cast<std::int64_t>(timegm(&tm)) - utc_offset_;
+    };
+
+    std::int64_t cur = (t / 60 + 1) * 60;
+    std::tm tm = to_tm(cur);
+    tm.tm_sec = 0;
+
+    for (int step = 0; step < kMaxSteps; ++step) {
+        if (!((months_ >> (tm.tm_mon + 1)) & 1)) {
+            ++tm.tm_mon;
+            tm.tm_mday = 1;
+            tm.tm_hour = 0;
+            tm.tm_min = 0;
+        } else if (!day_matches(tm.tm_mday, tm.tm_wday)) {
+            ++tm.tm_mday;
+            tm.tm_hour = 0;
+            tm.tm_min = 0;
+        } else if (!((hours_ >> tm.tm_hour) & 1)) {
+            // Сразу к ближайшему разрешённому часу (или к следующим суткам)
+            const std::uint32_t rest = hours_ >> tm.tm_hour;
+            tm.tm_hour = rest ? tm.tm_hour + std::countr_zero(rest) : 24;
+            tm.tm_min = 0;
+        } else if (!((minutes_ >> tm.tm_min) & 1)) {
+            const std::uint64_t rest = minutes_ >> tm.tm_min;
+            tm.tm_min = rest ? tm.tm_min + std::countr_zero(rest) : 60;
+        } else {
+            return cur;
+        }
+
+        // Нормализация через unix-время; при переводе часов назад не даём времени откатиться
+        std::int64_t next = from_tm(tm);
+        if (next <= cur) next = cur + 60;
+        cur = next;
+        tm = to_tm(cur);
+        tm.tm_sec = 0;
+    }
+    return std::nullopt;
+}
+
+} // namespace processor
@@ -0,0 +1,129 @@
+#include "processor/IngestDedup.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+
+namespace processor
+{
+
+namespace
+{
+    struct Counters
+    {
+        std::atomic<std::uint64_t> checked{0};
+        std::atomic<std::uint64_t> duplicates{0};
+        std::atomic<std::uint64_t> stale{0};
+        std::atomic<std::uint64_t> restarts{0};
+    };
+
+    Counters& counters()
+    {
+        static Counters c;
+        return c;
+    }
+} // namespace
+
+IngestDedup::IngestDedup(const IngestDedupConfig& cfg)
+    : cfg_(cfg)
+{
+}
+
+IngestDedup::Stats IngestDedup::stats()
+{
+    auto& c = counters();
+    Stats s;
+    s.checked = c.checked.load(std::memory_order_relaxed);
+    s.duplicates = c.duplicates.load(std::memory_order_relaxed);
+    s.stale = c.stale.load(std::memory_order_relaxed);
+    s.restarts = c.restarts.load(std::memory_order_relaxed);
+    return s;
+}
+
+void IngestDedup::load(const std::vector<db::SeqWatermark>& marks)
+{
+    for (const auto& m : marks) {
+        auto& w = series_[SeriesKey{m.gh_id, m.subtype}];
+        w.high = m.high_seq;
+        w.mask = m.seen_mask;
+    }
+    LOG_INFO_SG("IngestDedup: restored {} series watermarks", marks.size());
+}
+
+IngestDedup::Verdict IngestDedup::check(Window& w, std::int64_t seq)
+{
+    if (w.high < 0 || seq > w.high) {
+        const std::int64_t shift = w.high < 0 ? kWindow : seq - w.high;
+        w.mask = shift >= kWindow ? 0 : w.mask << shift;
+        w.mask |= 1;
+        w.high = seq;
+        return Verdict::Accept;
+    }
+
+    const std::int64_t behind = w.high - seq;
+    if (behind >= cfg_.restart_gap || (seq == 0 && behind >= kWindow)) {
+        // Датчик начал нумерацию заново
+        counters().restarts.fetch_add(1, std::memory_order_relaxed);
+        w.high = seq;
+        w.mask = 1;
+        return Verdict::Accept;
+    }
+    if (behind >= kWindow) return Verdict::Stale;
+
+    const std::uint64_t bit = std::uint64_t{1} << behind;
+    if (w.mask & bit) return Verdict::Duplicate;
+    w.mask |= bit;
+    return Verdict::Accept;
+}
+
+void IngestDedup::apply(std::vector<Metric>& metrics)
+{
+    if (!cfg_.enabled) return;
+
+    std::uint64_t checked = 0, duplicates = 0, stale = 0;
+    auto it = std::remove_if(metrics.begin(), metrics.end(), [&](const Metric& m) {
+        if (m.seq < 0) return false;
+        ++checked;
+
+        auto [pos, inserted] = series_.try_emplace(SeriesKey{m.gh_id, m.subtype});
+        auto& w = pos->second;
+        if (!w.dirty) {
+            undo_.push_back({&pos->first, &w, w});
+            w.dirty = true;
+        }
+
+        switch (check(w, m.seq)) {
+        case Verdict::Duplicate: ++duplicates; return true;
+        case Verdict::Stale:     ++stale;      return true;
+        case Verdict::Accept:    break;
+        }
+        return false;
+    });
+    metrics.erase(it, metrics.end());
+
+    auto& c = counters();
+    c.checked.fetch_add(checked, std::memory_order_relaxed);
+    c.duplicates.fetch_add(duplicates, std::memory_order_relaxed);
+    c.stale.fetch_add(stale, std::memory_order_relaxed);
+}
+
+void IngestDedup::commit(std::vector<db::SeqWatermark>& out)
+{
+    out.reserve(out.size() + undo_.size());
+    for (const auto& u : undo_) {
+        auto& w = *u.window;
+        w.dirty = false;
+        if (w.high != u.before.high || w.mask != u.before.mask) {
+            out.push_back({u.key->gh_id, u.key->subtype, w.high, w.mask});
+        }
+    }
+    undo_.clear();
+}
+
+void IngestDedup::rollback()
+{
+    for (const auto& u : undo_) {
+        *u.window = u.before;
+    }
+    undo_.clear();
+}
+
+} // namespace processor
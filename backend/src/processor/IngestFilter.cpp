@@ -0,0 +1,139 @@
+#include "processor/IngestFilter.hpp"
+#include "processor/MetricDecoder.hpp"
+#include "db/Database.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace processor
+{
+
+namespace
+{
+    struct Counters
+    {
+        std::atomic<std::uint64_t> kept{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<std::uint64_t> heartbeats{0};
+    };
+
+    Counters& counters()
+    {
+        static Counters c;
+        return c;
+    }
+} // namespace
+
+IngestFilter::IngestFilter(const std::vector<IngestFilterConfig>& rules)
+    : rules_(rules)
+{
+}
+
+IngestFilter::Stats IngestFilter::stats()
+{
+    auto& c = counters();
+    Stats s;
+    s.kept = c.kept.load(std::memory_order_relaxed);
+    s.dropped = c.dropped.load(std::memory_order_relaxed);
+    s.heartbeats = c.heartbeats.load(std::memory_order_relaxed);
+    return s;
+}
+
+const IngestFilterConfig* IngestFilter::match(const SeriesKey& key) const
+{
+    const IngestFilterConfig* best = nullptr;
+    int best_score = -1;
+    for (const auto& r : rules_) {
+        const bool gh_any = r.gh_id <= 0;
+        const bool st_any = r.subtype.empty();
+        if ((!gh_any && r.gh_id != key.gh_id) || (!st_any && r.subtype != key.subtype)) {
+            continue;
+        }
+        const int score = (gh_any ? 0 : 1) + (st_any ? 0 : 2);
+        if (score > best_score) {
+            best = &r;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+bool IngestFilter::keep(const SeriesState& st, const Metric& m, std::int64_t ts, bool& heartbeat) const
+{
+    heartbeat = false;
+    const auto* r = st.rule;
+    if (!r || !st.has_stored) return true;
+
+    const std::int64_t elapsed = ts - st.ts;
+
+    if (r->max_silence > 0 && elapsed >= r->max_silence) {
+        heartbeat = true;
+        return true;
+    }
+    if (r->min_interval > 0 && elapsed < r->min_interval) {
+        return false;
+    }
+    const double band = std::max(r->abs_deadband, r->rel_deadband * std::fabs(st.value));
+    return std::fabs(m.value - st.value) > band;
+}
+
+void IngestFilter::apply(std::vector<Metric>& metrics)
+{
+    if (rules_.empty()) {
+        counters().kept.fetch_add(metrics.size(), std::memory_order_relaxed);
+        return;
+    }
+
+    // Метки без разбираемого времени считаем пришедшими сейчас (в том же «наивном» формате)
+    const std::int64_t now = MetricDecoder::parse_timestamp(db::Database::get_current_timestamp()).value_or(0);
+    std::uint64_t heartbeats = 0;
+    SeriesKey key;
+    auto last = std::remove_if(metrics.begin(), metrics.end(), [&](const Metric& m) {
+        key.gh_id = m.gh_id;
+        key.subtype = m.subtype;
+        auto [it, inserted] = series_.try_emplace(key);
+        auto& st = it->second;
+        if (inserted) {
+            st.rule = match(key);
+        }
+
+        const std::int64_t ts = MetricDecoder::parse_timestamp(m.ts).value_or(now);
+        bool heartbeat = false;
+        if (!keep(st, m, ts, heartbeat)) return true;
+
+        heartbeats += heartbeat;
+        if (!st.dirty) {
+            undo_.push_back({&st, st});
+            st.dirty = true;
+        }
+        st.has_stored = true;
+        st.value = m.value;
+        st.ts = ts;
+        return false;
+    });
+
+    const auto dropped = static_cast<std::uint64_t>(metrics.end() - last);
+    metrics.erase(last, metrics.end());
+
+    auto& c = counters();
+    c.kept.fetch_add(metrics.size(), std::memory_order_relaxed);
+    c.dropped.fetch_add(dropped, std::memory_order_relaxed);
+    c.heartbeats.fetch_add(heartbeats, std::memory_order_relaxed);
+}
+
+void IngestFilter::commit()
+{
+    for (const auto& u : undo_) {
+        u.state->dirty = false;
+    }
+    undo_.clear();
+}
+
+void IngestFilter::rollback()
+{
+    for (const auto& u : undo_) {
+        *u.state = u.before;
+    }
+    undo_.clear();
+}
+
+} // namespace processor
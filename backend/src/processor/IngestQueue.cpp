@@ -0,0 +1,238 @@
+#include "processor/IngestQueue.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+
+namespace processor
+{
+
+IngestQueue& IngestQueue::instance()
+{
+    static IngestQueue instance;
+    return instance;
+}
+
+void IngestQueue::start(const IngestConfig& cfg, BatchSink sink)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+
+    cfg_ = cfg;
+    sink_ = std::move(sink);
+    queues_.clear(); // квоты ссылаются на cfg_, поэтому состояние теплиц не переносим
+    active_.clear();
+    running_ = true;
+    worker_ = std::thread([this] { run(); });
+    LOG_INFO_SG("IngestQueue: started (capacity={}, commit={}, quantum={})",
+                cfg_.queue_capacity, cfg_.max_commit_points, cfg_.fairness.quantum);
+}
+
+void IngestQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    LOG_INFO_SG("IngestQueue: stopped ({} points stored)", stored_points_.load());
+}
+
+bool IngestQueue::fits(size_t n) const noexcept
+{
+    // Пакет больше ёмкости принимается только в пустую очередь
+    return pending_points_ == 0 || pending_points_ + n <= cfg_.queue_capacity;
+}
+
+IngestQueue::GhQueue& IngestQueue::queue_for(int gh_id)
+{
+    auto [it, inserted] = queues_.try_emplace(gh_id);
+    auto& q = it->second;
+    if (inserted) {
+        const auto& f = cfg_.fairness;
+        auto found = std::find_if(f.greenhouses.begin(), f.greenhouses.end(),
+                                  [gh_id](const IngestQuotaConfig& c) { return c.gh_id == gh_id; });
+        q.quota = found != f.greenhouses.end() ? &*found : &f.defaults;
+        q.tokens = q.quota->burst;
+        q.refilled = Clock::now();
+    }
+    return q;
+}
+
+bool IngestQueue::admit(GhQueue& q, Clock::time_point now)
+{
+    const auto& quota = *q.quota;
+    if (quota.rate <= 0.0) return true;
+
+    const double dt = std::chrono::duration<double>(now - q.refilled).count();
+    q.tokens = std::min(quota.burst, q.tokens + quota.rate * dt);
+    q.refilled = now;
+    if (q.tokens >= 1.0) {
+        q.tokens -= 1.0;
+        return true;
+    }
+
+    // Сверх квоты: при политике sample пропускаем каждую N-ю точку
+    if (quota.overflow == "sample" &&
+        ++q.overflow_seen % static_cast<std::uint64_t>(quota.sample_every) == 0) {
+        ++q.sampled;
+        return true;
+    }
+    return false;
+}
+
+void IngestQueue::enqueue(std::vector<Metric>&& batch)
+{
+    const auto now = Clock::now();
+    const auto gh_capacity = cfg_.fairness.gh_queue_capacity;
+    GhQueue* q = nullptr;
+    int current_gh = 0;
+    size_t admitted = 0;
+
+    for (auto& m : batch) {
+        // Пакеты обычно от одной теплицы, поэтому поиск очереди кэшируется
+        if (!q || m.gh_id != current_gh) {
+            current_gh = m.gh_id;
+            q = &queue_for(current_gh);
+        }
+        // Переполнение очереди одной теплицы не блокирует общий вход
+        if ((gh_capacity && q->points.size() >= gh_capacity) || !admit(*q, now)) {
+            ++q->shed;
+            continue;
+        }
+        q->points.push_back(std::move(m));
+        ++q->accepted;
+        ++admitted;
+        if (!q->active) {
+            q->active = true;
+            active_.push_back(current_gh);
+        }
+    }
+
+    pending_points_ += admitted;
+    accepted_batches_.fetch_add(1, std::memory_order_relaxed);
+    accepted_points_.fetch_add(admitted, std::memory_order_relaxed);
+    shed_points_.fetch_add(batch.size() - admitted, std::memory_order_relaxed);
+}
+
+void IngestQueue::take_group(std::vector<Metric>& group)
+{
+    const size_t quantum = std::max<size_t>(1, cfg_.fairness.quantum);
+    const size_t limit = std::max<size_t>(1, cfg_.max_commit_points);
+
+    // Deficit round robin: каждая активная теплица за раунд получает quantum точек
+    while (!active_.empty() && group.size() < limit) {
+        const int gh_id = active_.front();
+        active_.pop_front();
+        auto& q = queues_[gh_id];
+
+        q.deficit += quantum;
+        const size_t n = std::min({q.deficit, q.points.size(), limit - group.size()});
+        auto first = q.points.begin();
+        auto last = first + static_cast<std::ptrdiff_t>(n);
+        group.insert(group.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+        q.points.erase(first, last);
+        q.deficit -= n;
+        pending_points_ -= n;
+
+        if (q.points.empty()) {
+            q.deficit = 0;
+            q.active = false;
+        } else {
+            active_.push_back(gh_id);
+        }
+    }
+}
+
+bool IngestQueue::try_push(std::vector<Metric>&& batch)
+{
+    if (batch.empty()) return true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return false;
+        if (!fits(batch.size())) {
+            saturated_batches_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        enqueue(std::move(batch));
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+bool IngestQueue::push(std::vector<Metric>&& batch)
+{
+    if (batch.empty()) return true;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (running_ && !fits(batch.size())) {
+            saturated_batches_.fetch_add(1, std::memory_order_relaxed);
+            not_full_.wait(lock, [&] { return !running_ || fits(batch.size()); });
+        }
+        if (!running_) return false;
+        enqueue(std::move(batch));
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+IngestQueue::Stats IngestQueue::stats() const
+{
+    Stats s;
+    s.accepted_batches = accepted_batches_.load(std::memory_order_relaxed);
+    s.accepted_points = accepted_points_.load(std::memory_order_relaxed);
+    s.saturated_batches = saturated_batches_.load(std::memory_order_relaxed);
+    s.stored_points = stored_points_.load(std::memory_order_relaxed);
+    s.failed_points = failed_points_.load(std::memory_order_relaxed);
+    s.commits = commits_.load(std::memory_order_relaxed);
+    s.shed_points = shed_points_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.pending_points = pending_points_;
+    s.capacity = cfg_.queue_capacity;
+    s.greenhouses.reserve(queues_.size());
+    for (const auto& [gh_id, q] : queues_) {
+        s.greenhouses.push_back({gh_id, q.accepted, q.shed, q.sampled, q.points.size()});
+    }
+    std::sort(s.greenhouses.begin(), s.greenhouses.end(),
+              [](const GreenhouseStats& a, const GreenhouseStats& b) { return a.gh_id < b.gh_id; });
+    return s;
+}
+
+void IngestQueue::run()
+{
+    std::vector<Metric> group;
+    group.reserve(cfg_.max_commit_points);
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return !running_ || !active_.empty(); });
+            if (active_.empty()) return; // остановлены и всё записано
+
+            // Групповая фиксация: забираем накопившееся за время прошлой записи,
+            // чередуя теплицы, чтобы крупная очередь не вытесняла остальные
+            take_group(group);
+        }
+        not_full_.notify_all();
+
+        bool ok = false;
+        try {
+            ok = sink_ && sink_(group);
+        } catch (const std::exception& e) {
+            LOG_ERROR_SG("IngestQueue: sink error: {}", e.what());
+        }
+        if (ok) {
+            stored_points_.fetch_add(group.size(), std::memory_order_relaxed);
+            commits_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            failed_points_.fetch_add(group.size(), std::memory_order_relaxed);
+            LOG_ERROR_SG("IngestQueue: failed to store {} metrics", group.size());
+        }
+        group.clear();
+    }
+}
+
+} // namespace processor
@@ -0,0 +1,36 @@
+#include "processor/LiveMetricCache.hpp"
+#include <mutex>
+
+namespace processor
+{
+
+LiveMetricCache& LiveMetricCache::instance()
+{
+    static LiveMetricCache instance;
+    return instance;
+}
+
+void LiveMetricCache::update(const std::vector<Metric>& metrics)
+{
+    std::unique_lock lock(mutex_);
+    SeriesKey key;
+    for (const auto& m : metrics) {
+        key.gh_id = m.gh_id;
+        key.subtype = m.subtype;
+        auto [it, inserted] = latest_.try_emplace(key, m);
+        // Метки одного формата сравниваются лексикографически
+        if (!inserted && it->second.ts <= m.ts) {
+            it->second = m;
+        }
+    }
+}
+
+std::optional<Metric> LiveMetricCache::latest(int gh_id, const std::string& subtype) const
+{
+    std::shared_lock lock(mutex_);
+    auto it = latest_.find(SeriesKey{gh_id, subtype});
+    if (it == latest_.end()) return std::nullopt;
+    return it->second;
+}
+
+} // namespace processor
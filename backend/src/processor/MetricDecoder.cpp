@@ -0,0 +1,291 @@
+#include "processor/MetricDecoder.hpp"
+#include "db/Database.hpp"
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+using json = nlohmann::json;
+
+namespace processor
+{
+
+namespace
+{
+    template <typename T>
+    T read_le(const unsigned char *p)
+    {
+        T v{};
+        // Все поддерживаемые платформы little-endian
+        std::memcpy(&v, p, sizeof(T));
+        return v;
+    }
+
+    bool to_gh_id(const json &item, int default_gh_id, int &out)
+    {
+        auto it = item.find("gh_id");
+        if (it == item.end() || it->is_null()) {
+            out = default_gh_id;
+            return out > 0;
+        }
+        if (!it->is_number_integer()) return false;
+        out = it->get<int>();
+        return out > 0;
+    }
+
+    bool to_subtype(const json &item, std::string &out)
+    {
+        auto it = item.find("subtype");
+        if (it == item.end()) return false;
+        if (it->is_string()) {
+            out = it->get<std::string>();
+        } else if (it->is_number_integer()) {
+            out = std::to_string(it->get<long long>());
+        } else {
+            return false;
+        }
+        return !out.empty();
+    }
+
+    bool to_ts(const json &item, const std::string &now, std::string &out)
+    {
+        auto it = item.find("ts");
+        if (it == item.end() || it->is_null()) {
+            out = now;
+            return true;
+        }
+        if (it->is_number_integer()) {
+            out = MetricDecoder::format_timestamp(it->get<std::int64_t>());
+            return true;
+        }
+        if (!it->is_string()) return false;
+        out = it->get<std::string>();
+        return !out.empty();
+    }
+
+    bool to_seq(const json &item, std::int64_t &out)
+    {
+        auto it = item.find("seq");
+        if (it == item.end()) it = item.find("msg_id");
+        if (it == item.end() || it->is_null()) {
+            out = -1;
+            return true;
+        }
+        if (!it->is_number_integer()) return false;
+        out = it->get<std::int64_t>();
+        return out >= 0;
+    }
+} // namespace
+
+PayloadFormat MetricDecoder::detect(std::string_view content_type, std::string_view payload)
+{
+    if (content_type.starts_with(kBinaryContentType) ||
+        content_type.starts_with("application/octet-stream")) {
+        return PayloadFormat::Binary;
+    }
+    if (content_type.empty() && payload.size() >= kBinaryHeaderSize &&
+        (std::memcmp(payload.data(), kBinaryMagic, kBinaryHeaderSize) == 0 ||
+         std::memcmp(payload.data(), kCompactMagic, kBinaryHeaderSize) == 0)) {
+        return PayloadFormat::Binary;
+    }
+    return PayloadFormat::Json;
+}
+
+DecodeResult MetricDecoder::decode(std::string_view payload,
+                                   PayloadFormat format,
+                                   int default_gh_id,
+                                   size_t max_points)
+{
+    if (payload.empty()) {
+        DecodeResult r;
+        r.malformed = true;
+        return r;
+    }
+    if (format == PayloadFormat::Json) {
+        return decode_json(payload, default_gh_id, max_points);
+    }
+    if (payload.size() >= kBinaryHeaderSize &&
+        std::memcmp(payload.data(), kCompactMagic, kBinaryHeaderSize) == 0) {
+        return decode_compact(payload, default_gh_id, max_points);
+    }
+    return decode_binary(payload, max_points);
+}
+
+bool MetricDecoder::validate(const Metric &m)
+{
+    return m.gh_id > 0 && !m.subtype.empty() && !m.ts.empty() && std::isfinite(m.value);
+}
+
+std::string MetricDecoder::format_timestamp(std::int64_t unix_seconds)
+{
+    std::time_t t = static_cast<std::time_t>(unix_seconds);
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    char buf[20];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+    return buf;
+}
+
+std::optional<std::int64_t> MetricDecoder::parse_timestamp(std::string_view ts)
+{
+    // YYYY-MM-DD HH:MM:SS (допускается 'T' вместо пробела и хвост после секунд)
+    if (ts.size() < 19 || ts[4] != '-' || ts[7] != '-' ||
+        (ts[10] != ' ' && ts[10] != 'T') || ts[13] != ':' || ts[16] != ':') {
+        return std::nullopt;
+    }
+    auto num = [&](size_t pos, size_t len, int& out) {
+        out = 0;
+        for (size_t i = pos; i < pos + len; ++i) {
+            if (ts[i] < '0' || ts[i] > '9') return false;
+            out = out * 10 + (ts[i] - '0');
+        }
+        return true;
+    };
+    int y, mo, d, h, mi, sec;
+    if (!num(0, 4, y) || !num(5, 2, mo) || !num(8, 2, d) ||
+        !num(11, 2, h) || !num(14, 2, mi) || !num(17, 2, sec) ||
+        mo < 1 || mo > 12 || d < 1 || d > 31) {
+        return std::nullopt;
+    }
+
+    // days_from_civil (H. Hinnant)
+    y -= mo <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const std::int64_t days = era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+    return days * 86400 + h * 3600 + mi * 60 + sec;
+}
+
+DecodeResult MetricDecoder::decode_json(std::string_view payload, int default_gh_id, size_t max_points)
+{
+    DecodeResult r;
+    json j = json::parse(payload.begin(), payload.end(), nullptr, false);
+    if (j.is_discarded() || !(j.is_object() || j.is_array())) {
+        r.malformed = true;
+        return r;
+    }
+
+    const std::string now = db::Database::get_current_timestamp();
+    auto accept = [&](const json &item) {
+        Metric m;
+        auto v = item.is_object() ? item.find("value") : item.end();
+        if (!item.is_object() || v == item.end() || !v->is_number() ||
+            !to_gh_id(item, default_gh_id, m.gh_id) ||
+            !to_subtype(item, m.subtype) ||
+            !to_ts(item, now, m.ts) ||
+            !to_seq(item, m.seq)) {
+            ++r.rejected;
+            return;
+        }
+        m.value = v->get<double>();
+        if (!validate(m)) {
+            ++r.rejected;
+            return;
+        }
+        r.metrics.push_back(std::move(m));
+    };
+
+    if (j.is_array()) {
+        const size_t take = max_points ? std::min(j.size(), max_points) : j.size();
+        r.truncated = j.size() - take;
+        r.metrics.reserve(take);
+        for (size_t i = 0; i < take; ++i) accept(j[i]);
+    } else {
+        accept(j);
+    }
+    return r;
+}
+
+DecodeResult MetricDecoder::decode_binary(std::string_view payload, size_t max_points)
+{
+    DecodeResult r;
+    if (payload.size() < kBinaryHeaderSize ||
+        std::memcmp(payload.data(), kBinaryMagic, kBinaryHeaderSize) != 0 ||
+        (payload.size() - kBinaryHeaderSize) % kBinaryRecordSize != 0) {
+        r.malformed = true;
+        return r;
+    }
+
+    const auto *p = reinterpret_cast<const unsigned char *>(payload.data()) + kBinaryHeaderSize;
+    const size_t count = (payload.size() - kBinaryHeaderSize) / kBinaryRecordSize;
+    const size_t take = max_points ? std::min(count, max_points) : count;
+    r.truncated = count - take;
+    r.metrics.reserve(take);
+
+    // Подряд идущие записи обычно имеют одинаковую секунду — не форматируем её повторно
+    const std::string now_str = db::Database::get_current_timestamp();
+    std::uint32_t last_ts = 0;
+    std::string last_ts_str;
+
+    for (size_t i = 0; i < take; ++i, p += kBinaryRecordSize) {
+        Metric m;
+        m.gh_id = read_le<std::uint16_t>(p);
+        m.subtype = std::to_string(read_le<std::uint16_t>(p + 2));
+        const auto ts = read_le<std::uint32_t>(p + 4);
+        m.value = read_le<double>(p + 8);
+
+        if (ts != 0 && ts != last_ts) {
+            last_ts = ts;
+            last_ts_str = format_timestamp(ts);
+        }
+        m.ts = ts == 0 ? now_str : last_ts_str;
+
+        if (!validate(m)) {
+            ++r.rejected;
+            continue;
+        }
+        r.metrics.push_back(std::move(m));
+    }
+    return r;
+}
+
+DecodeResult MetricDecoder::decode_compact(std::string_view payload, int default_gh_id, size_t max_points)
+{
+    DecodeResult r;
+    if (payload.size() < kCompactHeaderSize ||
+        (payload.size() - kCompactHeaderSize) % kCompactRecordSize != 0) {
+        r.malformed = true;
+        return r;
+    }
+
+    const auto *p = reinterpret_cast<const unsigned char *>(payload.data()) + sizeof(kCompactMagic);
+    const int header_gh = read_le<std::uint16_t>(p);
+    const int gh_id = header_gh != 0 ? header_gh : default_gh_id;
+    const auto base_ts = read_le<std::uint32_t>(p + 2);
+    p += kCompactHeaderSize - sizeof(kCompactMagic);
+
+    const size_t count = (payload.size() - kCompactHeaderSize) / kCompactRecordSize;
+    const size_t take = max_points ? std::min(count, max_points) : count;
+    r.truncated = count - take;
+    r.metrics.reserve(take);
+
+    // Без base_ts все записи пакета — «сейчас», dt не учитывается
+    const std::string now_str = db::Database::get_current_timestamp();
+    std::int64_t last_ts = -1;
+    std::string last_ts_str;
+
+    for (size_t i = 0; i < take; ++i, p += kCompactRecordSize) {
+        Metric m;
+        m.gh_id = gh_id;
+        m.subtype = std::to_string(read_le<std::uint16_t>(p));
+        const std::int64_t ts = base_ts == 0 ? 0 : std::int64_t{base_ts} + read_le<std::uint16_t>(p + 2);
+        m.value = read_le<float>(p + 4);
+
+        if (ts != 0 && ts != last_ts) {
+            last_ts = ts;
+            last_ts_str = format_timestamp(ts);
+        }
+        m.ts = ts == 0 ? now_str : last_ts_str;
+
+        if (!validate(m)) {
+            ++r.rejected;
+            continue;
+        }
+        r.metrics.push_back(std::move(m));
+    }
+    return r;
+}
+
+} // namespace processor
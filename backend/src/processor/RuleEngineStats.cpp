@@ -0,0 +1,59 @@
+#include "processor/RuleEngineStats.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace processor
+{
+
+namespace
+{
+    struct Counters
+    {
+        std::mutex mutex;
+        RuleEngineStats::Stats stats;
+    };
+
+    Counters& counters()
+    {
+        static Counters c;
+        return c;
+    }
+} // namespace
+
+void RuleEngineStats::record_tick(double ms)
+{
+    auto& c = counters();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    auto& s = c.stats;
+    ++s.ticks;
+    s.last_tick_ms = ms;
+    s.max_tick_ms = std::max(s.max_tick_ms, ms);
+}
+
+void RuleEngineStats::record_batch(double ms, std::uint64_t partitions, std::uint64_t triggers,
+                                   int slowest_gh, double slowest_ms)
+{
+    auto& c = counters();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    auto& s = c.stats;
+    ++s.batches;
+    s.partitions += partitions;
+    s.triggers += triggers;
+    s.last_batch_ms = ms;
+    s.max_batch_ms = std::max(s.max_batch_ms, ms);
+    s.slowest_gh = slowest_gh;
+    s.slowest_partition_ms = slowest_ms;
+    if (slowest_ms >= s.max_partition_ms) {
+        s.max_partition_ms = slowest_ms;
+        s.max_partition_gh = slowest_gh;
+    }
+}
+
+RuleEngineStats::Stats RuleEngineStats::stats()
+{
+    auto& c = counters();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    return c.stats;
+}
+
+} // namespace processor
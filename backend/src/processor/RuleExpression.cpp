@@ -0,0 +1,455 @@
+#include "processor/RuleExpression.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace processor
+{
+
+namespace
+{
+    enum class Tok
+    {
+        End,
+        Number,
+        Ident,
+        String,
+        LParen,
+        RParen,
+        Comma,
+        Plus,
+        Minus,
+        Star,
+        Slash,
+        Gt,
+        Ge,
+        Lt,
+        Le,
+        Eq,
+        Ne,
+        And,
+        Or,
+        Not
+    };
+
+    struct Token
+    {
+        Tok kind = Tok::End;
+        std::string_view text; ///< Ident/String: имя; Number: суффикс единиц
+        double number = 0.0;
+    };
+
+    bool iequals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+        }
+        return true;
+    }
+
+    bool is_ident_char(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    }
+
+    bool truthy(double v) { return !std::isnan(v) && v != 0.0; }
+    bool falsy(double v) { return v == 0.0; }
+} // namespace
+
+/// Лексер и парсер рекурсивным спуском; пишет байт-код сразу в RuleExpression
+class ExprParser
+{
+public:
+    ExprParser(std::string_view text, RuleExpression &out) : src_(text), out_(out) {}
+
+    bool parse(std::string &error)
+    {
+        if (!advance() || !parse_or()) {
+            error = error_;
+            return false;
+        }
+        if (cur_.kind != Tok::End) {
+            error = "unexpected '" + std::string(cur_.text) + "' at position " + std::to_string(tok_pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(std::string msg)
+    {
+        if (error_.empty()) error_ = std::move(msg) + " at position " + std::to_string(tok_pos_);
+        return false;
+    }
+
+    bool advance()
+    {
+        while (pos_ < src_.size() && std::isspace(static_cast<unsigned char>(src_[pos_]))) ++pos_;
+        tok_pos_ = pos_;
+        cur_ = Token{};
+        if (pos_ >= src_.size()) return true;
+
+        const char c = src_[pos_];
+        auto two = [&](char next) { return pos_ + 1 < src_.size() && src_[pos_ + 1] == next; };
+        auto single = [&](Tok k, size_t len) {
+            cur_.kind = k;
+            cur_.text = src_.substr(pos_, len);
+            pos_ += len;
+            return true;
+        };
+
+        if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && pos_ + 1 < src_.size() &&
+                                                           std::isdigit(static_cast<unsigned char>(src_[pos_ + 1])))) {
+            const char *begin = src_.data() + pos_;
+            auto [ptr, ec] = std::from_chars(begin, src_.data() + src_.size(), cur_.number);
+            if (ec != std::errc{}) return fail("invalid number");
+            pos_ += static_cast<size_t>(ptr - begin);
+            // Суффикс единиц длительности (5m, 30s)
+            const size_t unit = pos_;
+            while (pos_ < src_.size() && std::isalpha(static_cast<unsigned char>(src_[pos_]))) ++pos_;
+            cur_.kind = Tok::Number;
+            cur_.text = src_.substr(unit, pos_ - unit);
+            return true;
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const size_t begin = pos_;
+            while (pos_ < src_.size() && is_ident_char(src_[pos_])) ++pos_;
+            cur_.text = src_.substr(begin, pos_ - begin);
+            if (iequals(cur_.text, "and")) cur_.kind = Tok::And;
+            else if (iequals(cur_.text, "or")) cur_.kind = Tok::Or;
+            else if (iequals(cur_.text, "not")) cur_.kind = Tok::Not;
+            else cur_.kind = Tok::Ident;
+            return true;
+        }
+        if (c == '"' || c == '\'') {
+            const auto close = src_.find(c, pos_ + 1);
+            if (close == std::string_view::npos) return fail("unterminated string");
+            cur_.kind = Tok::String;
+            cur_.text = src_.substr(pos_ + 1, close - pos_ - 1);
+            pos_ = close + 1;
+            return true;
+        }
+
+        switch (c)
+        {
+        case '(': return single(Tok::LParen, 1);
+        case ')': return single(Tok::RParen, 1);
+        case ',': return single(Tok::Comma, 1);
+        case '+': return single(Tok::Plus, 1);
+        case '-': return single(Tok::Minus, 1);
+        case '*': return single(Tok::Star, 1);
+        case '/': return single(Tok::Slash, 1);
+        case '>': return two('=') ? single(Tok::Ge, 2) : single(Tok::Gt, 1);
+        case '<': return two('=') ? single(Tok::Le, 2) : single(Tok::Lt, 1);
+        case '=': return two('=') ? single(Tok::Eq, 2) : single(Tok::Eq, 1);
+        case '!': return two('=') ? single(Tok::Ne, 2) : single(Tok::Not, 1);
+        case '&':
+            if (two('&')) return single(Tok::And, 2);
+            break;
+        case '|':
+            if (two('|')) return single(Tok::Or, 2);
+            break;
+        default:
+            break;
+        }
+        return fail(std::string("unexpected character '") + c + "'");
+    }
+
+    bool expect(Tok kind, const char *what)
+    {
+        if (cur_.kind != kind) return fail(std::string("expected ") + what);
+        return advance();
+    }
+
+    void emit(RuleExpression::Op op, std::uint32_t arg = 0, double imm = 0.0)
+    {
+        using Op = RuleExpression::Op;
+        out_.code_.push_back({op, arg, imm});
+        if (op == Op::Const || op == Op::Load) {
+            ++depth_;
+        } else if (op != Op::Neg && op != Op::Not) {
+            --depth_;
+        }
+        max_depth_ = std::max(max_depth_, depth_);
+    }
+
+    bool check_depth()
+    {
+        return max_depth_ <= RuleExpression::kMaxStack || fail("expression is too deep");
+    }
+
+    // Вложенность ограничивается до рекурсивного вызова: стек вычисления
+    // растёт только на значениях, а `((((...` или `- - -...` без них
+    // исчерпали бы стек потока
+    bool enter()
+    {
+        return ++nesting_ <= RuleExpression::kMaxNesting || fail("expression is too deep");
+    }
+
+    bool parse_or()
+    {
+        if (!parse_and()) return false;
+        while (cur_.kind == Tok::Or) {
+            if (!advance() || !parse_and()) return false;
+            emit(RuleExpression::Op::Or);
+        }
+        return true;
+    }
+
+    bool parse_and()
+    {
+        if (!parse_not()) return false;
+        while (cur_.kind == Tok::And) {
+            if (!advance() || !parse_not()) return false;
+            emit(RuleExpression::Op::And);
+        }
+        return true;
+    }
+
+    bool parse_not()
+    {
+        if (cur_.kind == Tok::Not) {
+            if (!enter() || !advance() || !parse_not()) return false;
+            --nesting_;
+            emit(RuleExpression::Op::Not);
+            return true;
+        }
+        return parse_cmp();
+    }
+
+    bool parse_cmp()
+    {
+        using Op = RuleExpression::Op;
+        if (!parse_sum()) return false;
+
+        Op op;
+        switch (cur_.kind)
+        {
+        case Tok::Gt: op = Op::Gt; break;
+        case Tok::Ge: op = Op::Ge; break;
+        case Tok::Lt: op = Op::Lt; break;
+        case Tok::Le: op = Op::Le; break;
+        case Tok::Eq: op = Op::Eq; break;
+        case Tok::Ne: op = Op::Ne; break;
+        default: return true;
+        }
+        if (!advance() || !parse_sum()) return false;
+        emit(op);
+        return true;
+    }
+
+    bool parse_sum()
+    {
+        if (!parse_term()) return false;
+        while (cur_.kind == Tok::Plus || cur_.kind == Tok::Minus) {
+            const auto op = cur_.kind == Tok::Plus ? RuleExpression::Op::Add : RuleExpression::Op::Sub;
+            if (!advance() || !parse_term()) return false;
+            emit(op);
+        }
+        return true;
+    }
+
+    bool parse_term()
+    {
+        if (!parse_unary()) return false;
+        while (cur_.kind == Tok::Star || cur_.kind == Tok::Slash) {
+            const auto op = cur_.kind == Tok::Star ? RuleExpression::Op::Mul : RuleExpression::Op::Div;
+            if (!advance() || !parse_unary()) return false;
+            emit(op);
+        }
+        return true;
+    }
+
+    bool parse_unary()
+    {
+        if (cur_.kind == Tok::Minus) {
+            if (!enter() || !advance() || !parse_unary()) return false;
+            --nesting_;
+            emit(RuleExpression::Op::Neg);
+            return true;
+        }
+        return parse_primary();
+    }
+
+    bool parse_primary()
+    {
+        switch (cur_.kind)
+        {
+        case Tok::Number:
+        {
+            if (!cur_.text.empty()) return fail("unexpected unit '" + std::string(cur_.text) + "'");
+            emit(RuleExpression::Op::Const, 0, cur_.number);
+            return advance() && check_depth();
+        }
+        case Tok::String:
+        {
+            const std::string subtype(cur_.text);
+            return advance() && load({subtype, Aggregate::Last, 0});
+        }
+        case Tok::Ident:
+        {
+            const std::string name(cur_.text);
+            if (!advance()) return false;
+            if (cur_.kind != Tok::LParen) return load({name, Aggregate::Last, 0});
+            return parse_call(name);
+        }
+        case Tok::LParen:
+            if (!enter() || !advance() || !parse_or() || !expect(Tok::RParen, "')'")) return false;
+            --nesting_;
+            return true;
+        default:
+            return fail("expected value");
+        }
+    }
+
+    bool parse_call(const std::string &name)
+    {
+        static const std::array<std::pair<std::string_view, Aggregate>, 6> kFunctions{{
+            {"last", Aggregate::Last},
+            {"avg", Aggregate::Avg},
+            {"min", Aggregate::Min},
+            {"max", Aggregate::Max},
+            {"rate", Aggregate::Rate},
+            {"count", Aggregate::Count},
+        }};
+
+        std::optional<Aggregate> agg;
+        for (const auto &[fn, a] : kFunctions) {
+            if (iequals(name, fn)) agg = a;
+        }
+        if (!agg) return fail("unknown function '" + name + "'");
+        if (!advance()) return false;
+
+        if (cur_.kind != Tok::Ident && cur_.kind != Tok::String) return fail("expected series name");
+        ExprOperand operand{std::string(cur_.text), *agg, 0};
+        if (!advance()) return false;
+
+        if (cur_.kind == Tok::Comma) {
+            if (!advance()) return false;
+            if (cur_.kind != Tok::Number) return fail("expected window duration");
+            int mult = 0;
+            if (cur_.text.empty() || cur_.text == "s") mult = 1;
+            else if (cur_.text == "m") mult = 60;
+            else if (cur_.text == "h") mult = 3600;
+            else if (cur_.text == "d") mult = 86400;
+            else return fail("unknown duration unit '" + std::string(cur_.text) + "'");
+
+            const double seconds = cur_.number * mult;
+            if (!(seconds >= 1.0) || seconds > 7 * 86400.0) return fail("window must be 1s..7d");
+            operand.window = static_cast<std::int32_t>(seconds);
+            if (!advance()) return false;
+        } else if (*agg != Aggregate::Last) {
+            return fail("function '" + name + "' requires a window");
+        }
+        return expect(Tok::RParen, "')'") && load(std::move(operand));
+    }
+
+    bool load(ExprOperand operand)
+    {
+        auto &ops = out_.operands_;
+        std::uint32_t idx = 0;
+        while (idx < ops.size() && !(ops[idx].subtype == operand.subtype && ops[idx].agg == operand.agg &&
+                                     ops[idx].window == operand.window)) {
+            ++idx;
+        }
+        if (idx == ops.size()) {
+            if (ops.size() >= RuleExpression::kMaxOperands) return fail("too many operands");
+            ops.push_back(std::move(operand));
+        }
+        emit(RuleExpression::Op::Load, idx);
+        return check_depth();
+    }
+
+    std::string_view src_;
+    RuleExpression &out_;
+    size_t pos_ = 0;
+    size_t tok_pos_ = 0;
+    Token cur_;
+    std::string error_;
+    size_t depth_ = 0;
+    size_t max_depth_ = 0;
+    size_t nesting_ = 0;
+};
+
+std::optional<RuleExpression> RuleExpression::compile(std::string_view text, std::string *error)
+{
+    RuleExpression expr;
+    if (text.size() > kMaxLength) {
+        if (error) *error = "expression is too long";
+        return std::nullopt;
+    }
+    std::string err;
+    ExprParser parser(text, expr);
+    if (!parser.parse(err)) {
+        if (error) *error = std::move(err);
+        return std::nullopt;
+    }
+    if (expr.code_.empty()) {
+        if (error) *error = "empty expression";
+        return std::nullopt;
+    }
+    return expr;
+}
+
+double RuleExpression::eval(const double *values) const noexcept
+{
+    constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+    std::array<double, kMaxStack> stack;
+    size_t sp = 0;
+
+    // Сравнение с неизвестным операндом тоже неизвестно
+    auto cmp = [](double a, double b, bool r) { return std::isnan(a) || std::isnan(b) ? kNaN : (r ? 1.0 : 0.0); };
+
+    for (const auto &in : code_) {
+        if (in.op == Op::Const) {
+            stack[sp++] = in.imm;
+            continue;
+        }
+        if (in.op == Op::Load) {
+            stack[sp++] = values[in.arg];
+            continue;
+        }
+        if (in.op == Op::Neg) {
+            stack[sp - 1] = -stack[sp - 1];
+            continue;
+        }
+        if (in.op == Op::Not) {
+            const double a = stack[sp - 1];
+            stack[sp - 1] = std::isnan(a) ? kNaN : (a == 0.0 ? 1.0 : 0.0);
+            continue;
+        }
+
+        const double b = stack[--sp];
+        const double a = stack[sp - 1];
+        double r = kNaN;
+        switch (in.op)
+        {
+        case Op::Add: r = a + b; break;
+        case Op::Sub: r = a - b; break;
+        case Op::Mul: r = a * b; break;
+        case Op::Div: r = b == 0.0 ? kNaN : a / b; break;
+        case Op::Gt: r = cmp(a, b, a > b); break;
+        case Op::Ge: r = cmp(a, b, a >= b); break;
+        case Op::Lt: r = cmp(a, b, a < b); break;
+        case Op::Le: r = cmp(a, b, a <= b); break;
+        case Op::Eq: r = cmp(a, b, a == b); break;
+        case Op::Ne: r = cmp(a, b, a != b); break;
+        case Op::And:
+            r = falsy(a) || falsy(b) ? 0.0 : (std::isnan(a) || std::isnan(b) ? kNaN : 1.0);
+            break;
+        case Op::Or:
+            r = truthy(a) || truthy(b) ? 1.0 : (std::isnan(a) || std::isnan(b) ? kNaN : 0.0);
+            break;
+        default:
+            break;
+        }
+        stack[sp - 1] = r;
+    }
+    return sp ? stack[sp - 1] : kNaN;
+}
+
+} // namespace processor
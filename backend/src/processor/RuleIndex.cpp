@@ -0,0 +1,492 @@
+#include "processor/RuleIndex.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace processor
+{
+
+namespace
+{
+    std::optional<CompareOp> parse_op(const std::string& op)
+    {
+        if (op == ">")  return CompareOp::Gt;
+        if (op == ">=") return CompareOp::Ge;
+        if (op == "<")  return CompareOp::Lt;
+        if (op == "<=") return CompareOp::Le;
+        if (op == "=" || op == "==") return CompareOp::Eq;
+        if (op == "!=") return CompareOp::Ne;
+        return std::nullopt;
+    }
+
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    constexpr std::uint32_t kNoSeries = std::numeric_limits<std::uint32_t>::max();
+
+    /// Отрезок ThresholdBatch, в котором выполняется matches()
+    struct Interval
+    {
+        double lo;
+        double hi;
+        bool invert;
+    };
+
+    Interval on_interval(const CompiledRule& r) noexcept
+    {
+        const double t = r.threshold;
+        switch (r.op)
+        {
+        case CompareOp::Gt: return {std::nextafter(t, kInf), kInf, false};
+        case CompareOp::Ge: return {t, kInf, false};
+        case CompareOp::Lt: return {-kInf, std::nextafter(t, -kInf), false};
+        case CompareOp::Le: return {-kInf, t, false};
+        case CompareOp::Eq: return {t, t, false};
+        case CompareOp::Ne: return {t, t, true};
+        }
+        return {kInf, -kInf, false};
+    }
+
+    /// Отрезок, в котором выполняется releases()
+    Interval off_interval(const CompiledRule& r) noexcept
+    {
+        if (r.has_off) {
+            switch (r.op)
+            {
+            case CompareOp::Gt:
+            case CompareOp::Ge: return {-kInf, std::nextafter(r.off_threshold, -kInf), false};
+            case CompareOp::Lt:
+            case CompareOp::Le: return {std::nextafter(r.off_threshold, kInf), kInf, false};
+            default: break;
+            }
+        }
+        auto in = on_interval(r);
+        in.invert = !in.invert;
+        return in;
+    }
+} // namespace
+
+RuleIndex& RuleIndex::instance()
+{
+    static RuleIndex instance;
+    return instance;
+}
+
+std::optional<CompiledRule> RuleIndex::compile(const Rule& rule)
+{
+    if (!rule.enabled || rule.kind != "threshold") return std::nullopt;
+
+    CompiledRule c;
+    c.rule_id = rule.rule_id;
+    c.gh_id = rule.gh_id;
+    c.to_comp_id = rule.to_comp_id;
+
+    if (rule.expression) {
+        // Результат выражения сравнивается с нулём: matches() == (r != 0)
+        c.expression = true;
+        c.op = CompareOp::Ne;
+        c.threshold = 0.0;
+    } else {
+        if (!rule.threshold || !rule.operator_) return std::nullopt;
+        auto op = parse_op(*rule.operator_);
+        if (!op) {
+            LOG_WARN_SG("RuleIndex: rule {} has unknown operator {}", rule.rule_id, *rule.operator_);
+            return std::nullopt;
+        }
+        c.op = *op;
+        c.threshold = *rule.threshold;
+        c.has_off = rule.off_threshold.has_value();
+        c.off_threshold = rule.off_threshold.value_or(0.0);
+    }
+    c.debounce = std::max(rule.debounce_sec, 0);
+    c.min_dwell = std::max(rule.min_dwell_sec, 0);
+    return c;
+}
+
+std::uint32_t RuleIndex::intern(SeriesKey key)
+{
+    auto [it, inserted] = series_ids_.try_emplace(key, static_cast<std::uint32_t>(series_keys_.size()));
+    if (inserted) {
+        series_keys_.push_back(std::move(key));
+    }
+    return it->second;
+}
+
+void RuleIndex::upsert_locked(const Rule& rule)
+{
+    auto c = compile(rule);
+    if (c && c->expression) {
+        std::string error;
+        auto program = RuleExpression::compile(*rule.expression, &error);
+        if (!program) {
+            LOG_WARN_SG("RuleIndex: rule {} has invalid expression '{}': {}",
+                        rule.rule_id, *rule.expression, error);
+            c.reset();
+        } else {
+            expressions_.insert_or_assign(rule.rule_id, std::move(*program));
+        }
+    }
+    if (!c) {
+        compiled_.erase(rule.rule_id);
+        expressions_.erase(rule.rule_id);
+        return;
+    }
+    if (!c->expression) {
+        expressions_.erase(rule.rule_id);
+        c->series = intern({rule.gh_id, std::to_string(rule.from_comp_id)});
+    }
+    compiled_[rule.rule_id] = *c;
+}
+
+void RuleIndex::layout()
+{
+    // Состояния переносятся по rule_id, чтобы изменение одного правила
+    // не вызвало повторных команд остальных
+    std::unordered_map<int, RuleState> states;
+    states.reserve(rules_.size());
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        states.emplace(rules_[i].rule_id, states_[i]);
+    }
+
+    rules_.clear();
+    rules_.reserve(compiled_.size());
+    for (const auto& [id, c] : compiled_) {
+        if (!c.expression) rules_.push_back(c);
+    }
+    plain_count_ = rules_.size();
+    for (const auto& [id, c] : compiled_) {
+        if (c.expression) rules_.push_back(c);
+    }
+    std::sort(rules_.begin(), rules_.begin() + plain_count_,
+              [](const CompiledRule& a, const CompiledRule& b) {
+                  return a.series != b.series ? a.series < b.series : a.rule_id < b.rule_id;
+              });
+    std::sort(rules_.begin() + plain_count_, rules_.end(),
+              [](const CompiledRule& a, const CompiledRule& b) { return a.rule_id < b.rule_id; });
+
+    // Ряды выражений интернируются до построения смещений
+    layout_expressions(plain_count_);
+
+    series_begin_.assign(series_keys_.size() + 1, 0);
+    for (size_t i = 0; i < plain_count_; ++i) {
+        ++series_begin_[rules_[i].series + 1];
+    }
+    for (size_t i = 1; i < series_begin_.size(); ++i) {
+        series_begin_[i] += series_begin_[i - 1];
+    }
+
+    states_.assign(rules_.size(), RuleState{});
+    if (!states.empty()) {
+        for (size_t i = 0; i < rules_.size(); ++i) {
+            if (auto it = states.find(rules_[i].rule_id); it != states.end()) {
+                states_[i] = it->second;
+            }
+        }
+    }
+    layout_batch();
+}
+
+void RuleIndex::layout_batch()
+{
+    on_batch_.clear();
+    off_batch_.clear();
+    for (size_t i = 0; i < plain_count_; ++i) {
+        const auto on = on_interval(rules_[i]);
+        const auto off = off_interval(rules_[i]);
+        on_batch_.push(rules_[i].series, on.lo, on.hi, on.invert);
+        off_batch_.push(rules_[i].series, off.lo, off.hi, off.invert);
+    }
+
+    const size_t words = (plain_count_ + 63) / 64;
+    active_bits_.assign(words, 0);
+    pending_bits_.assign(words, 0);
+    match_bits_.assign(words, 0);
+    release_bits_.assign(words, 0);
+    for (size_t i = 0; i < plain_count_; ++i) {
+        sync_bits(i);
+    }
+
+    const size_t series_count = series_keys_.size();
+    latest_.assign(series_count, 0.0);
+    touched_.assign(series_count, 0);
+    last_point_.assign(series_count, 0);
+    epoch_ = 0;
+}
+
+void RuleIndex::sync_bits(size_t i) noexcept
+{
+    if (i >= plain_count_) return;
+    const std::uint64_t bit = std::uint64_t{1} << (i % 64);
+    auto& active = active_bits_[i / 64];
+    auto& pending = pending_bits_[i / 64];
+    active = states_[i].active ? active | bit : active & ~bit;
+    pending = states_[i].pending >= 0 ? pending | bit : pending & ~bit;
+}
+
+void RuleIndex::set_batch_kernel(std::optional<SimdLevel> level)
+{
+    std::unique_lock lock(mutex_);
+    if (level && *level > detect_simd()) level = detect_simd();
+    simd_ = level;
+}
+
+void RuleIndex::layout_expressions(size_t first)
+{
+    expr_slots_.clear();
+    operand_windows_.clear();
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> watch; // (ряд, выражение)
+    std::vector<std::pair<std::uint32_t, WindowAggregate*>> feeds;
+    std::unordered_set<const WindowAggregate*> used;
+
+    for (size_t i = first; i < rules_.size(); ++i) {
+        const auto k = static_cast<std::uint32_t>(i - first);
+        const auto& program = expressions_.at(rules_[i].rule_id);
+        expr_slots_.push_back({&program, static_cast<std::uint32_t>(operand_windows_.size())});
+
+        for (const auto& op : program.operands()) {
+            SeriesKey series{rules_[i].gh_id, op.subtype};
+            const auto sid = intern(series);
+            auto& window = windows_.try_emplace(WindowKey{std::move(series), op.window}, op.window).first->second;
+            operand_windows_.push_back(&window);
+            watch.emplace_back(sid, k);
+            if (used.insert(&window).second) {
+                feeds.emplace_back(sid, &window);
+            }
+        }
+    }
+
+    // Окна, на которые больше не ссылается ни одно выражение
+    for (auto it = windows_.begin(); it != windows_.end();) {
+        it = used.count(&it->second) ? std::next(it) : windows_.erase(it);
+    }
+
+    std::sort(watch.begin(), watch.end());
+    watch.erase(std::unique(watch.begin(), watch.end()), watch.end());
+    std::sort(feeds.begin(), feeds.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const size_t series_count = series_keys_.size();
+    watch_begin_.assign(series_count + 1, 0);
+    watch_.clear();
+    for (const auto& [sid, k] : watch) {
+        ++watch_begin_[sid + 1];
+        watch_.push_back(k);
+    }
+    feed_begin_.assign(series_count + 1, 0);
+    feeds_.clear();
+    for (const auto& [sid, window] : feeds) {
+        ++feed_begin_[sid + 1];
+        feeds_.push_back(window);
+    }
+    for (size_t i = 1; i <= series_count; ++i) {
+        watch_begin_[i] += watch_begin_[i - 1];
+        feed_begin_[i] += feed_begin_[i - 1];
+    }
+}
+
+void RuleIndex::rebuild(const std::vector<Rule>& rules)
+{
+    std::unique_lock lock(mutex_);
+    // rules_ и states_ не очищаются: layout() перенесёт состояния;
+    // windows_ тоже остаются, чтобы не терять накопленные окна
+    compiled_.clear();
+    expressions_.clear();
+    series_ids_.clear();
+    series_keys_.clear();
+    for (const auto& r : rules) {
+        upsert_locked(r);
+    }
+    layout();
+}
+
+void RuleIndex::upsert(const Rule& rule)
+{
+    std::unique_lock lock(mutex_);
+    upsert_locked(rule);
+    layout();
+}
+
+void RuleIndex::remove(int rule_id)
+{
+    std::unique_lock lock(mutex_);
+    expressions_.erase(rule_id);
+    if (compiled_.erase(rule_id)) {
+        layout();
+    }
+}
+
+void RuleIndex::restore(const std::vector<db::RuleStateRecord>& states)
+{
+    std::unordered_map<int, const db::RuleStateRecord*> by_id;
+    by_id.reserve(states.size());
+    for (const auto& st : states) {
+        by_id.emplace(st.rule_id, &st);
+    }
+
+    std::unique_lock lock(mutex_);
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        auto it = by_id.find(rules_[i].rule_id);
+        if (it == by_id.end()) continue;
+        states_[i].active = it->second->active;
+        states_[i].since = it->second->since;
+        states_[i].pending = -1;
+        sync_bits(i);
+    }
+}
+
+void RuleIndex::on_metrics(const std::vector<Metric>& metrics, std::int64_t now, std::vector<Trigger>& out)
+{
+    std::shared_lock lock(mutex_);
+    if (rules_.empty()) return;
+
+    // states_, окна и буферы пакета под shared_lock меняет только поток
+    // IngestQueue; перестройка и advance() идут под unique_lock
+    if (++epoch_ == 0) {
+        std::fill(touched_.begin(), touched_.end(), 0);
+        epoch_ = 1;
+    }
+
+    // Ряды точек и число простых правил, которые они затрагивают
+    SeriesKey key;
+    size_t touched_rules = 0;
+    point_series_.clear();
+    for (size_t p = 0; p < metrics.size(); ++p) {
+        key.gh_id = metrics[p].gh_id;
+        key.subtype = metrics[p].subtype;
+        auto it = series_ids_.find(key);
+        const std::uint32_t sid = it == series_ids_.end() ? kNoSeries : it->second;
+        point_series_.push_back(sid);
+        if (sid == kNoSeries) continue;
+        if (touched_[sid] != epoch_) {
+            touched_[sid] = epoch_;
+            touched_rules += series_begin_[sid + 1] - series_begin_[sid];
+        }
+        last_point_[sid] = static_cast<std::uint32_t>(p);
+    }
+
+    // Пакетно проверяется последняя точка каждого ряда; более ранние точки
+    // того же ряда — поштучно и до неё, так что порядок значений сохраняется
+    const bool batched = simd_ && plain_count_ >= 64 && touched_rules * kBatchShare >= plain_count_;
+    for (size_t p = 0; p < metrics.size(); ++p) {
+        const std::uint32_t sid = point_series_[p];
+        if (sid == kNoSeries) continue;
+        if (batched && last_point_[sid] == p) {
+            latest_[sid] = metrics[p].value;
+        } else {
+            observe_plain(sid, metrics[p].value, now, out);
+        }
+        observe_expressions(sid, metrics[p].value, now, out);
+    }
+    if (batched) {
+        observe_batch(now, out);
+    }
+}
+
+void RuleIndex::observe_batch(std::int64_t now, std::vector<Trigger>& out)
+{
+    evaluate_thresholds(on_batch_, latest_.data(), match_bits_.data(), *simd_);
+    evaluate_thresholds(off_batch_, latest_.data(), release_bits_.data(), *simd_);
+
+    for (size_t w = 0; w < active_bits_.size(); ++w) {
+        // Желаемое состояние: активное держится, пока не выполнено releases(),
+        // неактивное включается по matches()
+        const std::uint64_t active = active_bits_[w];
+        const std::uint64_t want = (active & ~release_bits_[w]) | (~active & match_bits_[w]);
+        std::uint64_t candidates = (want ^ active) | pending_bits_[w];
+        while (candidates) {
+            const size_t i = w * 64 + static_cast<size_t>(std::countr_zero(candidates));
+            candidates &= candidates - 1;
+            const std::uint32_t sid = rules_[i].series;
+            if (touched_[sid] != epoch_) continue;
+
+            auto& st = states_[i];
+            if (st.observe(rules_[i], latest_[sid], now)) {
+                out.push_back({rules_[i], st.value, st.active, now});
+            }
+            sync_bits(i);
+        }
+    }
+}
+
+std::optional<std::uint32_t> RuleIndex::series_id(const SeriesKey& key) const
+{
+    std::shared_lock lock(mutex_);
+    auto it = series_ids_.find(key);
+    if (it == series_ids_.end()) return std::nullopt;
+    return it->second;
+}
+
+void RuleIndex::on_point(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger>& out)
+{
+    observe_plain(sid, value, now, out);
+    observe_expressions(sid, value, now, out);
+}
+
+void RuleIndex::observe_plain(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger>& out)
+{
+    const std::uint32_t end = series_begin_[sid + 1];
+    for (std::uint32_t i = series_begin_[sid]; i < end; ++i) {
+        auto& st = states_[i];
+        if (st.observe(rules_[i], value, now)) {
+            out.push_back({rules_[i], st.value, st.active, now});
+        }
+        sync_bits(i);
+    }
+}
+
+void RuleIndex::observe_expressions(std::uint32_t sid, double value, std::int64_t now, std::vector<Trigger>& out)
+{
+    for (std::uint32_t f = feed_begin_[sid]; f < feed_begin_[sid + 1]; ++f) {
+        feeds_[f]->push(now, value);
+    }
+    for (std::uint32_t w = watch_begin_[sid]; w < watch_begin_[sid + 1]; ++w) {
+        evaluate_expression(watch_[w], now, out);
+    }
+}
+
+void RuleIndex::evaluate_expression(std::uint32_t k, std::int64_t now, std::vector<Trigger>& out)
+{
+    const auto& slot = expr_slots_[k];
+    const auto& operands = slot.program->operands();
+
+    double values[RuleExpression::kMaxOperands];
+    for (size_t j = 0; j < operands.size(); ++j) {
+        auto* window = operand_windows_[slot.operands + j];
+        window->evict(now);
+        values[j] = window->value(operands[j].agg);
+    }
+
+    // Неизвестный результат (нет данных) состояние не меняет
+    const double result = slot.program->eval(values);
+    if (std::isnan(result)) return;
+
+    const size_t i = plain_count_ + k;
+    auto& st = states_[i];
+    if (st.observe(rules_[i], result != 0.0 ? 1.0 : 0.0, now)) {
+        out.push_back({rules_[i], st.value, st.active, now});
+    }
+}
+
+void RuleIndex::advance(std::int64_t now, std::vector<Trigger>& out)
+{
+    std::unique_lock lock(mutex_);
+    for (size_t i = 0; i < states_.size(); ++i) {
+        auto& st = states_[i];
+        if (st.pending >= 0 && st.settle(rules_[i], now)) {
+            out.push_back({rules_[i], st.value, st.active, now});
+            sync_bits(i);
+        }
+    }
+}
+
+size_t RuleIndex::size() const
+{
+    std::shared_lock lock(mutex_);
+    return compiled_.size();
+}
+
+} // namespace processor
@@ -0,0 +1,166 @@
+#include "processor/RuleReplay.hpp"
+#include "processor/RuleExpression.hpp"
+#include "utils/Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+namespace processor
+{
+
+namespace
+{
+    // Число дней от 1970-01-01 до даты григорианского календаря
+    std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) noexcept
+    {
+        y -= m <= 2;
+        const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+    }
+
+    bool digits(std::string_view s, size_t pos, size_t n, unsigned& out) noexcept
+    {
+        out = 0;
+        for (size_t i = pos; i < pos + n; ++i) {
+            const char c = s[i];
+            if (c < '0' || c > '9') return false;
+            out = out * 10 + static_cast<unsigned>(c - '0');
+        }
+        return true;
+    }
+} // namespace
+
+RuleReplay::RuleReplay(std::vector<Rule> rules, size_t max_timeline, std::int64_t tick)
+    : rules_(std::move(rules)),
+      max_timeline_(max_timeline),
+      tick_(std::max<std::int64_t>(tick, 1))
+{
+    // Проверяется, как сработало бы правило, если бы было включено
+    for (auto& r : rules_) {
+        r.enabled = true;
+    }
+    index_.rebuild(rules_);
+
+    for (const auto& r : rules_) {
+        auto c = RuleIndex::compile(r);
+        if (!c || (c->expression && !RuleExpression::compile(*r.expression))) {
+            report_.ignored.push_back(r.rule_id);
+        } else {
+            counts_[r.rule_id].rule_id = r.rule_id;
+        }
+    }
+}
+
+std::optional<std::int64_t> RuleReplay::parse_time(std::string_view ts) noexcept
+{
+    // YYYY-MM-DD HH:MM:SS, далее возможны доли секунды и пояс — не учитываются
+    if (ts.size() < 19 || ts[4] != '-' || ts[7] != '-' || (ts[10] != ' ' && ts[10] != 'T') ||
+        ts[13] != ':' || ts[16] != ':') {
+        return std::nullopt;
+    }
+    unsigned y, mo, d, h, mi, s;
+    if (!digits(ts, 0, 4, y) || !digits(ts, 5, 2, mo) || !digits(ts, 8, 2, d) ||
+        !digits(ts, 11, 2, h) || !digits(ts, 14, 2, mi) || !digits(ts, 17, 2, s)) {
+        return std::nullopt;
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60) return std::nullopt;
+    return days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+}
+
+std::string RuleReplay::format_time(std::int64_t t)
+{
+    const std::time_t tt = static_cast<std::time_t>(t);
+    std::tm tm{};
+    gmtime_r(&tt, &tm);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return oss.str();
+}
+
+std::int64_t RuleReplay::replay(db::MetricManager& metrics, int gh_id,
+                                const std::string& from_time, const std::string& to_time)
+{
+    // Типов метрик в теплице немного: ряд ищется в индексе один раз на тип
+    std::vector<std::pair<std::string, std::optional<std::uint32_t>>> subtypes;
+    SeriesKey key;
+    key.gh_id = gh_id;
+
+    const auto started = std::chrono::steady_clock::now();
+    const auto rows = metrics.scan_by_greenhouse(gh_id, from_time, to_time,
+        [&](std::string_view ts, std::string_view subtype, double value) {
+            auto it = std::find_if(subtypes.begin(), subtypes.end(),
+                                   [&](const auto& s) { return s.first == subtype; });
+            if (it == subtypes.end()) {
+                key.subtype.assign(subtype);
+                subtypes.emplace_back(key.subtype, index_.series_id(key));
+                it = std::prev(subtypes.end());
+            }
+            auto t = parse_time(ts);
+            if (!it->second || !t) {
+                ++report_.skipped;
+                return;
+            }
+            feed(*t, *it->second, value);
+        });
+    report_.eval_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    return rows;
+}
+
+bool RuleReplay::push(std::int64_t t, const SeriesKey& key, double value)
+{
+    auto sid = index_.series_id(key);
+    if (!sid) {
+        ++report_.skipped;
+        return false;
+    }
+    feed(t, *sid, value);
+    return true;
+}
+
+void RuleReplay::feed(std::int64_t t, std::uint32_t series, double value)
+{
+    if (report_.first < 0) {
+        report_.first = t;
+        // Такты advance() выровнены по tick, как у периодической проверки сервера
+        next_tick_ = (t / tick_ + 1) * tick_;
+    }
+    while (t >= next_tick_) {
+        index_.advance(next_tick_, fired_);
+        next_tick_ += tick_;
+    }
+    index_.on_point(series, value, t, fired_);
+    report_.last = t;
+    ++report_.points;
+    if (fired_.empty()) return;
+
+    for (const auto& f : fired_) {
+        auto& c = counts_[f.rule.rule_id];
+        ++(f.active ? c.on : c.off);
+        if (report_.timeline.size() < max_timeline_) {
+            report_.timeline.push_back(f);
+        } else {
+            report_.truncated = true;
+        }
+    }
+    report_.commands += fired_.size();
+    fired_.clear();
+}
+
+RuleReplay::Report RuleReplay::finish()
+{
+    report_.rules.reserve(counts_.size());
+    for (const auto& [id, c] : counts_) {
+        report_.rules.push_back(c);
+    }
+    LOG_INFO_SG("RuleReplay: {} points, {} commands, {:.1f} ms",
+                report_.points, report_.commands, report_.eval_ms);
+    return std::move(report_);
+}
+
+} // namespace processor
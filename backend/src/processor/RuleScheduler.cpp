@@ -0,0 +1,189 @@
+#include "processor/RuleScheduler.hpp"
+#include "utils/Logger.hpp"
+#include <boost/asio/post.hpp>
+#include <chrono>
+#include <ctime>
+#include <unordered_set>
+
+namespace processor
+{
+
+namespace
+{
+    std::int64_t unix_now()
+    {
+        return static_cast<std::int64_t>(std::time(nullptr));
+    }
+} // namespace
+
+RuleScheduler::RuleScheduler(boost::asio::io_context& ioc, const RulesConfig& cfg, Fire fire)
+    : ioc_(ioc),
+      cfg_(cfg),
+      fire_(std::move(fire)),
+      timer_(ioc_)
+{
+}
+
+void RuleScheduler::sync(const std::vector<Rule>& rules,
+                         const std::unordered_map<int, std::int64_t>& last_fired)
+{
+    const auto now = unix_now();
+    std::unordered_set<int> seen;
+    for (const auto& r : rules) {
+        if (r.kind != "time") continue;
+        seen.insert(r.rule_id);
+        std::int64_t last = -1;
+        auto e = entries_.find(r.rule_id);
+        if (e != entries_.end()) {
+            last = e->second.last_fired;
+        } else if (auto it = last_fired.find(r.rule_id); it != last_fired.end()) {
+            last = it->second;
+        }
+        // Догоняем пропущенное только для правил, которых ещё нет в планировщике
+        upsert(r, last, now, e == entries_.end());
+    }
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (!seen.count(it->first)) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    arm();
+    LOG_INFO_SG("RuleScheduler: {} time rules scheduled", entries_.size());
+}
+
+void RuleScheduler::post_upsert(const Rule& rule)
+{
+    boost::asio::post(ioc_, [this, rule] {
+        auto it = entries_.find(rule.rule_id);
+        upsert(rule, it != entries_.end() ? it->second.last_fired : -1, unix_now(), false);
+        arm();
+    });
+}
+
+void RuleScheduler::post_remove(int rule_id)
+{
+    boost::asio::post(ioc_, [this, rule_id] {
+        remove(rule_id);
+        arm();
+    });
+}
+
+void RuleScheduler::stop()
+{
+    boost::system::error_code ec;
+    timer_.cancel(ec);
+    armed_at_ = -1;
+}
+
+void RuleScheduler::upsert(const Rule& rule, std::int64_t last_fired, std::int64_t now, bool catch_up)
+{
+    if (rule.kind != "time" || !rule.enabled || !rule.time_spec) {
+        remove(rule.rule_id);
+        return;
+    }
+
+    auto existing = entries_.find(rule.rule_id);
+    if (existing != entries_.end() && existing->second.spec_text == *rule.time_spec) {
+        // Расписание не изменилось — достаточно обновить получателя команды
+        existing->second.rule = {rule.rule_id, rule.gh_id, rule.to_comp_id};
+        return;
+    }
+
+    std::string error;
+    auto spec = CronSpec::parse(*rule.time_spec, &error);
+    if (!spec) {
+        LOG_WARN_SG("RuleScheduler: rule {} has invalid time_spec '{}': {}",
+                    rule.rule_id, *rule.time_spec, error);
+        remove(rule.rule_id);
+        return;
+    }
+
+    Entry e{{rule.rule_id, rule.gh_id, rule.to_comp_id}, *rule.time_spec, *spec};
+    e.last_fired = last_fired;
+    auto& slot = entries_.insert_or_assign(rule.rule_id, std::move(e)).first->second;
+
+    // Пропущенное за время простоя срабатывание выполняется один раз,
+    // если опоздание не больше misfire_grace; иначе ждём следующего
+    if (catch_up && slot.last_fired >= 0) {
+        auto missed = slot.spec.next_after(slot.last_fired);
+        if (missed && *missed <= now && now - *missed <= cfg_.misfire_grace) {
+            slot.generation = ++generation_;
+            slot.next = *missed;
+            queue_.push({slot.next, rule.rule_id, slot.generation});
+            return;
+        }
+    }
+    schedule(slot, now);
+}
+
+void RuleScheduler::remove(int rule_id)
+{
+    // Запись в куче станет устаревшей: поколение больше не найдётся
+    entries_.erase(rule_id);
+}
+
+void RuleScheduler::schedule(Entry& e, std::int64_t now)
+{
+    e.generation = ++generation_;
+    auto next = e.spec.next_after(now);
+    if (!next) {
+        e.next = -1; // однократное правило уже отработало
+        return;
+    }
+    e.next = *next;
+    queue_.push({e.next, e.rule.rule_id, e.generation});
+}
+
+void RuleScheduler::arm()
+{
+    // Устаревшие записи с вершины выбрасываются сразу
+    while (!queue_.empty()) {
+        const auto& top = queue_.top();
+        auto it = entries_.find(top.rule_id);
+        if (it != entries_.end() && it->second.generation == top.generation) break;
+        queue_.pop();
+    }
+    if (queue_.empty()) {
+        stop();
+        return;
+    }
+
+    const auto at = queue_.top().at;
+    if (at == armed_at_) return;
+    armed_at_ = at;
+    timer_.expires_at(std::chrono::system_clock::from_time_t(static_cast<std::time_t>(at)));
+    timer_.async_wait([this](const boost::system::error_code& ec) { on_timer(ec); });
+}
+
+void RuleScheduler::on_timer(const boost::system::error_code& ec)
+{
+    if (ec == boost::asio::error::operation_aborted) return;
+    if (ec) {
+        LOG_ERROR_SG("RuleScheduler: timer error: {}", ec.message());
+        return;
+    }
+    armed_at_ = -1;
+
+    const auto now = unix_now();
+    while (!queue_.empty() && queue_.top().at <= now) {
+        const auto due = queue_.top();
+        queue_.pop();
+        auto it = entries_.find(due.rule_id);
+        if (it == entries_.end() || it->second.generation != due.generation) continue;
+
+        auto& e = it->second;
+        e.last_fired = due.at;
+        try {
+            fire_(e.rule, due.at);
+        } catch (const std::exception& ex) {
+            LOG_ERROR_SG("RuleScheduler: rule {} failed: {}", e.rule.rule_id, ex.what());
+        }
+        // Если обработка задержалась, промежуточные срабатывания не догоняем
+        schedule(e, std::max(due.at, now));
+    }
+    arm();
+}
+
+} // namespace processor
@@ -1,10 +1,19 @@
 #include "processor/ServerProcessor.hpp"
 #include "db/Database.hpp"
+#include "processor/ActuatorStateCache.hpp"
+#include "processor/CommandTracker.hpp"
+#include "processor/IngestQueue.hpp"
+#include "processor/LiveMetricCache.hpp"
+#include "processor/MetricDecoder.hpp"
+#include "processor/RuleEngineStats.hpp"
+#include "processor/RuleIndex.hpp"
+#include <boost/asio/post.hpp>
 #include <nlohmann/json.hpp>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
 #include <cctype>
+#include <future>
+#include <map>
+#include <thread>
 
 using namespace std::chrono;
 using json = nlohmann::json;
@@ -12,6 +21,15 @@ using json = nlohmann::json;
 namespace processor
 {
 
+namespace
+{
+    // Запись группы метрик повторяется: сбой обычно временный (SQLITE_BUSY, диск)
+    constexpr int kStoreAttempts = 3;
+    constexpr auto kStoreRetryInitial = milliseconds(100);
+    // Сколько shutdown() ждёт срабатываний правил, поставленных в io_context
+    constexpr auto kShutdownDrain = seconds(5);
+} // namespace
+
 ServerProcessor::ServerProcessor(boost::asio::io_context& ioc,
                                  const Config& cfg)
     : ioc_(ioc),
@@ -28,6 +46,8 @@ void ServerProcessor::initialize()
     }
 
     setupManagers();
+    setupRules();
+    setupIngest();
     setupMQTT();
     initialized_ = true;
 }
@@ -38,7 +58,12 @@ void ServerProcessor::start()
         throw std::runtime_error("ServerProcessor: not initialized");
     }
 
+    outbox_->start();
     mqttClient_->start();
+    if (cfg_.ingest.udp.enabled) {
+        udpListener_ = std::make_unique<UdpIngestListener>(ioc_, cfg_.ingest.udp);
+        udpListener_->start();
+    }
     scheduleRuleCheck();
 }
 
@@ -46,13 +71,126 @@ void ServerProcessor::shutdown()
 {
     boost::system::error_code ec;
     ruleTimer_.cancel(ec);
+    boost::asio::post(ioc_, [this] { ruleScheduler_->stop(); });
+    // Недоставленные команды остаются в БД и уйдут после перезапуска
+    outbox_->stop();
+    if (udpListener_) {
+        // Сокет обслуживается потоком io_context — закрываем его там же
+        boost::asio::post(ioc_, [this] { udpListener_->stop(); });
+    }
     mqttClient_->stop();
+    IngestQueue::instance().stop();
+
+    // Срабатывания последних групп приёма ещё в очереди io_context: ждём их,
+    // чтобы состояния правил и команды попали в БД до остановки
+    auto drained = std::make_shared<std::promise<void>>();
+    auto done = drained->get_future();
+    boost::asio::post(ioc_, [drained] { drained->set_value(); });
+    if (done.wait_for(kShutdownDrain) != std::future_status::ready) {
+        LOG_WARN_SG("ServerProcessor: rule fires still pending at shutdown");
+    }
 }
 
 void ServerProcessor::setupManagers()
 {
     metricMgr_ = std::make_unique<db::MetricManager>();
     ruleMgr_   = std::make_unique<db::RuleManager>();
+    ingestStateMgr_ = std::make_unique<db::IngestStateManager>();
+    outboxMgr_ = std::make_unique<db::CommandOutboxManager>();
+}
+
+void ServerProcessor::setupRules()
+{
+    ActuatorStateCache::instance().set_window(cfg_.rules.duplicate_window);
+    CommandTracker::instance().set_timeout(std::chrono::seconds(cfg_.rules.ack_timeout));
+    ruleScheduler_ = std::make_unique<RuleScheduler>(
+        ioc_, cfg_.rules,
+        [this](const ScheduledRule& rule, std::int64_t at) { fireTimeRule(rule, at); });
+
+    const auto rules = ruleMgr_->get_active_rules();
+    RuleIndex::instance().rebuild(rules);
+    RuleIndex::instance().restore(ruleMgr_->get_rule_states());
+    ruleScheduler_->sync(rules, ruleMgr_->get_last_fired());
+
+    // Изменения через REST применяются точечно, без перечитывания всех правил
+    db::RuleManager::add_change_listener([this](int rule_id, const std::optional<Rule>& rule) {
+        if (rule) {
+            RuleIndex::instance().upsert(*rule);
+            ruleScheduler_->post_upsert(*rule);
+        } else {
+            RuleIndex::instance().remove(rule_id);
+            ruleScheduler_->post_remove(rule_id);
+        }
+    });
+    LOG_INFO_SG("ServerProcessor: {} threshold rules indexed, {} time rules scheduled",
+                RuleIndex::instance().size(), ruleScheduler_->size());
+}
+
+void ServerProcessor::setupIngest()
+{
+    ingestFilter_ = std::make_unique<IngestFilter>(cfg_.ingest.filters);
+    ingestDedup_ = std::make_unique<IngestDedup>(cfg_.ingest.dedup);
+    if (cfg_.ingest.dedup.enabled) {
+        ingestDedup_->load(ingestStateMgr_->load_watermarks());
+    }
+    IngestQueue::instance().start(
+        cfg_.ingest,
+        // Повторные доставки отбрасываются сразу; остальные точки попадают
+        // в live-кэш, в БД — только прошедшие фильтры, одной транзакцией
+        // на накопленную группу
+        [this](std::vector<Metric>& metrics) {
+            ingestDedup_->apply(metrics);
+            LiveMetricCache::instance().update(metrics);
+            onMetricsAccepted(metrics);
+            ingestFilter_->apply(metrics);
+            if (!storeMetrics(metrics)) {
+                // Группа потеряна. Откат окон пропустит её, если отправитель
+                // повторит те же seq (HTTP-клиент после ошибки, датчик после
+                // переподключения), — иначе повтор был бы отброшен как дубликат;
+                // откат фильтра — иначе как уже сохранённый (deadband, min_interval)
+                ingestDedup_->rollback();
+                ingestFilter_->rollback();
+                return false;
+            }
+            ingestFilter_->commit();
+            // Отметки сохраняются после метрик: при сбое между записями
+            // возможен повтор, но не потеря точки
+            watermarks_.clear();
+            ingestDedup_->commit(watermarks_);
+            if (!ingestStateMgr_->save_watermarks(watermarks_)) {
+                LOG_WARN_SG("ServerProcessor: failed to persist {} ingest watermarks",
+                            watermarks_.size());
+            }
+            return true;
+        });
+}
+
+bool ServerProcessor::storeMetrics(const std::vector<Metric>& metrics)
+{
+    auto pause = kStoreRetryInitial;
+    for (int attempt = 1;; ++attempt) {
+        if (metricMgr_->create_batch(metrics)) return true;
+        if (attempt == kStoreAttempts) return false;
+        LOG_WARN_SG("ServerProcessor: failed to store {} metrics, retry {} of {} in {} ms",
+                    metrics.size(), attempt, kStoreAttempts - 1, pause.count());
+        // Поток очереди приёма ждёт: новые точки тем временем копятся в очереди
+        std::this_thread::sleep_for(pause);
+        pause *= 2;
+    }
+}
+
+void ServerProcessor::onMetricsAccepted(const std::vector<Metric>& metrics)
+{
+    std::vector<RuleIndex::Trigger> triggers;
+    std::lock_guard<std::mutex> lock(fireOrderMutex_);
+    RuleIndex::instance().on_metrics(metrics, system_clock::to_time_t(system_clock::now()), triggers);
+    postThresholdFires(std::move(triggers));
+}
+
+void ServerProcessor::postThresholdFires(std::vector<RuleIndex::Trigger>&& triggers)
+{
+    if (triggers.empty()) return;
+    boost::asio::post(ioc_, [this, triggers = std::move(triggers)] { fireThresholdRules(triggers); });
 }
 
 void ServerProcessor::setupMQTT()
@@ -60,41 +198,100 @@ void ServerProcessor::setupMQTT()
     mqttClient_ = std::make_unique<MQTTClient>(
         ioc_,
         cfg_.mqtt,
-        // MetricsHandler: парсинг и сохранение метрик в БД
-        [&](const std::string& gh, const std::string& payload) {
+        // MetricsHandler: декодирование и постановка метрик в очередь записи
+        [](const std::string& gh, const std::string& payload, const std::string& content_type) {
+            int gh_id = -1;
             try {
-                // Проверка валидности JSON перед парсингом
-                if (isValidJson(payload)) {
-                    auto j = json::parse(payload);
-                    std::vector<Metric> metrics;
-                    
-                    if (j.is_array()) {
-                        for (auto &item : j) {
-                            if (item.is_object() && item.contains("sensor_id") && item.contains("value")) {
-                                Metric m = item.get<Metric>();
-                                metrics.push_back(m);
-                            }
-                        }
-                    } else if (j.is_object() && j.contains("sensor_id") && j.contains("value")) {
-                        Metric m = j.get<Metric>();
-                        metrics.push_back(m);
-                    }
-                    
-                    if (!metrics.empty()) {
-                        if (!metricMgr_->create_batch(metrics)) {
-                            std::cerr << "Failed to batch insert metrics for GH " << gh << std::endl;
-                        }
-                    }
-                } else {
-                    std::cerr << "Invalid JSON payload for GH " << gh << ": " << payload << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing metrics payload for GH " << gh
-                          << ": " << e.what() << std::endl;
+                gh_id = std::stoi(gh);
+            } catch (const std::exception&) {
+                // gh_id может прийти в самих записях
+            }
+
+            auto res = MetricDecoder::decode(
+                payload, MetricDecoder::detect(content_type, payload), gh_id);
+            // Поток испорченных сообщений не должен забить журнал: не больше 10 строк в минуту на место
+            if (res.malformed) {
+                LOG_WARN_LIMIT_SG(10, 60, "ServerProcessor: invalid metrics payload for GH {} ({} bytes): {}",
+                                  gh, payload.size(), std::string_view(payload).substr(0, 256));
+                return;
+            }
+            if (res.rejected) {
+                LOG_WARN_LIMIT_SG(10, 60, "ServerProcessor: rejected {} invalid metrics for GH {}", res.rejected, gh);
+            }
+            if (!res.metrics.empty() && !IngestQueue::instance().push(std::move(res.metrics))) {
+                LOG_ERROR_LIMIT_SG(10, 60, "ServerProcessor: ingest queue stopped, dropping metrics for GH {}", gh);
             }
         },
         nullptr
     );
+
+    // Состояние, сообщённое устройством, — в кэш состояний
+    mqttClient_->add_topic_handler("state", [](const std::string& gh, const std::string& payload) {
+        try {
+            const auto j = json::parse(payload);
+            const int comp_id = j.contains("comp_id") ? j.at("comp_id").get<int>()
+                                                      : j.at("to_component").get<int>();
+            ActuatorStateCache::instance().report(std::stoi(gh), comp_id, j.at("state").get<std::string>(),
+                                                  system_clock::to_time_t(system_clock::now()));
+        } catch (const std::exception& e) {
+            LOG_WARN_LIMIT_SG(10, 60, "ServerProcessor: invalid state payload for GH {}: {}", gh, e.what());
+        }
+    });
+
+    // Подтверждение команды устройством: {"cid": "...", "status": "ok" | "error"};
+    // comp_id и state в подтверждении — заодно и новое состояние устройства
+    const bool acks = mqttClient_->add_topic_handler("ack", [](const std::string& gh, const std::string& payload) {
+        try {
+            const auto j = json::parse(payload);
+            const bool ok = j.value("status", std::string("ok")) != "error";
+            CommandTracker::instance().ack(j.at("cid").get<std::string>(), ok);
+            if (ok && j.contains("comp_id") && j.contains("state")) {
+                ActuatorStateCache::instance().report(std::stoi(gh), j.at("comp_id").get<int>(),
+                                                      j.at("state").get<std::string>(),
+                                                      system_clock::to_time_t(system_clock::now()));
+            }
+        } catch (const std::exception& e) {
+            LOG_WARN_LIMIT_SG(10, 60, "ServerProcessor: invalid ack payload for GH {}: {}", gh, e.what());
+        }
+    });
+    if (!acks) {
+        LOG_INFO_SG("ServerProcessor: mqtt.topics.ack is not set, command acks are not tracked");
+    }
+
+    outbox_ = std::make_unique<CommandOutbox>(
+        ioc_, cfg_.outbox, *outboxMgr_,
+        [this](std::vector<CommandOutbox::Publish> batch) {
+            std::vector<MQTTClient::OutgoingCommand> commands;
+            commands.reserve(batch.size());
+            for (auto& p : batch) {
+                MQTTClient::OutgoingCommand c;
+                // Тип задаёт срок годности в буфере без связи; новая команда
+                // тому же устройству заменяет в нём прежнюю, повтор команды
+                // очереди — свою копию (ключ есть у каждой, иначе она не буферизуется)
+                const auto j = json::parse(p.payload, nullptr, false);
+                if (j.is_object()) {
+                    c.type = j.value("type", std::string());
+                    if (j.contains("to_component")) {
+                        c.replaces = "comp:" + j["to_component"].dump();
+                    }
+                }
+                if (c.replaces.empty()) {
+                    c.replaces = "outbox:" + std::to_string(p.key);
+                }
+                c.gh_id = std::to_string(p.gh_id);
+                c.command = std::move(p.payload);
+                c.created = p.enqueued_at;
+                c.done = [done = std::move(p.done)](MQTTClient::Delivery result) {
+                    done(result == MQTTClient::Delivery::Delivered ? CommandOutbox::Result::Delivered
+                         : result == MQTTClient::Delivery::Expired ? CommandOutbox::Result::Expired
+                                                                   : CommandOutbox::Result::Failed);
+                };
+                commands.push_back(std::move(c));
+            }
+            mqttClient_->publish_commands(std::move(commands));
+        });
+    // Очередь, ждущая паузы после обрыва, отправляется сразу по подключении
+    mqttClient_->set_connected_handler([this] { outbox_->resume(); });
 }
 
 void ServerProcessor::scheduleRuleCheck()
@@ -118,138 +315,114 @@ void ServerProcessor::onRuleCheck(const boost::system::error_code& ec)
 
 void ServerProcessor::processActiveRules()
 {
-    auto rules = ruleMgr_->get_active_rules();
-    for (const auto& rule : rules) {
-        evaluateRule(rule);
-    }
-}
-
-void ServerProcessor::evaluateRule(const Rule& rule)
-{
-    try {
-        auto now = system_clock::now();
-        
-        if (rule.kind == "time" && rule.time_spec) {
-            std::istringstream spec_ss(*rule.time_spec);
-            std::tm spec_tm{};
-            bool triggered = false;
-            
-            // Проверяем, содержит ли спецификация дату
-            bool has_date = (rule.time_spec->find('-') != std::string::npos);
-            
-            if (has_date) {
-                // Обработка точного времени с датой
-                spec_ss >> std::get_time(&spec_tm, "%Y-%m-%d %H:%M:%S");
-                if (spec_ss.fail()) {
-                    throw std::runtime_error("Invalid date-time format: " + *rule.time_spec);
-                }
-                
-                auto spec_time = system_clock::from_time_t(std::mktime(&spec_tm));
-                auto time_diff = now - spec_time;
-                
-                // Срабатываем, если текущее время позже указанного,
-                // но не более чем на 2 интервала проверки
-                if (time_diff >= 0s && time_diff < 2 * ruleInterval_) {
-                    triggered = true;
-                }
-            } else {
-                // Обработка ежедневного времени (только часы и минуты)
-                // Парсим время в формате HH:MM, игнорируя секунды
-                spec_ss >> std::get_time(&spec_tm, "%H:%M");
-                
-                // Если формат содержит секунды, пропускаем их
-                if (spec_ss.fail() && rule.time_spec->size() > 5) {
-                    spec_ss.clear();
-                    std::string time_str = rule.time_spec->substr(0, 5);
-                    spec_ss.str(time_str);
-                    spec_ss >> std::get_time(&spec_tm, "%H:%M");
-                }
-                
-                if (spec_ss.fail()) {
-                    throw std::runtime_error("Invalid time format: " + *rule.time_spec);
-                }
-                
-                time_t now_time_t = system_clock::to_time_t(now);
-                std::tm now_tm;
-                localtime_r(&now_time_t, &now_tm);
-                
-                // Сравниваем только часы и минуты, игнорируя секунды
-                if (now_tm.tm_hour == spec_tm.tm_hour &&
-                    now_tm.tm_min == spec_tm.tm_min) {
-                    triggered = true;
-                }
-            }
-            
-            if (triggered) {
-                json cmd = { 
-                    {"rule_id", rule.rule_id}, 
-                    {"to_component", rule.to_comp_id}, 
-                    {"type", "time"} 
-                };
-                sendCommand(rule.gh_id, cmd.dump());
-            }
-        } else if (rule.kind == "threshold" && rule.threshold && rule.operator_) {
-            auto subtype = std::to_string(rule.from_comp_id);
-            auto metric_opt = metricMgr_->get_latest_by_greenhouse_and_subtype(rule.gh_id, subtype);
-            
-            if (metric_opt) {
-                double value = metric_opt->value;
-                double th = *rule.threshold;
-                bool cond = false;
-                const auto& op = *rule.operator_;
-                
-                if      (op == ">" ) cond = (value >  th);
-                else if (op == "<" ) cond = (value <  th);
-                else if (op == ">=") cond = (value >= th);
-                else if (op == "<=") cond = (value <= th);
-                else if (op == "==") cond = (value == th);
-                else if (op == "!=") cond = (value != th);
-                
-                if (cond) {
-                    json cmd = { 
-                        {"rule_id", rule.rule_id}, 
-                        {"to_component", rule.to_comp_id}, 
-                        {"type", "threshold"}, 
-                        {"value", value} 
-                    };
-                    sendCommand(rule.gh_id, cmd.dump());
-                }
-            }
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error evaluating rule " << rule.rule_id << ": " << e.what() << std::endl;
+    const auto started = steady_clock::now();
+
+    // Каскадное удаление правил вместе с компонентами проходит мимо RuleManager,
+    // поэтому индекс и расписание периодически сверяются с БД целиком
+    if (++ruleTicks_ % kRuleResyncTicks == 0) {
+        const auto rules = ruleMgr_->get_active_rules();
+        RuleIndex::instance().rebuild(rules);
+        ruleScheduler_->sync(rules, {});
+    }
+
+    // Смены состояния, дождавшиеся debounce или min_dwell без новых метрик
+    // Ставятся в очередь io_context за срабатываниями, уже отправленными
+    // потоком приёма, — в порядке смен состояния
+    {
+        std::vector<RuleIndex::Trigger> settled;
+        std::lock_guard<std::mutex> lock(fireOrderMutex_);
+        RuleIndex::instance().advance(system_clock::to_time_t(system_clock::now()), settled);
+        postThresholdFires(std::move(settled));
+    }
+
+    // Команды, на которые устройства не ответили за ack_timeout
+    CommandTracker::instance().sweep();
+
+    RuleEngineStats::record_tick(duration<double, std::milli>(steady_clock::now() - started).count());
+}
+
+void ServerProcessor::fireTimeRule(const ScheduledRule& rule, std::int64_t at)
+{
+    // Срабатывание фиксируется до постановки команды: после перезапуска
+    // правило не сработает повторно, а команду доставит очередь из БД
+    if (!ruleMgr_->record_fired(rule.rule_id, at)) {
+        LOG_WARN_SG("ServerProcessor: failed to persist fire time of rule {}", rule.rule_id);
     }
+
+    // Результат команды по расписанию неизвестен — следующая пороговая
+    // команда этому устройству не будет подавлена
+    ActuatorStateCache::instance().command(rule.gh_id, rule.to_comp_id, "", rule.rule_id,
+                                           system_clock::to_time_t(system_clock::now()));
+    json cmd = {
+        {"cid", CommandTracker::instance().track(rule.gh_id, rule.to_comp_id, rule.rule_id)},
+        {"rule_id", rule.rule_id},
+        {"to_component", rule.to_comp_id},
+        {"type", "time"}
+    };
+    outbox_->enqueue({{rule.gh_id, cmd.dump()}});
 }
 
-void ServerProcessor::sendCommand(int gh_id, const std::string& command_json)
+void ServerProcessor::fireThresholdRules(const std::vector<RuleIndex::Trigger>& triggers)
 {
-    try {
-        mqttClient_->publish_command(std::to_string(gh_id), command_json);
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to send command for GH " << gh_id << ": " << e.what() << std::endl;
+    // Разделы по теплицам; внутри теплицы порядок смен состояния сохраняется.
+    // Время каждого раздела идёт в RuleEngineStats
+    std::map<int, std::vector<const RuleIndex::Trigger*>> partitions;
+    for (const auto& t : triggers) {
+        partitions[t.rule.gh_id].push_back(&t);
+    }
+
+    const auto started = steady_clock::now();
+    int slowest_gh = -1;
+    double slowest_ms = 0.0;
+    for (const auto& [gh_id, partition] : partitions) {
+        const auto partition_started = steady_clock::now();
+        fireGreenhouse(partition);
+        const double ms = duration<double, std::milli>(steady_clock::now() - partition_started).count();
+        if (ms >= slowest_ms) {
+            slowest_ms = ms;
+            slowest_gh = gh_id;
+        }
     }
+    RuleEngineStats::record_batch(duration<double, std::milli>(steady_clock::now() - started).count(),
+                                  partitions.size(), triggers.size(), slowest_gh, slowest_ms);
 }
 
-bool ServerProcessor::isValidJson(const std::string& str) const
+void ServerProcessor::fireGreenhouse(const std::vector<const RuleIndex::Trigger*>& triggers)
 {
-    // Быстрая проверка перед полным парсингом
-    if (str.empty()) return false;
-    
-    // Проверяем, что строка начинается и заканчивается правильными символами
-    const char first = str.front();
-    const char last = str.back();
-    
-    if ((first == '{' && last == '}') || 
-        (first == '[' && last == ']')) {
-        return true;
+    // Состояния сохраняются до постановки команд: после перезапуска правило
+    // не сработает повторно (как и правила по расписанию)
+    std::vector<db::RuleStateRecord> states;
+    states.reserve(triggers.size());
+    for (const auto* t : triggers) {
+        states.push_back({t->rule.rule_id, t->active, t->at});
+    }
+    if (!ruleMgr_->save_rule_states(states)) {
+        LOG_WARN_SG("ServerProcessor: failed to persist {} rule states", states.size());
+    }
+
+    // Команды ставятся в очередь одной транзакцией в порядке срабатываний;
+    // повтор уже установленного состояния устройства не отправляется
+    const auto now = system_clock::to_time_t(system_clock::now());
+    auto& actuators = ActuatorStateCache::instance();
+    auto& tracker = CommandTracker::instance();
+    std::vector<CommandOutbox::Command> commands;
+    commands.reserve(triggers.size());
+    for (const auto* t : triggers) {
+        const char* state = t->active ? "on" : "off";
+        if (!actuators.command(t->rule.gh_id, t->rule.to_comp_id, state, t->rule.rule_id, now)) {
+            continue;
+        }
+        json cmd = {
+            {"cid", tracker.track(t->rule.gh_id, t->rule.to_comp_id, t->rule.rule_id)},
+            {"rule_id", t->rule.rule_id},
+            {"to_component", t->rule.to_comp_id},
+            {"type", "threshold"},
+            {"state", state},
+            {"value", t->value}
+        };
+        commands.emplace_back(t->rule.gh_id, cmd.dump());
     }
-    
-    // Дополнительная проверка для коротких JSON
-    if (str.size() < 2) return false;
-    
-    // Проверяем наличие основных JSON-символов
-    return (str.find(':') != std::string::npos) && 
-           (str.find('"') != std::string::npos);
+    outbox_->enqueue(std::move(commands));
 }
 
 } // namespace processor
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "processor/ThresholdKernel.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SG_THRESHOLD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace processor
+{
+
+void ThresholdBatch::clear()
+{
+    series.clear();
+    lo.clear();
+    hi.clear();
+    invert.clear();
+}
+
+void ThresholdBatch::push(std::uint32_t sid, double lo_bound, double hi_bound, bool inverted)
+{
+    const size_t i = series.size();
+    if (i % 64 == 0) invert.push_back(0);
+    if (inverted) invert.back() |= std::uint64_t{1} << (i % 64);
+    series.push_back(sid);
+    lo.push_back(lo_bound);
+    hi.push_back(hi_bound);
+}
+
+namespace
+{
+    // Биты [first, last) слова, без инверсии
+    std::uint64_t word_scalar(const ThresholdBatch& b, const double* values, size_t first, size_t last) noexcept
+    {
+        std::uint64_t bits = 0;
+        for (size_t i = first; i < last; ++i) {
+            const double v = values[b.series[i]];
+            bits |= static_cast<std::uint64_t>((v >= b.lo[i]) & (v <= b.hi[i])) << (i - first);
+        }
+        return bits;
+    }
+
+#ifdef SG_THRESHOLD_X86
+    std::uint64_t word_sse2(const ThresholdBatch& b, const double* values, size_t first) noexcept
+    {
+        const std::uint32_t* s = b.series.data() + first;
+        const double* lo = b.lo.data() + first;
+        const double* hi = b.hi.data() + first;
+        std::uint64_t bits = 0;
+        for (unsigned k = 0; k < 64; k += 2) {
+            const __m128d v = _mm_set_pd(values[s[k + 1]], values[s[k]]);
+            const __m128d in = _mm_and_pd(_mm_cmpge_pd(v, _mm_loadu_pd(lo + k)),
+                                          _mm_cmple_pd(v, _mm_loadu_pd(hi + k)));
+            bits |= static_cast<std::uint64_t>(_mm_movemask_pd(in)) << k;
+        }
+        return bits;
+    }
+
+    __attribute__((target("avx2")))
+    std::uint64_t word_avx2(const ThresholdBatch& b, const double* values, size_t first) noexcept
+    {
+        const std::uint32_t* s = b.series.data() + first;
+        const double* lo = b.lo.data() + first;
+        const double* hi = b.hi.data() + first;
+        std::uint64_t bits = 0;
+        for (unsigned k = 0; k < 64; k += 4) {
+            const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k));
+            const __m256d v = _mm256_i32gather_pd(values, idx, 8);
+            const __m256d in = _mm256_and_pd(_mm256_cmp_pd(v, _mm256_loadu_pd(lo + k), _CMP_GE_OQ),
+                                             _mm256_cmp_pd(v, _mm256_loadu_pd(hi + k), _CMP_LE_OQ));
+            bits |= static_cast<std::uint64_t>(_mm256_movemask_pd(in)) << k;
+        }
+        return bits;
+    }
+#endif
+} // namespace
+
+SimdLevel detect_simd() noexcept
+{
+#ifdef SG_THRESHOLD_X86
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    return SimdLevel::SSE2; // входит в базовый x86-64
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simd_name(SimdLevel level) noexcept
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    }
+    return "unknown";
+}
+
+void evaluate_thresholds(const ThresholdBatch& batch, const double* values,
+                         std::uint64_t* out, SimdLevel level) noexcept
+{
+    const size_t n = batch.size();
+    const size_t full = n / 64;
+
+    for (size_t w = 0; w < full; ++w) {
+        std::uint64_t bits;
+        switch (level)
+        {
+#ifdef SG_THRESHOLD_X86
+        case SimdLevel::AVX2: bits = word_avx2(batch, values, w * 64); break;
+        case SimdLevel::SSE2: bits = word_sse2(batch, values, w * 64); break;
+#endif
+        default: bits = word_scalar(batch, values, w * 64, w * 64 + 64); break;
+        }
+        out[w] = bits ^ batch.invert[w];
+    }
+    // Неполное последнее слово
+    if (n % 64) {
+        out[full] = word_scalar(batch, values, full * 64, n) ^ batch.invert[full];
+    }
+}
+
+} // namespace processor
@@ -0,0 +1,281 @@
+#include "processor/UdpIngestListener.hpp"
+#include "processor/IngestQueue.hpp"
+#include "processor/MetricDecoder.hpp"
+#include "db/Database.hpp"
+#include "utils/Logger.hpp"
+#include <boost/asio/ip/address.hpp>
+#include <charconv>
+
+namespace processor
+{
+
+namespace
+{
+    /// Отделяет от строки фрагмент до разделителя (сам разделитель отбрасывается)
+    std::string_view next_token(std::string_view &s, char sep)
+    {
+        auto p = s.find(sep);
+        auto tok = s.substr(0, p);
+        s = p == std::string_view::npos ? std::string_view{} : s.substr(p + 1);
+        return tok;
+    }
+
+    bool parse_double(std::string_view s, double &out)
+    {
+        if (!s.empty() && (s.back() == 'i' || s.back() == 'u')) s.remove_suffix(1);
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc{} && ptr == s.data() + s.size();
+    }
+
+    template <typename T>
+    bool parse_int(std::string_view s, T &out)
+    {
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc{} && ptr == s.data() + s.size();
+    }
+} // namespace
+
+UdpIngestListener::Counters& UdpIngestListener::counters()
+{
+    static Counters c;
+    return c;
+}
+
+UdpIngestListener::Stats UdpIngestListener::stats()
+{
+    auto& c = counters();
+    Stats s;
+    s.datagrams = c.datagrams.load(std::memory_order_relaxed);
+    s.truncated_datagrams = c.truncated_datagrams.load(std::memory_order_relaxed);
+    s.malformed_datagrams = c.malformed_datagrams.load(std::memory_order_relaxed);
+    s.malformed_lines = c.malformed_lines.load(std::memory_order_relaxed);
+    s.points = c.points.load(std::memory_order_relaxed);
+    s.dropped_points = c.dropped_points.load(std::memory_order_relaxed);
+    return s;
+}
+
+UdpIngestListener::UdpIngestListener(boost::asio::io_context& ioc, const UdpIngestConfig& cfg)
+    : ioc_(ioc),
+      cfg_(cfg),
+      socket_(ioc_),
+      buffer_(cfg_.batch * cfg_.datagram_size)
+{
+    if      (cfg_.precision == "s")  divisor_ = 1;
+    else if (cfg_.precision == "us") divisor_ = 1000000;
+    else if (cfg_.precision == "ns") divisor_ = 1000000000;
+    else                             divisor_ = 1000;
+
+#ifdef __linux__
+    msgs_.resize(cfg_.batch);
+    iovs_.resize(cfg_.batch);
+    for (size_t i = 0; i < cfg_.batch; ++i) {
+        iovs_[i].iov_base = buffer_.data() + i * cfg_.datagram_size;
+        iovs_[i].iov_len = cfg_.datagram_size;
+        msgs_[i] = {};
+        msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+UdpIngestListener::~UdpIngestListener()
+{
+    stop();
+}
+
+void UdpIngestListener::start()
+{
+    namespace ip = boost::asio::ip;
+    ip::udp::endpoint ep(ip::make_address(cfg_.bind), static_cast<unsigned short>(cfg_.port));
+
+    socket_.open(ep.protocol());
+    socket_.set_option(boost::asio::socket_base::reuse_address(true));
+    socket_.set_option(boost::asio::socket_base::receive_buffer_size(cfg_.recv_buffer));
+    socket_.bind(ep);
+    socket_.non_blocking(true);
+
+    LOG_INFO_SG("UdpIngestListener: listening on {}:{}", cfg_.bind, cfg_.port);
+    wait_readable();
+}
+
+void UdpIngestListener::stop()
+{
+    boost::system::error_code ec;
+    if (socket_.is_open()) {
+        socket_.close(ec);
+    }
+}
+
+void UdpIngestListener::wait_readable()
+{
+    socket_.async_wait(boost::asio::socket_base::wait_read,
+        [this](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted) return;
+            if (ec) {
+                LOG_ERROR_SG("UdpIngestListener: wait error: {}", ec.message());
+                return;
+            }
+            drain();
+            wait_readable();
+        });
+}
+
+void UdpIngestListener::drain()
+{
+    now_ts_ = db::Database::get_current_timestamp();
+
+    // Вычитываем всё, что накопилось в сокете, но не больше нескольких пачек,
+    // чтобы не задерживать остальные обработчики io_context
+    for (int round = 0; round < 16; ++round) {
+        size_t received = 0;
+#ifdef __linux__
+        for (size_t i = 0; i < msgs_.size(); ++i) {
+            msgs_[i].msg_hdr.msg_flags = 0;
+            msgs_[i].msg_len = 0;
+        }
+        int n = ::recvmmsg(socket_.native_handle(), msgs_.data(),
+                           static_cast<unsigned int>(msgs_.size()), MSG_DONTWAIT, nullptr);
+        if (n <= 0) break;
+        received = static_cast<size_t>(n);
+        for (size_t i = 0; i < received; ++i) {
+            std::string_view dg(static_cast<const char*>(iovs_[i].iov_base), msgs_[i].msg_len);
+            handle_datagram(dg, (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0);
+        }
+#else
+        boost::asio::ip::udp::endpoint from;
+        boost::system::error_code ec;
+        for (; received < cfg_.batch; ++received) {
+            size_t len = socket_.receive_from(
+                boost::asio::buffer(buffer_.data(), cfg_.datagram_size), from, 0, ec);
+            if (ec) break;
+            handle_datagram(std::string_view(buffer_.data(), len), false);
+        }
+        if (received == 0) break;
+#endif
+        if (!pending_.empty()) {
+            const auto n_points = pending_.size();
+            counters().points.fetch_add(n_points, std::memory_order_relaxed);
+            if (!IngestQueue::instance().try_push(std::move(pending_))) {
+                counters().dropped_points.fetch_add(n_points, std::memory_order_relaxed);
+            }
+            pending_.clear();
+        }
+        if (received < cfg_.batch) break;
+    }
+}
+
+void UdpIngestListener::handle_datagram(std::string_view datagram, bool truncated)
+{
+    auto& c = counters();
+    c.datagrams.fetch_add(1, std::memory_order_relaxed);
+    if (truncated) {
+        // Обрезанная датаграмма почти наверняка заканчивается на половине строки
+        c.truncated_datagrams.fetch_add(1, std::memory_order_relaxed);
+        c.malformed_datagrams.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto before = pending_.size();
+    const auto bad = parse_datagram(datagram, pending_);
+    if (bad) {
+        c.malformed_lines.fetch_add(bad, std::memory_order_relaxed);
+        if (pending_.size() == before) {
+            c.malformed_datagrams.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t UdpIngestListener::parse_datagram(std::string_view datagram, std::vector<Metric>& out)
+{
+    if (now_ts_.empty()) {
+        now_ts_ = db::Database::get_current_timestamp();
+    }
+    size_t bad = 0;
+    while (!datagram.empty()) {
+        auto line = next_token(datagram, '\n');
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+        if (!parse_line(line, out)) ++bad;
+    }
+    return bad;
+}
+
+bool UdpIngestListener::parse_line(std::string_view line, std::vector<Metric>& out)
+{
+    auto tags = next_token(line, ' ');
+    auto fields = next_token(line, ' ');
+    auto ts_part = line;
+    if (tags.empty() || fields.empty()) return false;
+
+    int gh_id = -1;
+    std::int64_t seq = -1;
+    std::string_view subtype;
+    bool first = true;
+    while (!tags.empty()) {
+        auto tag = next_token(tags, ',');
+        auto eq = tag.find('=');
+        if (eq == std::string_view::npos) {
+            // Имя measurement допускается только первым и не используется
+            if (!first) return false;
+        } else {
+            auto key = tag.substr(0, eq);
+            auto val = tag.substr(eq + 1);
+            if (key == "gh" || key == "gh_id") {
+                if (!parse_int(val, gh_id)) return false;
+            } else if (key == "subtype") {
+                subtype = val;
+            } else if (key == "seq") {
+                if (!parse_int(val, seq) || seq < 0) return false;
+            }
+        }
+        first = false;
+    }
+    if (gh_id <= 0) return false;
+
+    const std::string* ts = &now_ts_;
+    if (!ts_part.empty()) {
+        std::int64_t raw = 0;
+        if (!parse_int(ts_part, raw)) return false;
+        ts = &timestamp_for(raw);
+    }
+
+    const auto before = out.size();
+    while (!fields.empty()) {
+        auto field = next_token(fields, ',');
+        auto eq = field.find('=');
+        if (eq == std::string_view::npos) {
+            // Строка отклоняется целиком: уже разобранные поля убираются
+            out.resize(before);
+            return false;
+        }
+        auto key = field.substr(0, eq);
+        if (!subtype.empty() && key != "value") continue;
+
+        Metric m;
+        if (!parse_double(field.substr(eq + 1), m.value)) {
+            out.resize(before);
+            return false;
+        }
+        m.gh_id = gh_id;
+        m.subtype = subtype.empty() ? std::string(key) : std::string(subtype);
+        m.ts = *ts;
+        m.seq = seq;
+        if (!MetricDecoder::validate(m)) {
+            out.resize(before);
+            return false;
+        }
+        out.push_back(std::move(m));
+    }
+    return out.size() > before;
+}
+
+const std::string& UdpIngestListener::timestamp_for(std::int64_t raw)
+{
+    const std::int64_t sec = raw / divisor_;
+    if (sec != last_second_) {
+        last_second_ = sec;
+        last_ts_ = MetricDecoder::format_timestamp(sec);
+    }
+    return last_ts_;
+}
+
+} // namespace processor
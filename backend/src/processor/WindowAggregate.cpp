@@ -0,0 +1,70 @@
+#include "processor/WindowAggregate.hpp"
+#include <limits>
+
+namespace processor
+{
+
+void WindowAggregate::push(std::int64_t t, double v)
+{
+    if (window_ <= 0) {
+        // Без assign(): deque при нём заново выделяет блок на каждой точке
+        if (samples_.empty()) samples_.push_back({t, v});
+        else samples_.back() = {t, v};
+        return;
+    }
+
+    samples_.push_back({t, v});
+    sum_ += v;
+    while (!min_.empty() && min_.back().v >= v) min_.pop_back();
+    min_.push_back({t, v});
+    while (!max_.empty() && max_.back().v <= v) max_.pop_back();
+    max_.push_back({t, v});
+    evict(t);
+}
+
+void WindowAggregate::evict(std::int64_t now)
+{
+    if (window_ <= 0) return;
+
+    const std::int64_t cutoff = now - window_;
+    while (!samples_.empty() && samples_.front().t <= cutoff) {
+        sum_ -= samples_.front().v;
+        samples_.pop_front();
+    }
+    while (!min_.empty() && min_.front().t <= cutoff) min_.pop_front();
+    while (!max_.empty() && max_.front().t <= cutoff) max_.pop_front();
+
+    // Пустое окно — сбрасываем накопленную погрешность суммы
+    if (samples_.empty()) sum_ = 0.0;
+}
+
+double WindowAggregate::value(Aggregate agg) const noexcept
+{
+    constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+    if (agg == Aggregate::Count) return static_cast<double>(samples_.size());
+    if (samples_.empty()) return kNaN;
+
+    switch (agg)
+    {
+    case Aggregate::Last:
+        return samples_.back().v;
+    case Aggregate::Avg:
+        return window_ <= 0 ? samples_.back().v : sum_ / static_cast<double>(samples_.size());
+    case Aggregate::Min:
+        return window_ <= 0 ? samples_.back().v : min_.front().v;
+    case Aggregate::Max:
+        return window_ <= 0 ? samples_.back().v : max_.front().v;
+    case Aggregate::Rate:
+    {
+        const auto &first = samples_.front();
+        const auto &last = samples_.back();
+        if (last.t == first.t) return kNaN;
+        return (last.v - first.v) / static_cast<double>(last.t - first.t);
+    }
+    case Aggregate::Count:
+        break;
+    }
+    return kNaN;
+}
+
+} // namespace processor
@@ -0,0 +1,515 @@
+#include "utils/Logger.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t kMaxBatch = 512;                       // Записей в одной пачке
+    constexpr auto kPollInterval = std::chrono::milliseconds(10); // Фоновый поток просыпается не реже
+    constexpr auto kSummaryScan = std::chrono::milliseconds(100); // Проверка подавленных сообщений
+
+    std::int64_t steady_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    const char *level_name(LogLevel level) noexcept
+    {
+        switch (level)
+        {
+        case LogLevel::TRACE: return "trace";
+        case LogLevel::DEBUG: return "debug";
+        case LogLevel::INFO: return "info";
+        case LogLevel::WARNING: return "warning";
+        case LogLevel::ERROR: return "error";
+        case LogLevel::FATAL: return "fatal";
+        default: return "info";
+        }
+    }
+
+    /// Буфер фиксированного размера: лишнее отбрасывается, но считается
+    struct Bounded
+    {
+        char *p;
+        char *end;
+        size_t total = 0;
+    };
+
+    /// Итератор вывода в Bounded; состояние общее у всех копий (*out++ = c)
+    struct BoundedOut
+    {
+        using difference_type = std::ptrdiff_t;
+        using value_type = char;
+
+        Bounded *b = nullptr;
+
+        BoundedOut &operator=(char c)
+        {
+            if (b->p != b->end)
+                *b->p++ = c;
+            ++b->total;
+            return *this;
+        }
+        BoundedOut &operator*() { return *this; }
+        BoundedOut &operator++() { return *this; }
+        BoundedOut operator++(int) { return *this; }
+    };
+
+    bool write_all(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t n = ::write(fd, data, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::time_t next_midnight(std::time_t now)
+    {
+        std::tm tm{};
+        localtime_r(&now, &tm);
+        tm.tm_hour = 0;
+        tm.tm_min = 0;
+        tm.tm_sec = 0;
+        ++tm.tm_mday;
+        tm.tm_isdst = -1;
+        return std::mktime(&tm);
+    }
+} // namespace
+
+// Файл с ротацией по размеру и в полночь: прежний файл переименовывается в <file>.1
+struct Logger::Sink
+{
+    std::string path;
+    size_t rotation_size = 0;
+    int fd = -1;
+    size_t size = 0;
+    std::time_t rotate_at = 0;
+
+    // Кэш секундной части метки: в пачке она почти всегда одна
+    std::int64_t stamp_sec = -1;
+    char stamp[32] = {};
+    size_t stamp_len = 0;
+
+    void open()
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        size = 0;
+        if (fd >= 0)
+        {
+            const off_t end = ::lseek(fd, 0, SEEK_END);
+            size = end > 0 ? static_cast<size_t>(end) : 0;
+        }
+        rotate_at = next_midnight(std::time(nullptr));
+    }
+
+    void close()
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+
+    void rotate()
+    {
+        close();
+        const std::string previous = path + ".1";
+        std::rename(path.c_str(), previous.c_str());
+        open();
+    }
+
+    void append_line(std::string &out, const Record &r)
+    {
+        const std::int64_t sec = r.at_ns / 1'000'000'000;
+        if (sec != stamp_sec)
+        {
+            stamp_sec = sec;
+            const std::time_t t = static_cast<std::time_t>(sec);
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            stamp_len = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        }
+        out.append(stamp, stamp_len);
+        std::format_to(std::back_inserter(out), ".{:06} [{}] [{}] [{}] ", (r.at_ns / 1000) % 1'000'000,
+                       level_name(r.level), r.component, r.tid);
+        if (r.render)
+        {
+            const size_t mark = out.size();
+            try
+            {
+                r.render(r, out);
+            }
+            catch (const std::format_error &)
+            {
+                out.resize(mark);
+                out += r.format;
+            }
+        }
+        else if (r.len == kSpilled)
+            out += r.spill;
+        else
+            out.append(r.text, r.len);
+        if (r.located)
+        {
+            std::format_to(std::back_inserter(out), " [{}:{}:{}]", r.where.file_name(), r.where.line(),
+                           r.where.function_name());
+        }
+        out += '\n';
+    }
+
+    void write(const std::string &batch)
+    {
+        if (fd >= 0 && (size >= rotation_size || std::time(nullptr) >= rotate_at))
+            rotate();
+        if (fd >= 0 && write_all(fd, batch.data(), batch.size()))
+            size += batch.size();
+    }
+};
+
+Logger::Logger() = default;
+
+Logger::~Logger()
+{
+    shutdown();
+}
+
+void Logger::initialize(const std::string &log_file, LogLevel min_level, bool console_output,
+                        size_t rotation_size, size_t queue_capacity)
+{
+    std::lock_guard<std::mutex> lock(init_mutex_);
+    if (ready_.load(std::memory_order_relaxed))
+        return;
+
+    // Ёмкость — степень двойки: позиция в кольце берётся маской
+    capacity_ = std::bit_ceil(std::max<size_t>(queue_capacity, 64));
+    mask_ = capacity_ - 1;
+    records_ = std::make_unique<Record[]>(capacity_);
+    for (size_t i = 0; i < capacity_; ++i)
+        records_[i].seq.store(i, std::memory_order_relaxed);
+
+    sink_ = std::make_unique<Sink>();
+    sink_->path = log_file;
+    sink_->rotation_size = rotation_size;
+    sink_->open();
+    if (sink_->fd < 0)
+    {
+        std::fprintf(stderr, "Logger: cannot open %s, logging to console only\n", log_file.c_str());
+    }
+
+    coarse_ms_.store(steady_ms(), std::memory_order_relaxed);
+    set_level(min_level);
+    console_.store(console_output, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread([this] { run(); });
+    ready_.store(true, std::memory_order_release);
+}
+
+LogOverflow Logger::overflow_from(std::string_view name, LogOverflow def)
+{
+    if (name == "block")
+        return LogOverflow::Block;
+    if (name == "drop")
+        return LogOverflow::Drop;
+    if (name == "count")
+        return LogOverflow::Count;
+    return def;
+}
+
+std::uint32_t Logger::current_thread_id() noexcept
+{
+    return static_cast<std::uint32_t>(::syscall(SYS_gettid));
+}
+
+void Logger::write(LogLevel level, std::string_view component, std::string_view text)
+{
+    if (!enabled(level))
+        return;
+
+    Record *r = acquire();
+    if (!r)
+        return;
+
+    stamp(*r, level, component);
+    r->located = false;
+    r->render = nullptr;
+    if (text.size() <= kRecordText)
+    {
+        std::copy(text.begin(), text.end(), r->text);
+        r->len = static_cast<std::uint32_t>(text.size());
+    }
+    else
+    {
+        r->spill.assign(text);
+        r->len = kSpilled;
+    }
+    commit(*r);
+
+    if (level == LogLevel::FATAL)
+        flush();
+}
+
+Logger::Record *Logger::acquire()
+{
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    bool waited = false;
+    for (;;)
+    {
+        Record &r = records_[pos & mask_];
+        const size_t seq = r.seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+        if (diff == 0)
+        {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                r.pos = pos;
+                return &r;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Очередь заполнена: ячейку ещё не освободил фоновый поток
+            const auto policy = static_cast<LogOverflow>(overflow_.load(std::memory_order_relaxed));
+            if (policy != LogOverflow::Block || !running_.load(std::memory_order_acquire))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (!waited)
+            {
+                waited = true;
+                blocked_.fetch_add(1, std::memory_order_relaxed);
+                wake();
+            }
+            std::this_thread::yield();
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::fill(Record &r, std::string_view format_str, std::format_args args)
+{
+    // Ошибка формата не теряет сообщение: пишется сама строка формата
+    Bounded out{r.text, r.text + kRecordText};
+    try
+    {
+        std::vformat_to(BoundedOut{&out}, format_str, args);
+    }
+    catch (const std::format_error &)
+    {
+        out = Bounded{r.text, r.text + kRecordText};
+        std::copy(format_str.begin(), format_str.end(), BoundedOut{&out});
+    }
+    if (out.total <= kRecordText)
+    {
+        r.len = static_cast<std::uint32_t>(out.total);
+        return;
+    }
+
+    // Длинное сообщение форматируется ещё раз — целиком в строку записи
+    r.spill.clear();
+    r.spill.reserve(out.total);
+    try
+    {
+        std::vformat_to(std::back_inserter(r.spill), format_str, args);
+    }
+    catch (const std::format_error &)
+    {
+        r.spill.assign(format_str);
+    }
+    r.len = kSpilled;
+}
+
+void Logger::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_requested_ = true;
+    }
+    wake_cv_.notify_one();
+}
+
+void Logger::run()
+{
+    std::string batch;
+    batch.reserve(kMaxBatch * 128);
+    std::uint64_t reported_dropped = 0;
+    std::int64_t scanned_ms = 0;
+
+    for (;;)
+    {
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping = stop_;
+        }
+
+        const size_t n = drain(batch);
+
+        // Политика Count: потери видны в самом журнале
+        const auto dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped &&
+            static_cast<LogOverflow>(overflow_.load(std::memory_order_relaxed)) == LogOverflow::Count)
+        {
+            note(batch, LogLevel::WARNING, nullptr,
+                 std::format("Logger: {} records dropped, queue full", dropped - reported_dropped));
+        }
+        reported_dropped = dropped;
+
+        const std::int64_t now_ms = steady_ms();
+        coarse_ms_.store(now_ms, std::memory_order_relaxed);
+        // Перед остановкой — сводки по всем местам вызова, не дожидаясь периода
+        if (stopping || now_ms - scanned_ms >= kSummaryScan.count())
+        {
+            scanned_ms = now_ms;
+            report_suppressed(batch, now_ms, stopping);
+        }
+
+        if (!batch.empty())
+        {
+            write_batch(batch);
+            batch.clear();
+        }
+        written_.fetch_add(n, std::memory_order_relaxed);
+
+        // Пачка неполная — очередь пуста (или дописывается): можно ждать
+        if (n < kMaxBatch)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushed_ = head_;
+            flushed_cv_.notify_all();
+            if (stopping && n == 0)
+                break;
+            wake_cv_.wait_for(lock, kPollInterval, [this] { return wake_requested_ || stop_; });
+            wake_requested_ = false;
+        }
+    }
+}
+
+void Logger::note(std::string &batch, LogLevel level, const std::source_location *where, std::string_view text)
+{
+    Record r;
+    stamp(r, level, "logger");
+    if (where)
+    {
+        r.where = *where;
+        r.located = true;
+    }
+    r.len = static_cast<std::uint32_t>(std::min(text.size(), kRecordText));
+    std::copy_n(text.data(), r.len, r.text);
+    sink_->append_line(batch, r);
+}
+
+void Logger::watch(LogLimiter *limiter) noexcept
+{
+    limiter->next_ = limiters_.load(std::memory_order_relaxed);
+    while (!limiters_.compare_exchange_weak(limiter->next_, limiter, std::memory_order_release,
+                                            std::memory_order_relaxed))
+    {
+    }
+}
+
+void Logger::report_suppressed(std::string &batch, std::int64_t now_ms, bool all)
+{
+    for (LogLimiter *l = limiters_.load(std::memory_order_acquire); l; l = l->next_)
+    {
+        if (!all && now_ms - l->reported_at_ < l->period_ms_)
+            continue;
+        const auto suppressed = l->suppressed_.exchange(0, std::memory_order_relaxed);
+        if (suppressed == 0)
+            continue;
+        l->reported_at_ = now_ms;
+        note(batch, l->level_, &l->where_,
+             std::format("suppressed {} similar messages", suppressed));
+    }
+}
+
+size_t Logger::drain(std::string &batch)
+{
+    size_t n = 0;
+    while (n < kMaxBatch)
+    {
+        Record &r = records_[head_ & mask_];
+        if (r.seq.load(std::memory_order_acquire) != head_ + 1)
+            break;
+        sink_->append_line(batch, r);
+        if (r.len == kSpilled)
+            r.spill.clear();
+        r.seq.store(head_ + capacity_, std::memory_order_release);
+        ++head_;
+        ++n;
+    }
+    return n;
+}
+
+void Logger::write_batch(const std::string &batch)
+{
+    sink_->write(batch);
+    if (console_.load(std::memory_order_relaxed))
+        write_all(STDERR_FILENO, batch.data(), batch.size());
+}
+
+void Logger::flush()
+{
+    if (!running_.load(std::memory_order_acquire))
+        return;
+    const size_t target = tail_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_requested_ = true;
+    wake_cv_.notify_one();
+    flushed_cv_.wait(lock, [&] { return flushed_ >= target || !running_.load(std::memory_order_relaxed); });
+}
+
+void Logger::flush_async()
+{
+    if (running_.load(std::memory_order_acquire))
+        wake();
+}
+
+void Logger::shutdown()
+{
+    std::lock_guard<std::mutex> init_lock(init_mutex_);
+    if (!running_.load(std::memory_order_acquire))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_one();
+    if (worker_.joinable())
+        worker_.join();
+    running_.store(false, std::memory_order_release);
+    flushed_cv_.notify_all();
+    sink_->close();
+}
+
+Logger::Stats Logger::stats() const
+{
+    Stats s;
+    s.written = written_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.blocked = blocked_.load(std::memory_order_relaxed);
+    s.capacity = capacity_;
+    return s;
+}
@@ -0,0 +1,62 @@
+// utils/TrantorLog.cpp
+#include "utils/TrantorLog.hpp"
+#include "utils/Logger.hpp"
+#include <trantor/utils/Logger.h>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace utils_sg {
+
+namespace {
+
+// Строка trantor: "<дата> <время> [UTC] <tid> LEVEL  сообщение - файл:строка\n".
+// Метку времени и номер потока пишет Logger, здесь они отбрасываются
+void forwardLine(std::string_view line)
+{
+    static constexpr std::pair<std::string_view, LogLevel> kLevels[] = {
+        {" TRACE ", LogLevel::TRACE}, {" DEBUG ", LogLevel::DEBUG}, {" INFO  ", LogLevel::INFO},
+        {" WARN  ", LogLevel::WARNING}, {" ERROR ", LogLevel::ERROR}, {" FATAL ", LogLevel::FATAL}};
+
+    // Уровень — самая ранняя метка в начале строки: сообщение может содержать другие
+    LogLevel level = LogLevel::INFO;
+    size_t body = 0;
+    size_t first = std::string_view::npos;
+    const auto head = line.substr(0, 64);
+    for (const auto &[token, l] : kLevels)
+    {
+        const auto at = head.find(token);
+        if (at < first)
+        {
+            first = at;
+            level = l;
+            body = at + token.size();
+        }
+    }
+    line.remove_prefix(body);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        line.remove_suffix(1);
+    // Запись FATAL сама ждёт записи очереди, остальные не блокируют поток drogon
+    Logger::instance().write(level, "drogon", line);
+}
+
+// Номера уровней trantor (kTrace ... kFatal) совпадают с LogLevel
+void syncLevel(LogLevel level)
+{
+    trantor::Logger::setLogLevel(static_cast<trantor::Logger::LogLevel>(static_cast<int>(level)));
+}
+
+} // namespace
+
+void attachTrantorLogging()
+{
+    trantor::Logger::setOutputFunction(
+        [](const char *msg, const uint64_t len)
+        { forwardLine(std::string_view(msg, len)); },
+        // trantor сбрасывает вывод после строк ERROR и FATAL: только будим
+        // фоновый поток, FATAL уже дописан в write()
+        [] { Logger::instance().flush_async(); });
+    Logger::instance().on_level_change(&syncLevel);
+}
+
+} // namespace utils_sg
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iostream>
+
+/**
+ * @file TestCheck.hpp
+ * @brief Минимальные проверки для модульных тестов (без внешнего фреймворка)
+ *
+ * CHECK и CHECK_EQ не прерывают тест: все упавшие проверки печатаются,
+ * main() возвращает test_sg::result() — ненулевой код, если хоть одна упала.
+ */
+
+namespace test_sg
+{
+    inline int failures = 0;
+
+    inline int result()
+    {
+        if (failures) std::cerr << failures << " check(s) failed\n";
+        return failures ? 1 : 0;
+    }
+} // namespace test_sg
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            ++test_sg::failures;                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                   \
+    do {                                                                             \
+        const auto &a_ = (actual);                                                   \
+        const auto &e_ = (expected);                                                 \
+        if (!(a_ == e_)) {                                                           \
+            ++test_sg::failures;                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #actual ", "   \
+                      << #expected << ") failed: " << a_ << " != " << e_ << "\n";    \
+        }                                                                            \
+    } while (0)
@@ -0,0 +1,103 @@
+// Разбор time_spec и расчёт ближайшего срабатывания (CronSpec)
+#include "processor/CronSpec.hpp"
+#include "TestCheck.hpp"
+#include <cstdint>
+#include <string>
+
+using processor::CronSpec;
+
+namespace
+{
+
+// 2024-01-01 00:00:00 UTC, понедельник
+constexpr std::int64_t kJan1 = 1704067200;
+constexpr std::int64_t kDay = 86400;
+
+std::int64_t nextAfter(const char *spec, std::int64_t t)
+{
+    auto c = CronSpec::parse(spec);
+    CHECK(c.has_value());
+    if (!c) return -1;
+    return c->next_after(t).value_or(-1);
+}
+
+void testDaily()
+{
+    CHECK_EQ(nextAfter("TZ=UTC 08:30", kJan1), kJan1 + 8 * 3600 + 30 * 60);
+    // Строго после t: в сам момент срабатывания — следующие сутки
+    CHECK_EQ(nextAfter("TZ=UTC 08:30", kJan1 + 8 * 3600 + 30 * 60), kDay + kJan1 + 8 * 3600 + 30 * 60);
+    // Секунды в HH:MM:SS игнорируются
+    CHECK_EQ(nextAfter("TZ=UTC 08:30:45", kJan1), kJan1 + 8 * 3600 + 30 * 60);
+}
+
+void testFields()
+{
+    CHECK_EQ(nextAfter("TZ=UTC */15 * * * *", kJan1), kJan1 + 900);
+    CHECK_EQ(nextAfter("TZ=UTC */15 * * * *", kJan1 + 1), kJan1 + 900);
+    CHECK_EQ(nextAfter("TZ=UTC 0-30/10 8-18 * * *", kJan1 + 8 * 3600 + 30 * 60), kJan1 + 9 * 3600);
+    // Пятница 10:00 → понедельник 09:00
+    CHECK_EQ(nextAfter("TZ=UTC 0 9 * * mon-fri", kJan1 + 4 * kDay + 10 * 3600), kJan1 + 7 * kDay + 9 * 3600);
+    CHECK_EQ(nextAfter("TZ=UTC 0 0 1 feb *", kJan1), 1706745600);
+}
+
+void testDayOfMonthOrWeek()
+{
+    // Ограничены оба поля — достаточно любого: пятница 5 января раньше 13-го
+    CHECK_EQ(nextAfter("TZ=UTC 0 0 13 * fri", kJan1), kJan1 + 4 * kDay);
+    CHECK_EQ(nextAfter("TZ=UTC 0 0 13 * *", kJan1), kJan1 + 12 * kDay);
+}
+
+void testMacrosAndRare()
+{
+    CHECK_EQ(nextAfter("TZ=UTC @hourly", kJan1 + 1), kJan1 + 3600);
+    CHECK_EQ(nextAfter("TZ=UTC @monthly", kJan1 + 14 * kDay), 1706745600);
+    // 29 февраля — следующее в високосном 2028
+    CHECK_EQ(nextAfter("TZ=UTC 0 0 29 2 *", 1709251200), 1835395200);
+}
+
+void testTimeZone()
+{
+    CHECK_EQ(nextAfter("TZ=UTC+03:00 08:00", kJan1), kJan1 + 5 * 3600);
+    CHECK_EQ(nextAfter("CRON_TZ=UTC-5 08:00", kJan1), kJan1 + 13 * 3600);
+    CHECK_EQ(nextAfter("TZ=Z 08:00", kJan1), kJan1 + 8 * 3600);
+}
+
+void testOnce()
+{
+    auto c = CronSpec::parse("TZ=UTC 2024-03-01 12:00:00");
+    CHECK(c.has_value());
+    if (!c) return;
+    CHECK(c->once());
+    CHECK_EQ(c->next_after(kJan1).value_or(-1), 1709294400);
+    CHECK(!c->next_after(1709294400).has_value());
+    CHECK(!CronSpec::parse("TZ=UTC 08:00")->once());
+}
+
+void testInvalid()
+{
+    for (const char *spec : {"", "25:00", "08:61", "61 * * * *", "* * * *", "0 0 32 * *",
+                             "*/0 * * * *", "5-1 * * * *", "0 0 * * funday",
+                             "TZ=Europe/Moscow 08:00", "TZ=UTC", "2024-13-01 00:00:00"}) {
+        std::string error;
+        if (CronSpec::parse(spec, &error)) {
+            ++test_sg::failures;
+            std::cerr << "parse(\"" << spec << "\") accepted an invalid spec\n";
+        } else {
+            CHECK(!error.empty());
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testDaily();
+    testFields();
+    testDayOfMonthOrWeek();
+    testMacrosAndRare();
+    testTimeZone();
+    testOnce();
+    testInvalid();
+    return test_sg::result();
+}
@@ -0,0 +1,123 @@
+// Срабатывания, пропущенные за время простоя (RuleScheduler, misfire_grace)
+#include "processor/RuleScheduler.hpp"
+#include "TestCheck.hpp"
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using processor::CronSpec;
+using processor::RuleScheduler;
+using processor::ScheduledRule;
+
+namespace
+{
+
+struct Fired
+{
+    int rule_id;
+    std::int64_t at;
+};
+
+std::int64_t unixNow()
+{
+    return static_cast<std::int64_t>(std::time(nullptr));
+}
+
+// Однократное расписание на момент at (UTC)
+std::string onceAt(std::int64_t at)
+{
+    const std::time_t t = static_cast<std::time_t>(at);
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+    return std::string("TZ=UTC ") + buf;
+}
+
+Rule timeRule(int rule_id, const std::string &spec)
+{
+    Rule r(1, "test", -1, 7, "time");
+    r.rule_id = rule_id;
+    r.time_spec = spec;
+    return r;
+}
+
+// Запуск планировщика как при старте сервера: sync с сохранёнными временами
+std::vector<Fired> startWith(const Rule &rule, std::int64_t last_fired, int grace)
+{
+    boost::asio::io_context ioc;
+    RulesConfig cfg;
+    cfg.misfire_grace = grace;
+    std::vector<Fired> fired;
+    RuleScheduler scheduler(ioc, cfg, [&fired](const ScheduledRule &r, std::int64_t at) {
+        fired.push_back({r.rule_id, at});
+    });
+
+    std::unordered_map<int, std::int64_t> last;
+    if (last_fired >= 0) last[rule.rule_id] = last_fired;
+    scheduler.sync({rule}, last);
+    ioc.run_for(std::chrono::milliseconds(100));
+    scheduler.stop();
+    return fired;
+}
+
+void testMissedWithinGrace()
+{
+    const auto now = unixNow();
+    const auto fired = startWith(timeRule(1, onceAt(now - 100)), now - 1000, 300);
+    CHECK_EQ(fired.size(), 1u);
+    if (fired.empty()) return;
+    CHECK_EQ(fired[0].rule_id, 1);
+    // Плановое время — пропущенное, а не время запуска
+    CHECK_EQ(fired[0].at, now - 100);
+}
+
+void testMissedBeyondGrace()
+{
+    const auto now = unixNow();
+    CHECK(startWith(timeRule(1, onceAt(now - 100)), now - 1000, 30).empty());
+}
+
+void testAlreadyFired()
+{
+    // Сохранённое время срабатывания — после перезапуска не повторяется
+    const auto now = unixNow();
+    CHECK(startWith(timeRule(1, onceAt(now - 100)), now - 100, 300).empty());
+}
+
+void testNoHistory()
+{
+    // Без сохранённого срабатывания догонять нечего: ждём следующего
+    const auto now = unixNow();
+    CHECK(startWith(timeRule(1, onceAt(now - 100)), -1, 300).empty());
+}
+
+void testRepeatingCatchesUpOnce()
+{
+    // Из нескольких пропущенных выполняется только первое; дальше — по расписанию
+    const auto now = unixNow();
+    const auto last = now - 600;
+    const auto missed = CronSpec::parse("TZ=UTC * * * * *")->next_after(last).value();
+    const auto fired = startWith(timeRule(2, "TZ=UTC * * * * *"), last, 3600);
+    CHECK(!fired.empty());
+    if (fired.empty()) return;
+    CHECK_EQ(fired[0].at, missed);
+    for (size_t i = 1; i < fired.size(); ++i) {
+        CHECK(fired[i].at > now);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testMissedWithinGrace();
+    testMissedBeyondGrace();
+    testAlreadyFired();
+    testNoHistory();
+    testRepeatingCatchesUpOnce();
+    return test_sg::result();
+}
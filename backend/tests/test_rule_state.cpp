@@ -0,0 +1,156 @@
+// Смены состояния порогового правила: гистерезис, debounce, min_dwell
+#include "processor/RuleIndex.hpp"
+#include "TestCheck.hpp"
+
+using processor::CompareOp;
+using processor::CompiledRule;
+using processor::RuleState;
+
+namespace
+{
+
+CompiledRule makeRule(CompareOp op, double threshold)
+{
+    CompiledRule r;
+    r.rule_id = 1;
+    r.op = op;
+    r.threshold = threshold;
+    return r;
+}
+
+void testNoHysteresis()
+{
+    // Без порога выключения правило выключается по обратному условию
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    RuleState s;
+
+    CHECK(!s.observe(rule, 29.0, 0));
+    CHECK(s.observe(rule, 31.0, 1));
+    CHECK(s.active);
+    CHECK_EQ(s.since, 1);
+    CHECK_EQ(s.value, 31.0);
+    CHECK(!s.observe(rule, 32.0, 2));
+    CHECK(s.observe(rule, 30.0, 3));
+    CHECK(!s.active);
+}
+
+void testHysteresis()
+{
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    rule.has_off = true;
+    rule.off_threshold = 25.0;
+    RuleState s;
+
+    CHECK(s.observe(rule, 31.0, 0));
+    // Между порогами состояние держится
+    CHECK(!s.observe(rule, 28.0, 1));
+    CHECK(!s.observe(rule, 25.0, 2));
+    CHECK(s.active);
+    CHECK(s.observe(rule, 24.9, 3));
+    CHECK(!s.active);
+    CHECK_EQ(s.value, 24.9);
+    // Снова включается только выше порога включения
+    CHECK(!s.observe(rule, 29.0, 4));
+    CHECK(s.observe(rule, 30.5, 5));
+}
+
+void testHysteresisBelow()
+{
+    // Для "<" порог выключения выше порога включения
+    auto rule = makeRule(CompareOp::Lt, 10.0);
+    rule.has_off = true;
+    rule.off_threshold = 12.0;
+    RuleState s;
+
+    CHECK(s.observe(rule, 9.0, 0));
+    CHECK(!s.observe(rule, 11.0, 1));
+    CHECK(!s.observe(rule, 12.0, 2));
+    CHECK(s.observe(rule, 12.5, 3));
+    CHECK(!s.active);
+}
+
+void testDebounce()
+{
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    rule.debounce = 10;
+    RuleState s;
+
+    CHECK(!s.observe(rule, 31.0, 100));
+    CHECK_EQ(s.pending, 100);
+    CHECK(!s.observe(rule, 32.0, 105));
+    CHECK(!s.settle(rule, 109));
+    CHECK(s.observe(rule, 33.0, 110));
+    CHECK(s.active);
+    CHECK_EQ(s.since, 110);
+    CHECK_EQ(s.pending, -1);
+}
+
+void testDebounceReset()
+{
+    // Возврат условия до истечения debounce сбрасывает ожидание
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    rule.debounce = 10;
+    RuleState s;
+
+    CHECK(!s.observe(rule, 31.0, 0));
+    CHECK(!s.observe(rule, 20.0, 3));
+    CHECK_EQ(s.pending, -1);
+    CHECK(!s.settle(rule, 20));
+    CHECK(!s.active);
+
+    CHECK(!s.observe(rule, 31.0, 5));
+    CHECK(!s.settle(rule, 14));
+    // Без новых метрик смену завершает settle (RuleIndex::advance)
+    CHECK(s.settle(rule, 15));
+    CHECK(s.active);
+    CHECK_EQ(s.since, 15);
+}
+
+void testMinDwell()
+{
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    rule.min_dwell = 60;
+    RuleState s;
+
+    // Первая смена не ждёт: предыдущей не было
+    CHECK(s.observe(rule, 31.0, 0));
+    CHECK(!s.observe(rule, 20.0, 10));
+    CHECK_EQ(s.pending, 10);
+    CHECK(!s.settle(rule, 59));
+    CHECK(s.active);
+    CHECK(s.settle(rule, 60));
+    CHECK(!s.active);
+    CHECK_EQ(s.since, 60);
+    CHECK_EQ(s.value, 20.0);
+}
+
+void testDebounceAndDwell()
+{
+    // Смена происходит, когда истекли оба срока
+    auto rule = makeRule(CompareOp::Gt, 30.0);
+    rule.debounce = 5;
+    rule.min_dwell = 30;
+    RuleState s;
+
+    CHECK(!s.observe(rule, 31.0, 0));
+    CHECK(s.settle(rule, 5));
+    CHECK(!s.observe(rule, 20.0, 20));
+    CHECK(!s.settle(rule, 25)); // debounce истёк, min_dwell — нет
+    CHECK(!s.settle(rule, 34));
+    CHECK(s.settle(rule, 35));
+    CHECK(!s.active);
+}
+
+} // namespace
+
+int main()
+{
+    testNoHysteresis();
+    testHysteresis();
+    testHysteresisBelow();
+    testDebounce();
+    testDebounceReset();
+    testMinDwell();
+    testDebounceAndDwell();
+    return test_sg::result();
+}